@@ -13,6 +13,7 @@
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/crypto-sim.h"
+#include "ns3/crypto-sim-helper.h"
 
 using namespace ns3;
 
@@ -21,6 +22,19 @@ NS_LOG_COMPONENT_DEFINE("CryptoSimExample");
 int
 main(int argc, char* argv[])
 {
+    bool preshared = false;
+    std::string mode = "Cbc";
+    std::string ivSource = "Random";
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("preshared", "Share the key between the nodes instead of sending it", preshared);
+    cmd.AddValue("mode", "Cipher mode: Cbc, Gcm or Ccm", mode);
+    cmd.AddValue("ivSource", "IV source: Random, Counter or Stream", ivSource);
+    cmd.Parse(argc, argv);
+
+    Config::SetDefault("ns3::CryptoSim::Mode", StringValue(mode));
+    Config::SetDefault("ns3::CryptoSim::IvSource", StringValue(ivSource));
+
     // Create nodes
     NodeContainer nodes;
     nodes.Create(2);
@@ -57,10 +71,23 @@ main(int argc, char* argv[])
     std::cout << "Original data: " << originalData << std::endl;
     std::cout << "Original data size: " << originalData.size() << " bytes" << std::endl;
 
-    // Encrypt the data using CryptoSim
+    // Encrypt the data using CryptoSim; with a pre-shared key, node 0
+    // encrypts and node 1 decrypts, and only the key ID is sent
     Ptr<CryptoSim> encryptor = CreateObject<CryptoSim>();
+    Ptr<CryptoSim> decryptor = encryptor;
     std::vector<uint8_t> inputVector(originalData.begin(), originalData.end());
-    std::vector<uint8_t> encryptedData = encryptor->Encrypt(inputVector);
+    std::vector<uint8_t> encryptedData;
+    if (preshared)
+    {
+        uint8_t keyId = CryptoSimHelper::InstallPairKey(nodes.Get(0), nodes.Get(1));
+        encryptor = nodes.Get(0)->GetObject<CryptoSim>();
+        decryptor = nodes.Get(1)->GetObject<CryptoSim>();
+        encryptedData = encryptor->Encrypt(inputVector, keyId);
+    }
+    else
+    {
+        encryptedData = encryptor->Encrypt(inputVector);
+    }
     
     std::cout << "Encrypted data size: " << encryptedData.size() << " bytes" << std::endl;
 
@@ -89,7 +116,7 @@ main(int argc, char* argv[])
     
     // Now demonstrate decryption of the same data
     std::cout << "\n=== Demonstrating Decryption ===" << std::endl;
-    std::vector<uint8_t> decryptedData = encryptor->Decrypt(encryptedData);
+    std::vector<uint8_t> decryptedData = decryptor->Decrypt(encryptedData);
     std::string decryptedString(decryptedData.begin(), decryptedData.end());
     
     if (originalData == decryptedString)
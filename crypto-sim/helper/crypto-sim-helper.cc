@@ -1,4 +1,6 @@
 #include "crypto-sim-helper.h"
+#include "ns3/abort.h"
+#include "ns3/enum.h"
 #include "ns3/object-factory.h"
 
 namespace ns3 {
@@ -9,4 +11,54 @@ CryptoSimHelper::Create()
   return CreateObject<CryptoSim>();
 }
 
-} // namespace ns3
\ No newline at end of file
+Ptr<CryptoSim>
+CryptoSimHelper::Install(Ptr<Node> node)
+{
+  Ptr<CryptoSim> crypto = node->GetObject<CryptoSim>();
+  if (!crypto)
+  {
+    crypto = CreateObject<CryptoSim>();
+    node->AggregateObject(crypto);
+  }
+  return crypto;
+}
+
+uint8_t
+CryptoSimHelper::InstallPairKey(Ptr<Node> a, Ptr<Node> b, std::vector<uint8_t> key)
+{
+  NS_ABORT_MSG_IF(a == b, "A pair key needs two different nodes");
+  Ptr<CryptoSim> cryptoA = Install(a);
+  Ptr<CryptoSim> cryptoB = Install(b);
+  if (key.empty())
+  {
+    key = cryptoA->GenerateKey(16);
+  }
+
+  int keyId = 0;
+  while (keyId < 256 && (cryptoA->HasKey(keyId) || cryptoB->HasKey(keyId)))
+  {
+    keyId++;
+  }
+  NS_ABORT_MSG_IF(keyId == 256, "Nodes " << a->GetId() << " and " << b->GetId()
+                                         << " have no key ID left in common");
+
+  for (Ptr<CryptoSim> crypto : {cryptoA, cryptoB})
+  {
+    crypto->SetAttribute("KeyMode", EnumValue<CryptoSim::KeyMode>(CryptoSim::KEY_PRESHARED));
+    NS_ABORT_MSG_IF(!crypto->SetKey(keyId, key), "Invalid pre-shared key of " << key.size() << " bytes");
+  }
+  return keyId;
+}
+
+int64_t
+CryptoSimHelper::AssignStreams(NodeContainer c, int64_t stream)
+{
+  int64_t currentStream = stream;
+  for (auto i = c.Begin(); i != c.End(); ++i)
+  {
+    currentStream += Install(*i)->AssignStreams(currentStream);
+  }
+  return currentStream - stream;
+}
+
+} // namespace ns3
@@ -2,6 +2,8 @@
 #define CRYPTO_SIM_HELPER_H
 
 #include "ns3/crypto-sim.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
 #include "ns3/ptr.h"
 
 namespace ns3 {
@@ -17,8 +19,42 @@ public:
    * @return A smart pointer to the created CryptoSim object
    */
   static Ptr<CryptoSim> Create();
+
+  /**
+   * @brief Get the CryptoSim aggregated to a node, aggregating a new one if it has none
+   * @param node The node
+   * @return The node's CryptoSim
+   */
+  static Ptr<CryptoSim> Install(Ptr<Node> node);
+
+  /**
+   * @brief Share a key between two nodes, for pre-shared key mode
+   *
+   * Installs the key on the CryptoSim of both nodes (see Install()) under the
+   * lowest ID neither of them uses yet, and switches both to
+   * CryptoSim::KEY_PRESHARED. Data either node encrypts with
+   * CryptoSim::Encrypt(data, keyId) carries only the key ID, and the other
+   * node decrypts it.
+   *
+   * @param a One node
+   * @param b The other node
+   * @param key The key to share; a random 16-byte key if empty
+   * @return The ID of the key on both nodes
+   */
+  static uint8_t InstallPairKey(Ptr<Node> a, Ptr<Node> b, std::vector<uint8_t> key = std::vector<uint8_t>());
+
+  /**
+   * @brief Assign fixed random variable streams to the CryptoSim of each node
+   *
+   * Installs a CryptoSim on nodes that have none (see Install()).
+   *
+   * @param c The nodes
+   * @param stream First stream index to use
+   * @return The number of stream indices assigned
+   */
+  static int64_t AssignStreams(NodeContainer c, int64_t stream);
 };
 
 } // namespace ns3
 
-#endif /* CRYPTO_SIM_HELPER_H */
\ No newline at end of file
+#endif /* CRYPTO_SIM_HELPER_H */
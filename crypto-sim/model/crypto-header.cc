@@ -0,0 +1,145 @@
+#include "crypto-header.h"
+#include "ns3/log.h"
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("CryptoHeader");
+
+NS_OBJECT_ENSURE_REGISTERED(CryptoHeader);
+
+TypeId CryptoHeader::GetTypeId(void)
+{
+  static TypeId tid = TypeId("ns3::CryptoHeader")
+    .SetParent<Header>()
+    .SetGroupName("CryptoSim")
+    .AddConstructor<CryptoHeader>();
+  return tid;
+}
+
+TypeId CryptoHeader::GetInstanceTypeId(void) const
+{
+  return GetTypeId();
+}
+
+CryptoHeader::CryptoHeader()
+    : m_flags(0),
+      m_key(),
+      m_iv(),
+      m_tag()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+CryptoHeader::~CryptoHeader()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+uint8_t CryptoHeader::GetFlags() const
+{
+    return m_flags;
+}
+
+void CryptoHeader::SetMode(uint8_t mode)
+{
+    m_flags = (m_flags & ~MODE_MASK) | ((mode << 1) & MODE_MASK);
+}
+
+uint8_t CryptoHeader::GetMode() const
+{
+    return (m_flags & MODE_MASK) >> 1;
+}
+
+void CryptoHeader::SetKey(const uint8_t* key)
+{
+    m_flags |= EMBEDDED_KEY;
+    std::memcpy(m_key, key, sizeof(m_key));
+}
+
+void CryptoHeader::SetKeyId(uint8_t keyId)
+{
+    m_flags &= ~EMBEDDED_KEY;
+    m_key[0] = keyId;
+}
+
+uint8_t CryptoHeader::GetKeyId() const
+{
+    return m_key[0];
+}
+
+bool CryptoHeader::HasEmbeddedKey() const
+{
+    return (m_flags & EMBEDDED_KEY) != 0;
+}
+
+const uint8_t* CryptoHeader::GetKeyField() const
+{
+    return m_key;
+}
+
+uint32_t CryptoHeader::GetKeyFieldSize() const
+{
+    return HasEmbeddedKey() ? sizeof(m_key) : 1;
+}
+
+uint8_t* CryptoHeader::GetIv()
+{
+    return m_iv;
+}
+
+uint32_t CryptoHeader::GetIvSize() const
+{
+    return GetMode() == 0 ? 16 : 12;
+}
+
+uint8_t* CryptoHeader::GetTag()
+{
+    return m_tag;
+}
+
+uint32_t CryptoHeader::GetTagSize() const
+{
+    return GetMode() == 0 ? 0 : sizeof(m_tag);
+}
+
+uint32_t CryptoHeader::GetSizeFromFlags(uint8_t flags)
+{
+    CryptoHeader header;
+    header.m_flags = flags;
+    return header.GetSerializedSize();
+}
+
+void CryptoHeader::Print(std::ostream& os) const
+{
+    os << "flags=0x" << std::hex << static_cast<uint32_t>(m_flags) << std::dec
+       << " mode=" << static_cast<uint32_t>(GetMode());
+    if (!HasEmbeddedKey())
+    {
+        os << " keyId=" << static_cast<uint32_t>(GetKeyId());
+    }
+}
+
+uint32_t CryptoHeader::GetSerializedSize(void) const
+{
+    return 1 + GetKeyFieldSize() + GetIvSize() + GetTagSize();
+}
+
+void CryptoHeader::Serialize(Buffer::Iterator start) const
+{
+    start.WriteU8(m_flags);
+    start.Write(m_key, GetKeyFieldSize());
+    start.Write(m_iv, GetIvSize());
+    start.Write(m_tag, GetTagSize());
+}
+
+uint32_t CryptoHeader::Deserialize(Buffer::Iterator start)
+{
+    m_flags = start.ReadU8();
+    start.Read(m_key, GetKeyFieldSize());
+    start.Read(m_iv, GetIvSize());
+    start.Read(m_tag, GetTagSize());
+    return GetSerializedSize();
+}
+
+} // namespace ns3
@@ -0,0 +1,122 @@
+#ifndef CRYPTO_HEADER_H
+#define CRYPTO_HEADER_H
+
+#include "ns3/header.h"
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * @brief Header prepended to packets transformed by CryptoSim::EncryptPacket().
+ *
+ * The header is one byte of flags, followed by the 16-byte key or the
+ * one-byte key ID, the IV (16 bytes, CBC) or nonce (12 bytes, GCM and CCM),
+ * and in the authenticated modes the 16-byte tag. The flags give the cipher
+ * mode and how the key is given, so the receiver needs no configuration to
+ * parse it.
+ */
+class CryptoHeader : public Header
+{
+public:
+  /**
+   * @brief Bits of the flags field.
+   */
+  enum Flags : uint8_t
+  {
+    EMBEDDED_KEY = 0x01,  ///< The header carries the key itself rather than its ID
+    MODE_MASK = 0x06,     ///< Cipher mode, a CryptoSim::Mode shifted left by one
+  };
+
+  static TypeId GetTypeId(void);
+  TypeId GetInstanceTypeId(void) const override;
+
+  CryptoHeader();
+  ~CryptoHeader() override;
+
+  /**
+   * @brief Gets the flags field.
+   */
+  uint8_t GetFlags() const;
+
+  /**
+   * @brief Sets the cipher mode, a CryptoSim::Mode.
+   */
+  void SetMode(uint8_t mode);
+
+  /**
+   * @brief Gets the cipher mode, a CryptoSim::Mode.
+   */
+  uint8_t GetMode() const;
+
+  /**
+   * @brief Carries a 16-byte key in the header.
+   */
+  void SetKey(const uint8_t* key);
+
+  /**
+   * @brief Carries the ID of a pre-shared key in the header.
+   */
+  void SetKeyId(uint8_t keyId);
+
+  /**
+   * @brief Gets the ID of the pre-shared key; only meaningful without an embedded key.
+   */
+  uint8_t GetKeyId() const;
+
+  /**
+   * @brief Whether the header carries the key itself.
+   */
+  bool HasEmbeddedKey() const;
+
+  /**
+   * @brief Gets the key or key ID, GetKeyFieldSize() bytes.
+   */
+  const uint8_t* GetKeyField() const;
+
+  /**
+   * @brief Size of the key field: 16 with an embedded key, 1 otherwise.
+   */
+  uint32_t GetKeyFieldSize() const;
+
+  /**
+   * @brief Gets the IV or nonce, GetIvSize() bytes, for CryptoSim to fill in or read.
+   */
+  uint8_t* GetIv();
+
+  /**
+   * @brief Size of the IV or nonce of the mode: 16 for CBC, 12 otherwise.
+   */
+  uint32_t GetIvSize() const;
+
+  /**
+   * @brief Gets the tag, GetTagSize() bytes, for CryptoSim to fill in or read.
+   */
+  uint8_t* GetTag();
+
+  /**
+   * @brief Size of the tag of the mode: 0 for CBC, 16 otherwise.
+   */
+  uint32_t GetTagSize() const;
+
+  /**
+   * @brief Serialized size of a header with the given flags field.
+   *
+   * Lets a receiver check that a packet is long enough before removing the header.
+   */
+  static uint32_t GetSizeFromFlags(uint8_t flags);
+
+  void Print(std::ostream& os) const override;
+  uint32_t GetSerializedSize(void) const override;
+  void Serialize(Buffer::Iterator start) const override;
+  uint32_t Deserialize(Buffer::Iterator start) override;
+
+private:
+  uint8_t m_flags;     ///< Flags field
+  uint8_t m_key[16];   ///< Key, or the key ID in the first byte
+  uint8_t m_iv[16];    ///< IV or nonce
+  uint8_t m_tag[16];   ///< Authentication tag
+};
+
+} // namespace ns3
+
+#endif /* CRYPTO_HEADER_H */
@@ -1,10 +1,17 @@
 #include "crypto-sim.h"
+#include "crypto-header.h"
+#include "ns3/enum.h"
 #include "ns3/log.h"
+#include <algorithm>
+#include <limits>
+#include <cstring>
 #include <iostream>
+#include <map>
 
 // Crypto++ headers - using local system installation
 #include <cryptopp/aes.h>
-#include <cryptopp/filters.h>
+#include <cryptopp/ccm.h>
+#include <cryptopp/gcm.h>
 #include <cryptopp/modes.h>
 #include <cryptopp/osrng.h>
 
@@ -13,15 +20,229 @@ namespace ns3 {
 // Define a logging component for this module
 NS_LOG_COMPONENT_DEFINE("CryptoSim");
 
+NS_OBJECT_ENSURE_REGISTERED(CryptoSim);
+
+// AEAD nonce and tag sizes; a 12-byte CCM nonce limits messages to 16 MiB
+static const size_t AEAD_NONCE_SIZE = 12;
+static const int AEAD_TAG_SIZE = 16;
+
+/**
+ * @brief Advances a splitmix64 generator and returns its next output.
+ */
+static uint64_t
+SplitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+struct CryptoSim::CryptoContext
+{
+  /**
+   * @brief An installed key with its expanded key schedules.
+   *
+   * The cipher objects are keyed once and resynchronized with a new IV
+   * or nonce for every message.
+   */
+  struct Key
+  {
+    CryptoPP::SecByteBlock key;                                                  ///< The raw key
+    CryptoPP::CBC_Mode<CryptoPP::AES>::Encryption encryption;                    ///< Keyed CBC encryption
+    CryptoPP::CBC_Mode<CryptoPP::AES>::Decryption decryption;                    ///< Keyed CBC decryption
+    CryptoPP::GCM<CryptoPP::AES>::Encryption gcmEncryption;                      ///< Keyed GCM encryption
+    CryptoPP::GCM<CryptoPP::AES>::Decryption gcmDecryption;                      ///< Keyed GCM decryption
+    CryptoPP::CCM<CryptoPP::AES, AEAD_TAG_SIZE>::Encryption ccmEncryption;       ///< Keyed CCM encryption
+    CryptoPP::CCM<CryptoPP::AES, AEAD_TAG_SIZE>::Decryption ccmDecryption;       ///< Keyed CCM decryption
+    CryptoPP::AES::Encryption ivCipher;                                          ///< Turns counters into CBC IVs
+
+    Key(const uint8_t* data, size_t size)
+        : key(data, size)
+    {
+      // The IV and nonce are replaced before every use
+      uint8_t iv[CryptoPP::AES::BLOCKSIZE] = {};
+      encryption.SetKeyWithIV(key, key.size(), iv);
+      decryption.SetKeyWithIV(key, key.size(), iv);
+      gcmEncryption.SetKeyWithIV(key, key.size(), iv, AEAD_NONCE_SIZE);
+      gcmDecryption.SetKeyWithIV(key, key.size(), iv, AEAD_NONCE_SIZE);
+      ccmEncryption.SetKeyWithIV(key, key.size(), iv, AEAD_NONCE_SIZE);
+      ccmDecryption.SetKeyWithIV(key, key.size(), iv, AEAD_NONCE_SIZE);
+      ivCipher.SetKey(key, key.size());
+    }
+
+    /**
+     * @brief Encrypts in place and writes the detached tag.
+     */
+    void Seal(CryptoSim::Mode mode, uint8_t* data, size_t size, const uint8_t* nonce, uint8_t* tag,
+              const uint8_t* aad, size_t aadSize)
+    {
+      CryptoPP::AuthenticatedSymmetricCipher& cipher =
+          mode == CryptoSim::MODE_GCM ? static_cast<CryptoPP::AuthenticatedSymmetricCipher&>(gcmEncryption)
+                                      : ccmEncryption;
+      cipher.EncryptAndAuthenticate(data, tag, AEAD_TAG_SIZE, nonce, AEAD_NONCE_SIZE, aad, aadSize, data, size);
+    }
+
+    /**
+     * @brief Decrypts in place if the tag matches.
+     *
+     * @return false if the data, the additional data or the tag was altered
+     */
+    bool Open(CryptoSim::Mode mode, uint8_t* data, size_t size, const uint8_t* nonce, const uint8_t* tag,
+              const uint8_t* aad, size_t aadSize)
+    {
+      CryptoPP::AuthenticatedSymmetricCipher& cipher =
+          mode == CryptoSim::MODE_GCM ? static_cast<CryptoPP::AuthenticatedSymmetricCipher&>(gcmDecryption)
+                                      : ccmDecryption;
+      return cipher.DecryptAndVerify(data, tag, AEAD_TAG_SIZE, nonce, AEAD_NONCE_SIZE, aad, aadSize, data, size);
+    }
+
+    bool Matches(const uint8_t* data, size_t size) const
+    {
+      return key.size() == size && std::equal(key.begin(), key.end(), data);
+    }
+  };
+
+  CryptoPP::AutoSeededRandomPool prng;                ///< Seeded once, from the OS
+  std::map<uint8_t, std::unique_ptr<Key>> keys;       ///< Installed keys by ID
+  std::unique_ptr<Key> lastReceived;                  ///< Last key carried by Decrypt() input
+  bool ivSeeded = false;                              ///< Whether the fields below were drawn from the RNG stream
+  uint32_t ivPrefix = 0;                              ///< Sender prefix of counter IVs
+  uint64_t ivCounter = 0;                             ///< IVs handed out by the Counter and Stream sources
+  uint64_t ivState = 0;                               ///< splitmix64 state of the Stream IV source
+
+  /**
+   * @brief Writes a fresh IV or nonce for a message encrypted with key.
+   *
+   * The Counter and Stream sources are seeded from rng on first use. A
+   * counter IV is the sender prefix followed by the big-endian counter, a
+   * stream IV the next splitmix64 outputs. Both are predictable, so in CBC,
+   * where the IV must not be, the block is encrypted with the message key.
+   */
+  void NextIv(CryptoSim::IvSource source, Ptr<UniformRandomVariable> rng, Key& key, uint8_t* iv, size_t size)
+  {
+    if (source == CryptoSim::IV_RANDOM)
+    {
+      prng.GenerateBlock(iv, size);
+      return;
+    }
+    if (!ivSeeded)
+    {
+      const uint32_t max = std::numeric_limits<uint32_t>::max();
+      ivPrefix = rng->GetInteger(0, max);
+      ivState = (static_cast<uint64_t>(rng->GetInteger(0, max)) << 32) | rng->GetInteger(0, max);
+      ivSeeded = true;
+    }
+
+    uint8_t block[CryptoPP::AES::BLOCKSIZE] = {};
+    if (source == CryptoSim::IV_STREAM)
+    {
+      for (size_t i = 0; i < size; i += 8)
+      {
+        uint64_t bits = SplitMix64(ivState);
+        std::memcpy(block + i, &bits, std::min<size_t>(8, size - i));
+      }
+    }
+    else
+    {
+      for (int i = 0; i < 4; i++)
+      {
+        block[i] = static_cast<uint8_t>(ivPrefix >> (24 - 8 * i));
+      }
+      for (int i = 0; i < 8; i++)
+      {
+        block[size - 1 - i] = static_cast<uint8_t>(ivCounter >> (8 * i));
+      }
+    }
+    ivCounter++;
+    if (size == CryptoPP::AES::BLOCKSIZE)
+    {
+      key.ivCipher.ProcessBlock(block, iv);
+    }
+    else
+    {
+      std::memcpy(iv, block, size);
+    }
+  }
+
+  /**
+   * @brief Finds the key named by the key field at the start of a message.
+   *
+   * An embedded key that is not installed is expanded into lastReceived,
+   * unless it is already there.
+   *
+   * @return The key, or nullptr if the key ID is not installed
+   */
+  Key* Lookup(CryptoSim::KeyMode keyMode, const uint8_t* field)
+  {
+    if (keyMode == CryptoSim::KEY_PRESHARED)
+    {
+      auto it = keys.find(field[0]);
+      return it == keys.end() ? nullptr : it->second.get();
+    }
+    const size_t keySize = CryptoPP::AES::DEFAULT_KEYLENGTH;
+    for (auto& entry : keys)
+    {
+      if (entry.second->Matches(field, keySize))
+      {
+        return entry.second.get();
+      }
+    }
+    if (!lastReceived || !lastReceived->Matches(field, keySize))
+    {
+      lastReceived.reset(new Key(field, keySize));
+    }
+    return lastReceived.get();
+  }
+};
+
 TypeId CryptoSim::GetTypeId(void)
 {
   static TypeId tid = TypeId("ns3::CryptoSim")
     .SetParent<Object>()
-    .SetGroupName("CryptoSim");
+    .SetGroupName("CryptoSim")
+    .AddConstructor<CryptoSim>()
+    .AddAttribute("KeyMode",
+                  "How the receiver learns the key: Embedded sends it in every output (key + "
+                  "IV + ciphertext), PreShared expects both ends to have it installed under "
+                  "the same ID and sends only that ID (key ID + IV + ciphertext).",
+                  EnumValue(CryptoSim::KEY_EMBEDDED),
+                  MakeEnumAccessor<KeyMode>(&CryptoSim::m_keyMode),
+                  MakeEnumChecker(CryptoSim::KEY_EMBEDDED, "Embedded",
+                                  CryptoSim::KEY_PRESHARED, "PreShared"))
+    .AddAttribute("Mode",
+                  "Cipher mode: Cbc pads to whole blocks and has no integrity check (key field + "
+                  "IV + ciphertext); Gcm and Ccm authenticate the message and the key field, "
+                  "keep its length, and add a 16-byte tag (key field + nonce + ciphertext + tag). "
+                  "Both ends must use the same mode.",
+                  EnumValue(CryptoSim::MODE_CBC),
+                  MakeEnumAccessor<Mode>(&CryptoSim::m_mode),
+                  MakeEnumChecker(CryptoSim::MODE_CBC, "Cbc",
+                                  CryptoSim::MODE_GCM, "Gcm",
+                                  CryptoSim::MODE_CCM, "Ccm"))
+    .AddAttribute("IvSource",
+                  "Where IVs and nonces come from: Random draws them from the operating system; "
+                  "Counter uses a per-sender counter; Stream uses a splitmix64 generator. In the "
+                  "Cbc mode both are encrypted with the key, as IVs must be unpredictable. "
+                  "Counter and Stream are seeded from an ns-3 random variable stream, so runs "
+                  "with the same seed and run number produce the same ciphertexts for the same keys.",
+                  EnumValue(CryptoSim::IV_RANDOM),
+                  MakeEnumAccessor<IvSource>(&CryptoSim::m_ivSource),
+                  MakeEnumChecker(CryptoSim::IV_RANDOM, "Random",
+                                  CryptoSim::IV_COUNTER, "Counter",
+                                  CryptoSim::IV_STREAM, "Stream"));
   return tid;
 }
 
-CryptoSim::CryptoSim() {
+CryptoSim::CryptoSim()
+    : m_context(new CryptoContext),
+      m_keyMode(KEY_EMBEDDED),
+      m_mode(MODE_CBC),
+      m_ivSource(IV_RANDOM),
+      m_rng(CreateObject<UniformRandomVariable>()),
+      m_hasKey(false),
+      m_keyId(0)
+{
     NS_LOG_FUNCTION(this);
 }
 
@@ -29,77 +250,259 @@ CryptoSim::~CryptoSim() {
     NS_LOG_FUNCTION(this);
 }
 
+void CryptoSim::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_context->keys.clear();
+    m_context->lastReceived.reset();
+    m_hasKey = false;
+    m_rng = nullptr;
+    Object::DoDispose();
+}
+
+int64_t CryptoSim::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+    m_rng->SetStream(stream);
+    // Reseeding after IVs were issued could draw the same prefix and state
+    // again and repeat nonces under the same key, so the seed stays
+    if (m_context->ivSeeded)
+    {
+        NS_LOG_WARN("IVs already issued; the new stream only applies to a new CryptoSim");
+    }
+    return 1;
+}
+
 std::string CryptoSim::GetVersion()
 {
     return "CryptoSim v1.0 with Crypto++ Library";
 }
 
+bool CryptoSim::SetKey(uint8_t keyId, const std::vector<uint8_t>& key)
+{
+    NS_LOG_FUNCTION(this << +keyId);
+
+    if (key.size() != 16 && key.size() != 24 && key.size() != 32)
+    {
+        NS_LOG_ERROR("Invalid key length " << key.size() << ", expected 16, 24 or 32");
+        return false;
+    }
+
+    try {
+        m_context->keys[keyId].reset(new CryptoContext::Key(key.data(), key.size()));
+    }
+    catch (const CryptoPP::Exception& e)
+    {
+        NS_LOG_ERROR("Crypto++ key setup error: " << e.what());
+        m_context->keys.erase(keyId);
+        return false;
+    }
+    m_keyId = keyId;
+    m_hasKey = true;
+    return true;
+}
+
+bool CryptoSim::SelectKey(uint8_t keyId)
+{
+    NS_LOG_FUNCTION(this << +keyId);
+
+    if (!HasKey(keyId))
+    {
+        NS_LOG_WARN("No key installed with ID " << +keyId);
+        return false;
+    }
+    m_keyId = keyId;
+    m_hasKey = true;
+    return true;
+}
+
+int CryptoSim::Rekey()
+{
+    NS_LOG_FUNCTION(this);
+
+    // Find a free ID after the current one, so no installed key is replaced
+    uint8_t keyId = m_context->keys.empty() ? 0 : static_cast<uint8_t>(m_keyId + 1);
+    for (int i = 0; i < 256 && m_context->keys.count(keyId); i++)
+    {
+        keyId++;
+    }
+    if (m_context->keys.count(keyId))
+    {
+        NS_LOG_ERROR("No key ID left for a new key");
+        return -1;
+    }
+
+    // The new key is as long as the one it replaces
+    size_t size = m_hasKey ? m_context->keys[m_keyId]->key.size()
+                           : static_cast<size_t>(CryptoPP::AES::DEFAULT_KEYLENGTH);
+    if (!SetKey(keyId, GenerateKey(size)))
+    {
+        return -1;
+    }
+    NS_LOG_INFO("Rekeyed to key ID " << +keyId);
+    return keyId;
+}
+
+void CryptoSim::RemoveKey(uint8_t keyId)
+{
+    NS_LOG_FUNCTION(this << +keyId);
+
+    m_context->keys.erase(keyId);
+    if (m_hasKey && m_keyId == keyId)
+    {
+        m_hasKey = false;
+    }
+}
+
+bool CryptoSim::HasKey(uint8_t keyId) const
+{
+    return m_context->keys.count(keyId) > 0;
+}
+
+uint8_t CryptoSim::GetKeyId() const
+{
+    return m_keyId;
+}
+
+std::vector<uint8_t> CryptoSim::GenerateKey(size_t size)
+{
+    std::vector<uint8_t> key(size);
+    m_context->prng.GenerateBlock(key.data(), key.size());
+    return key;
+}
+
+std::vector<uint8_t> CryptoSim::GetKey(uint8_t keyId) const
+{
+    auto it = m_context->keys.find(keyId);
+    if (it == m_context->keys.end())
+    {
+        return {};
+    }
+    return std::vector<uint8_t>(it->second->key.begin(), it->second->key.end());
+}
+
+bool CryptoSim::EnsureKey()
+{
+    if (m_hasKey)
+    {
+        return true;
+    }
+    if (m_keyMode == KEY_PRESHARED)
+    {
+        NS_LOG_ERROR("No pre-shared key selected for encryption");
+        return false;
+    }
+    return Rekey() >= 0;
+}
+
 std::vector<uint8_t> CryptoSim::Encrypt(const std::vector<uint8_t>& inputData)
 {
     NS_LOG_FUNCTION(this);
 
+    if (!EnsureKey())
+    {
+        return {};
+    }
+    return Encrypt(inputData, m_keyId);
+}
+
+std::vector<uint8_t> CryptoSim::Encrypt(const std::vector<uint8_t>& inputData, uint8_t keyId)
+{
+    NS_LOG_FUNCTION(this << +keyId);
+
     if (inputData.empty())
     {
         NS_LOG_WARN("Input data for encryption is empty.");
         return {};
     }
 
+    std::vector<uint8_t> result(GetEncryptedSize(inputData.size()));
+    if (Encrypt(inputData.data(), inputData.size(), result.data(), result.size(), keyId) < 0)
+    {
+        return {};
+    }
+    return result;
+}
+
+int64_t CryptoSim::Encrypt(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity);
+
+    if (!EnsureKey())
+    {
+        return -1;
+    }
+    return Encrypt(input, inputSize, output, outputCapacity, m_keyId);
+}
+
+int64_t CryptoSim::Encrypt(const uint8_t* input,
+                           size_t inputSize,
+                           uint8_t* output,
+                           size_t outputCapacity,
+                           uint8_t keyId)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity << +keyId);
+
+    auto it = m_context->keys.find(keyId);
+    if (it == m_context->keys.end())
+    {
+        NS_LOG_ERROR("No key installed with ID " << +keyId);
+        return -1;
+    }
+    CryptoContext::Key& state = *it->second;
+    if (m_keyMode == KEY_EMBEDDED && state.key.size() != CryptoPP::AES::DEFAULT_KEYLENGTH)
+    {
+        NS_LOG_ERROR("Only 16-byte keys can be embedded in the output");
+        return -1;
+    }
+    size_t outputSize = GetEncryptedSize(inputSize);
+    if (outputSize > outputCapacity)
+    {
+        NS_LOG_ERROR("Output buffer of " << outputCapacity << " bytes too small, " << outputSize
+                     << " needed");
+        return -1;
+    }
+
+    // key field + IV or nonce + ciphertext (+ tag); the plaintext moves into
+    // place first, so output may be the input buffer itself
+    size_t keySize = GetKeyFieldSize();
+    uint8_t* iv = output + keySize;
+    uint8_t* payload = iv + GetIvSize();
+    std::memmove(payload, input, inputSize);
+    if (m_keyMode == KEY_PRESHARED)
+    {
+        output[0] = keyId;
+    }
+    else
+    {
+        std::copy(state.key.begin(), state.key.end(), output);
+    }
+
     try {
-        using namespace CryptoPP;
-
-        AutoSeededRandomPool prng;
-
-        // Generate random key and IV
-        SecByteBlock key(AES::DEFAULT_KEYLENGTH);
-        prng.GenerateBlock(key, key.size());
-
-        SecByteBlock iv(AES::BLOCKSIZE);
-        prng.GenerateBlock(iv, iv.size());
-
-        // Store key and IV for later decryption
-        m_key.assign(key.begin(), key.end());
-        m_iv.assign(iv.begin(), iv.end());
-
-        // Convert input data to string for Crypto++ processing
-        std::string plaintext(inputData.begin(), inputData.end());
-        std::string ciphertext;
-
-        // Perform AES encryption in CBC mode
-        CBC_Mode<AES>::Encryption encryption;
-        encryption.SetKeyWithIV(key, key.size(), iv);
-
-        StringSource ss(plaintext, true,
-            new StreamTransformationFilter(encryption,
-                new StringSink(ciphertext)
-            )
-        );
-
-        // Combine key + iv + ciphertext for transmission
-        std::vector<uint8_t> result;
-        result.reserve(key.size() + iv.size() + ciphertext.size());
-        
-        // Add key
-        result.insert(result.end(), key.begin(), key.end());
-        // Add IV
-        result.insert(result.end(), iv.begin(), iv.end());
-        // Add encrypted data
-        result.insert(result.end(), ciphertext.begin(), ciphertext.end());
-
-        NS_LOG_INFO("Encryption successful. Input: " << inputData.size() 
-                   << " bytes, Output: " << result.size() << " bytes");
-        
-        return result;
+        if (m_mode == MODE_CBC)
+        {
+            // PKCS #7 padding, then the blocks are encrypted where they are
+            size_t padding = outputSize - (payload - output) - inputSize;
+            std::memset(payload + inputSize, static_cast<int>(padding), padding);
+            m_context->NextIv(m_ivSource, m_rng, state, iv, GetIvSize());
+            state.encryption.Resynchronize(iv);
+            state.encryption.ProcessData(payload, payload, inputSize + padding);
+        }
+        else
+        {
+            m_context->NextIv(m_ivSource, m_rng, state, iv, AEAD_NONCE_SIZE);
+            state.Seal(m_mode, payload, inputSize, iv, payload + inputSize, output, keySize);
+        }
     }
     catch (const CryptoPP::Exception& e)
     {
         NS_LOG_ERROR("Crypto++ encryption error: " << e.what());
-        return {};
-    }
-    catch (const std::exception& e)
-    {
-        NS_LOG_ERROR("Standard encryption error: " << e.what());
-        return {};
+        return -1;
     }
+
+    NS_LOG_INFO("Encryption successful. Input: " << inputSize
+               << " bytes, Output: " << outputSize << " bytes");
+    return static_cast<int64_t>(outputSize);
 }
 
 std::vector<uint8_t> CryptoSim::Decrypt(const std::vector<uint8_t>& encryptedData)
@@ -111,57 +514,341 @@ std::vector<uint8_t> CryptoSim::Decrypt(const std::vector<uint8_t>& encryptedDat
         return {};
     }
 
+    std::vector<uint8_t> result(encryptedData.size());
+    int64_t size = Decrypt(encryptedData.data(), encryptedData.size(), result.data(), result.size());
+    if (size < 0)
+    {
+        return {};
+    }
+    result.resize(size);
+    return result;
+}
+
+int64_t CryptoSim::Decrypt(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity);
+
+    // Extract key (or key ID), IV, and ciphertext from the encrypted data
+    const size_t keySize = GetKeyFieldSize();
+    const size_t ivSize = GetIvSize();
+    const size_t tagSize = GetTagSize();
+    if (inputSize < keySize + ivSize + tagSize || (m_mode == MODE_CBC && inputSize == keySize + ivSize))
+    {
+        NS_LOG_ERROR("Encrypted data too short to contain key and IV");
+        return -1;
+    }
+    size_t size = inputSize - keySize - ivSize - tagSize;
+    if (size > outputCapacity)
+    {
+        NS_LOG_ERROR("Output buffer of " << outputCapacity << " bytes too small, " << size << " needed");
+        return -1;
+    }
+
+    // Find the key schedule of the key, expanding an embedded key only if it is new
+    CryptoContext::Key* state = m_context->Lookup(m_keyMode, input);
+    if (!state)
+    {
+        NS_LOG_ERROR("No pre-shared key installed with ID " << +input[0]);
+        return -1;
+    }
+
+    // The ciphertext moves to the output first, so output may be the input
+    // buffer itself; what it overwrites is saved before
+    uint8_t keyField[CryptoPP::AES::DEFAULT_KEYLENGTH];
+    uint8_t iv[CryptoPP::AES::BLOCKSIZE];
+    uint8_t tag[AEAD_TAG_SIZE];
+    std::memcpy(keyField, input, keySize);
+    std::memcpy(iv, input + keySize, ivSize);
+    std::memcpy(tag, input + inputSize - tagSize, tagSize);
+    std::memmove(output, input + keySize + ivSize, size);
+
+    try {
+        if (m_mode != MODE_CBC)
+        {
+            if (!state->Open(m_mode, output, size, iv, tag, keyField, keySize))
+            {
+                NS_LOG_WARN("Authentication of the encrypted data failed");
+                return -1;
+            }
+        }
+        else
+        {
+            if (size % CryptoPP::AES::BLOCKSIZE != 0)
+            {
+                NS_LOG_ERROR("Ciphertext length " << size << " is not a multiple of the block size");
+                return -1;
+            }
+            state->decryption.Resynchronize(iv);
+            state->decryption.ProcessData(output, output, size);
+
+            uint8_t padding = output[size - 1];
+            if (padding == 0 || padding > CryptoPP::AES::BLOCKSIZE ||
+                std::count(output + size - padding, output + size, padding) != padding)
+            {
+                NS_LOG_ERROR("Invalid PKCS #7 padding in the decrypted data");
+                return -1;
+            }
+            size -= padding;
+        }
+    }
+    catch (const CryptoPP::Exception& e)
+    {
+        NS_LOG_ERROR("Crypto++ decryption error: " << e.what());
+        return -1;
+    }
+
+    NS_LOG_INFO("Decryption successful. Input: " << inputSize
+               << " bytes, Output: " << size << " bytes");
+    return static_cast<int64_t>(size);
+}
+
+bool CryptoSim::EncryptPacket(Ptr<Packet> packet)
+{
+    NS_LOG_FUNCTION(this << packet);
+
+    if (!EnsureKey())
+    {
+        return false;
+    }
+    return EncryptPacket(packet, m_keyId);
+}
+
+bool CryptoSim::EncryptPacket(Ptr<Packet> packet, uint8_t keyId)
+{
+    NS_LOG_FUNCTION(this << packet << +keyId);
+
+    auto it = m_context->keys.find(keyId);
+    if (it == m_context->keys.end())
+    {
+        NS_LOG_ERROR("No key installed with ID " << +keyId);
+        return false;
+    }
+    CryptoContext::Key& state = *it->second;
+
+    CryptoHeader header;
+    header.SetMode(m_mode);
+    if (m_keyMode == KEY_EMBEDDED)
+    {
+        if (state.key.size() != CryptoPP::AES::DEFAULT_KEYLENGTH)
+        {
+            NS_LOG_ERROR("Only 16-byte keys can be embedded in the header");
+            return false;
+        }
+        header.SetKey(state.key.data());
+    }
+    else
+    {
+        header.SetKeyId(keyId);
+    }
+
+    // The payload is copied out once, transformed in the reused buffer and copied back
+    uint32_t size = packet->GetSize();
+    uint32_t padding = m_mode == MODE_CBC ? CryptoPP::AES::BLOCKSIZE - size % CryptoPP::AES::BLOCKSIZE : 0;
+    m_buffer.resize(size + padding);
+    packet->CopyData(m_buffer.data(), size);
+
     try {
-        using namespace CryptoPP;
-
-        // Extract key, IV, and ciphertext from the encrypted data
-        const size_t keySize = AES::DEFAULT_KEYLENGTH;
-        const size_t ivSize = AES::BLOCKSIZE;
-        
-        if (encryptedData.size() < keySize + ivSize) {
-            NS_LOG_ERROR("Encrypted data too short to contain key and IV");
-            return {};
+        if (m_mode == MODE_CBC)
+        {
+            std::memset(m_buffer.data() + size, static_cast<int>(padding), padding);
+            m_context->NextIv(m_ivSource, m_rng, state, header.GetIv(), header.GetIvSize());
+            state.encryption.Resynchronize(header.GetIv());
+            state.encryption.ProcessData(m_buffer.data(), m_buffer.data(), m_buffer.size());
+        }
+        else
+        {
+            m_context->NextIv(m_ivSource, m_rng, state, header.GetIv(), header.GetIvSize());
+            state.Seal(m_mode, m_buffer.data(), size, header.GetIv(), header.GetTag(), header.GetKeyField(),
+                       header.GetKeyFieldSize());
         }
+    }
+    catch (const CryptoPP::Exception& e)
+    {
+        NS_LOG_ERROR("Crypto++ encryption error: " << e.what());
+        return false;
+    }
 
-        // Extract key
-        SecByteBlock key(encryptedData.data(), keySize);
-        
-        // Extract IV
-        SecByteBlock iv(encryptedData.data() + keySize, ivSize);
-        
-        // Extract ciphertext
-        std::string ciphertext(encryptedData.begin() + keySize + ivSize, encryptedData.end());
+    packet->RemoveAtEnd(size);
+    packet->AddAtEnd(Create<Packet>(m_buffer.data(), m_buffer.size()));
+    packet->AddHeader(header);
+    return true;
+}
 
-        std::string decryptedtext;
+bool CryptoSim::DecryptPacket(Ptr<Packet> packet)
+{
+    NS_LOG_FUNCTION(this << packet);
 
-        // Perform AES decryption in CBC mode
-        CBC_Mode<AES>::Decryption decryption;
-        decryption.SetKeyWithIV(key, key.size(), iv);
+    uint8_t flags = 0;
+    if (packet->CopyData(&flags, 1) != 1 ||
+        packet->GetSize() < CryptoHeader::GetSizeFromFlags(flags))
+    {
+        NS_LOG_ERROR("Packet too short to carry a CryptoHeader");
+        return false;
+    }
 
-        StringSource ss(ciphertext, true,
-            new StreamTransformationFilter(decryption,
-                new StringSink(decryptedtext)
-            )
-        );
+    // The header names the mode and how the key is given, so any sender is
+    // understood; but with pre-shared keys a sender must not choose the key,
+    // or it could forge authenticated packets
+    CryptoHeader header;
+    uint32_t headerSize = packet->PeekHeader(header);
+    if (header.GetMode() > MODE_CCM)
+    {
+        NS_LOG_ERROR("Unknown cipher mode " << +header.GetMode() << " in CryptoHeader");
+        return false;
+    }
+    if (header.HasEmbeddedKey() && m_keyMode == KEY_PRESHARED)
+    {
+        NS_LOG_WARN("Rejecting a packet with an embedded key in the PreShared key mode");
+        return false;
+    }
+    Mode mode = static_cast<Mode>(header.GetMode());
+    KeyMode keyMode = header.HasEmbeddedKey() ? KEY_EMBEDDED : KEY_PRESHARED;
+    CryptoContext::Key* state = m_context->Lookup(keyMode, header.GetKeyField());
+    if (!state)
+    {
+        NS_LOG_ERROR("No pre-shared key installed with ID " << +header.GetKeyId());
+        return false;
+    }
 
-        // Convert back to vector
-        std::vector<uint8_t> result(decryptedtext.begin(), decryptedtext.end());
+    // The whole packet is copied out once and decrypted past the header, so
+    // the packet is left unchanged on failure
+    uint32_t size = packet->GetSize() - headerSize;
+    m_buffer.resize(headerSize + size);
+    packet->CopyData(m_buffer.data(), m_buffer.size());
+    uint8_t* payload = m_buffer.data() + headerSize;
 
-        NS_LOG_INFO("Decryption successful. Input: " << encryptedData.size() 
-                   << " bytes, Output: " << result.size() << " bytes");
+    try {
+        if (mode != MODE_CBC)
+        {
+            if (!state->Open(mode, payload, size, header.GetIv(), header.GetTag(), header.GetKeyField(),
+                             header.GetKeyFieldSize()))
+            {
+                NS_LOG_WARN("Authentication of the packet payload failed");
+                return false;
+            }
+        }
+        else
+        {
+            if (size == 0 || size % CryptoPP::AES::BLOCKSIZE != 0)
+            {
+                NS_LOG_ERROR("Ciphertext length " << size << " is not a multiple of the block size");
+                return false;
+            }
+            state->decryption.Resynchronize(header.GetIv());
+            state->decryption.ProcessData(payload, payload, size);
 
-        return result;
+            uint8_t padding = payload[size - 1];
+            if (padding == 0 || padding > CryptoPP::AES::BLOCKSIZE ||
+                std::count(payload + size - padding, payload + size, padding) != padding)
+            {
+                NS_LOG_ERROR("Invalid PKCS #7 padding in the decrypted payload");
+                return false;
+            }
+            size -= padding;
+        }
     }
     catch (const CryptoPP::Exception& e)
     {
         NS_LOG_ERROR("Crypto++ decryption error: " << e.what());
-        return {};
+        return false;
+    }
+
+    packet->RemoveAtEnd(packet->GetSize());
+    packet->AddAtEnd(Create<Packet>(payload, size));
+    return true;
+}
+
+size_t CryptoSim::GetEncryptedSize(size_t inputSize) const
+{
+    size_t payload = m_mode == MODE_CBC ? (inputSize / CryptoPP::AES::BLOCKSIZE + 1) * CryptoPP::AES::BLOCKSIZE
+                                        : inputSize + AEAD_TAG_SIZE;
+    return GetKeyFieldSize() + GetIvSize() + payload;
+}
+
+bool CryptoSim::EncryptInPlace(uint8_t keyId,
+                               uint8_t* data,
+                               size_t size,
+                               uint8_t* nonce,
+                               uint8_t* tag,
+                               const uint8_t* aad,
+                               size_t aadSize)
+{
+    NS_LOG_FUNCTION(this << +keyId << size);
+
+    if (m_mode == MODE_CBC)
+    {
+        NS_LOG_ERROR("In-place encryption needs the Gcm or Ccm mode");
+        return false;
     }
-    catch (const std::exception& e)
+    auto it = m_context->keys.find(keyId);
+    if (it == m_context->keys.end())
     {
-        NS_LOG_ERROR("Standard decryption error: " << e.what());
-        return {};
+        NS_LOG_ERROR("No key installed with ID " << +keyId);
+        return false;
     }
+
+    try {
+        m_context->NextIv(m_ivSource, m_rng, *it->second, nonce, AEAD_NONCE_SIZE);
+        it->second->Seal(m_mode, data, size, nonce, tag, aad, aadSize);
+        return true;
+    }
+    catch (const CryptoPP::Exception& e)
+    {
+        NS_LOG_ERROR("Crypto++ encryption error: " << e.what());
+        return false;
+    }
+}
+
+bool CryptoSim::DecryptInPlace(uint8_t keyId,
+                               uint8_t* data,
+                               size_t size,
+                               const uint8_t* nonce,
+                               const uint8_t* tag,
+                               const uint8_t* aad,
+                               size_t aadSize)
+{
+    NS_LOG_FUNCTION(this << +keyId << size);
+
+    if (m_mode == MODE_CBC)
+    {
+        NS_LOG_ERROR("In-place decryption needs the Gcm or Ccm mode");
+        return false;
+    }
+    auto it = m_context->keys.find(keyId);
+    if (it == m_context->keys.end())
+    {
+        NS_LOG_ERROR("No key installed with ID " << +keyId);
+        return false;
+    }
+
+    try {
+        if (!it->second->Open(m_mode, data, size, nonce, tag, aad, aadSize))
+        {
+            NS_LOG_WARN("Authentication of the encrypted data failed");
+            return false;
+        }
+        return true;
+    }
+    catch (const CryptoPP::Exception& e)
+    {
+        NS_LOG_ERROR("Crypto++ decryption error: " << e.what());
+        return false;
+    }
+}
+
+uint32_t CryptoSim::GetIvSize() const
+{
+    return m_mode == MODE_CBC ? static_cast<uint32_t>(CryptoPP::AES::BLOCKSIZE) : AEAD_NONCE_SIZE;
+}
+
+uint32_t CryptoSim::GetTagSize() const
+{
+    return m_mode == MODE_CBC ? 0 : AEAD_TAG_SIZE;
+}
+
+size_t CryptoSim::GetKeyFieldSize() const
+{
+    return m_keyMode == KEY_PRESHARED ? 1 : CryptoPP::AES::DEFAULT_KEYLENGTH;
 }
 
 } // namespace ns3
\ No newline at end of file
@@ -2,6 +2,10 @@
 #define CRYPTO_SIM_H
 
 #include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+#include <memory>
 #include <string>
 #include <vector>
 #include <cstdint> // Required for uint8_t
@@ -10,10 +14,70 @@ namespace ns3 {
 
 /**
  * @brief An ns-3 object that integrates cryptographic functionality using Crypto++.
+ *
+ * Keys are installed with SetKey() or generated with Rekey(), and are
+ * identified by a one-byte key ID. Each installed key keeps its expanded AES
+ * key schedule and its cipher objects for the lifetime of the object, and
+ * the random number generator is seeded once, so encrypting a packet only
+ * costs a fresh IV and the block operations. When no key has been installed,
+ * the first Encrypt() generates one.
+ *
+ * The KeyMode attribute selects how the receiver learns the key. By default
+ * every output carries it (key + IV + ciphertext), so anyone can decrypt it.
+ * With KEY_PRESHARED both ends install the same keys out of band, for
+ * instance with CryptoSimHelper::InstallPairKey(), and the output carries
+ * only the one-byte key ID (key ID + IV + ciphertext), 15 bytes less per
+ * message.
+ *
+ * The Mode attribute selects the cipher mode. CBC pads the message to whole
+ * blocks and does not detect tampering. GCM and CCM (AEAD modes) keep the
+ * message length, use a 12-byte nonce instead of the 16-byte IV, and
+ * authenticate the message together with the key field through a 16-byte
+ * tag; EncryptInPlace() and DecryptInPlace() expose them over a caller
+ * buffer with the tag kept apart.
+ *
+ * Besides the vector methods, Encrypt() and Decrypt() work over caller-owned
+ * buffers, in place if wanted, and EncryptPacket() and DecryptPacket()
+ * transform ns3::Packet payloads behind a CryptoHeader. Both run the cipher
+ * over the data where it lies instead of through Crypto++ filters.
+ *
+ * The IvSource attribute selects where IVs and nonces come from. The
+ * default draws them from the operating system. Counter and Stream derive
+ * them from an ns-3 random variable stream (see AssignStreams()) without a
+ * system call, so a run is reproducible from its seed and run number.
  */
 class CryptoSim : public Object
 {
 public:
+  /**
+   * @brief How the receiver learns the key of a message.
+   */
+  enum KeyMode
+  {
+    KEY_EMBEDDED = 0,  ///< The output starts with the 16-byte key
+    KEY_PRESHARED = 1  ///< The output starts with the ID of a key both ends have
+  };
+
+  /**
+   * @brief AES cipher modes.
+   */
+  enum Mode
+  {
+    MODE_CBC = 0,  ///< CBC with PKCS #7 padding, no integrity check
+    MODE_GCM = 1,  ///< Galois/Counter Mode, authenticated
+    MODE_CCM = 2   ///< Counter with CBC-MAC, authenticated
+  };
+
+  /**
+   * @brief Sources of IVs and nonces.
+   */
+  enum IvSource
+  {
+    IV_RANDOM = 0,   ///< Operating system randomness
+    IV_COUNTER = 1,  ///< Sender prefix and message counter, encrypted with the key in CBC
+    IV_STREAM = 2    ///< splitmix64 generator seeded from an ns-3 random variable stream, encrypted with the key in CBC
+  };
+
   static TypeId GetTypeId(void);
   CryptoSim();
   ~CryptoSim();
@@ -24,26 +88,278 @@ public:
   std::string GetVersion();
 
   /**
-   * @brief Encrypts data using AES encryption in CBC mode.
+   * @brief Installs a key and makes it the one Encrypt() uses.
+   *
+   * A key already installed under the same ID is replaced.
+   *
+   * @param keyId ID of the key.
+   * @param key AES key of 16, 24 or 32 bytes; only 16-byte keys can be
+   * used with KEY_EMBEDDED.
+   * @return false if the key has the wrong length
+   */
+  bool SetKey(uint8_t keyId, const std::vector<uint8_t>& key);
+
+  /**
+   * @brief Makes an installed key the one Encrypt() uses.
+   *
+   * @param keyId ID of the key.
+   * @return false if no key is installed under keyId
+   */
+  bool SelectKey(uint8_t keyId);
+
+  /**
+   * @brief Replaces the current key with a new random one.
+   *
+   * The new key is installed under the first free ID following the last
+   * selected one (wrapping after 255, or 0 if no key is installed) and
+   * selected. Installed keys, including pre-shared ones, are never
+   * replaced, so data encrypted before the rekey can still be decrypted.
+   *
+   * @return The ID of the new key, or -1 if all 256 IDs are in use
+   */
+  int Rekey();
+
+  /**
+   * @brief Uninstalls a key; if it was selected, no key is selected anymore.
+   */
+  void RemoveKey(uint8_t keyId);
+
+  /**
+   * @brief Whether a key is installed under keyId.
+   */
+  bool HasKey(uint8_t keyId) const;
+
+  /**
+   * @brief Gets the ID of the key Encrypt() uses.
+   *
+   * Only meaningful while a key is selected.
+   */
+  uint8_t GetKeyId() const;
+
+  /**
+   * @brief Generates random key bytes.
+   *
+   * @param size Key length in bytes.
+   */
+  std::vector<uint8_t> GenerateKey(size_t size);
+
+  /**
+   * @brief Gets the bytes of an installed key, for sharing it with a peer.
+   *
+   * @return The key, or an empty vector if no key is installed under keyId
+   */
+  std::vector<uint8_t> GetKey(uint8_t keyId) const;
+
+  /**
+   * @brief Assigns a fixed random variable stream to the Counter and Stream IV sources.
+   *
+   * Without it, the stream is assigned automatically from the global seed
+   * and run number. The sources are seeded when they issue their first IV
+   * and never reseeded, so that nonces cannot repeat under a key; call this
+   * before encrypting.
+   *
+   * @param stream First stream index to use.
+   * @return The number of stream indices assigned (1)
+   */
+  int64_t AssignStreams(int64_t stream);
+
+  /**
+   * @brief Encrypts data using AES encryption in the mode set by the Mode attribute.
+   *
+   * Uses the selected key.
    *
    * @param inputData A vector of bytes to be encrypted.
-   * @return A vector of bytes containing the encrypted data (key + iv + ciphertext).
-   * Returns an empty vector on failure.
+   * @return A vector of bytes containing the encrypted data (key or key ID + iv + ciphertext,
+   * followed by the tag in the AEAD modes). Returns an empty vector on failure.
    */
   std::vector<uint8_t> Encrypt(const std::vector<uint8_t>& inputData);
 
   /**
-   * @brief Decrypts data using AES decryption in CBC mode.
+   * @brief Encrypts data with a given key, such as the one shared with a peer.
+   *
+   * @param inputData A vector of bytes to be encrypted.
+   * @param keyId ID of an installed key.
+   * @return A vector of bytes containing the encrypted data (key or key ID + iv + ciphertext,
+   * followed by the tag in the AEAD modes). Returns an empty vector on failure.
+   */
+  std::vector<uint8_t> Encrypt(const std::vector<uint8_t>& inputData, uint8_t keyId);
+
+  /**
+   * @brief Decrypts data using AES decryption in the mode set by the Mode attribute.
+   *
+   * Keys installed on this object, and the last key seen in the input,
+   * are decrypted with their existing key schedules. With KEY_PRESHARED
+   * the key ID in the input must name an installed key.
    *
-   * @param encryptedData A vector of bytes to be decrypted (key + iv + ciphertext).
+   * @param encryptedData A vector of bytes to be decrypted (key or key ID + iv + ciphertext).
    * @return A vector of bytes containing the original, decrypted data.
-   * Returns an empty vector on failure.
+   * Returns an empty vector on failure, including a tag mismatch in the AEAD modes.
    */
   std::vector<uint8_t> Decrypt(const std::vector<uint8_t>& encryptedData);
 
+  /**
+   * @brief Encrypts data into a caller-owned buffer with the selected key.
+   *
+   * Produces the same bytes as Encrypt(const std::vector<uint8_t>&) without
+   * allocating: the message is moved into place once and encrypted there.
+   * output may be the input buffer itself, provided it has room for
+   * GetEncryptedSize(inputSize) bytes.
+   *
+   * @param input Bytes to be encrypted.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of bytes written, or -1 on failure (including an
+   * output buffer that is too small)
+   */
+  int64_t Encrypt(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity);
+
+  /**
+   * @brief Encrypts data into a caller-owned buffer with a given key.
+   *
+   * @param input Bytes to be encrypted.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer, possibly the input buffer itself.
+   * @param outputCapacity Size of the destination buffer.
+   * @param keyId ID of an installed key.
+   * @return The number of bytes written, or -1 on failure
+   */
+  int64_t Encrypt(const uint8_t* input,
+                  size_t inputSize,
+                  uint8_t* output,
+                  size_t outputCapacity,
+                  uint8_t keyId);
+
+  /**
+   * @brief Decrypts data into a caller-owned buffer.
+   *
+   * The counterpart of the raw Encrypt(); output may be the input buffer
+   * itself, and needs room for the ciphertext, which is decrypted in place.
+   *
+   * @param input Bytes produced by Encrypt().
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of plaintext bytes, or -1 on failure; output is then unspecified
+   */
+  int64_t Decrypt(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity);
+
+  /**
+   * @brief Size of the output of Encrypt() for inputSize bytes in the current modes.
+   */
+  size_t GetEncryptedSize(size_t inputSize) const;
+
+  /**
+   * @brief Encrypts the whole content of a packet with the selected key and prepends a CryptoHeader.
+   *
+   * The header carries the key or key ID, the IV or nonce and, in the AEAD
+   * modes, the tag, which also covers the key field. The content is copied
+   * out of the packet once into a buffer kept across calls and encrypted
+   * there. Packet tags are preserved; byte tags on the original content are not.
+   *
+   * @param packet The packet to transform in place.
+   * @return true on success; on failure the packet is left unchanged
+   */
+  bool EncryptPacket(Ptr<Packet> packet);
+
+  /**
+   * @brief Encrypts the whole content of a packet with a given key.
+   *
+   * @param packet The packet to transform in place.
+   * @param keyId ID of an installed key.
+   * @return true on success; on failure the packet is left unchanged
+   */
+  bool EncryptPacket(Ptr<Packet> packet, uint8_t keyId);
+
+  /**
+   * @brief Removes the CryptoHeader from a packet and restores its original content.
+   *
+   * The mode and the way the key is given are read from the header, not
+   * from the attributes, except that with KEY_PRESHARED a header carrying
+   * its own key is rejected.
+   *
+   * @param packet A packet transformed by EncryptPacket().
+   * @return true on success; on failure, including a tag mismatch, the packet is left unchanged
+   */
+  bool DecryptPacket(Ptr<Packet> packet);
+
+  /**
+   * @brief Encrypts a buffer in place with a GCM or CCM mode.
+   *
+   * @param keyId ID of an installed key.
+   * @param data The data, replaced by the ciphertext of the same size.
+   * @param size Number of bytes of data.
+   * @param nonce Receives the fresh nonce, GetIvSize() bytes.
+   * @param tag Receives the tag, GetTagSize() bytes.
+   * @param aad Additional data authenticated with the message but not
+   * encrypted, such as a header; may be nullptr.
+   * @param aadSize Number of bytes of aad.
+   * @return false in the CBC mode, with an unknown key or on a Crypto++ error
+   */
+  bool EncryptInPlace(uint8_t keyId,
+                      uint8_t* data,
+                      size_t size,
+                      uint8_t* nonce,
+                      uint8_t* tag,
+                      const uint8_t* aad = nullptr,
+                      size_t aadSize = 0);
+
+  /**
+   * @brief Decrypts a buffer in place with a GCM or CCM mode.
+   *
+   * @param keyId ID of an installed key.
+   * @param data The ciphertext, replaced by the plaintext of the same size.
+   * @param size Number of bytes of data.
+   * @param nonce The nonce EncryptInPlace() produced.
+   * @param tag The tag EncryptInPlace() produced.
+   * @param aad The additional data given to EncryptInPlace().
+   * @param aadSize Number of bytes of aad.
+   * @return false if anything was altered (data is then unspecified), in the
+   * CBC mode, or with an unknown key
+   */
+  bool DecryptInPlace(uint8_t keyId,
+                      uint8_t* data,
+                      size_t size,
+                      const uint8_t* nonce,
+                      const uint8_t* tag,
+                      const uint8_t* aad = nullptr,
+                      size_t aadSize = 0);
+
+  /**
+   * @brief Size of the IV (CBC) or nonce (GCM, CCM) of the current mode.
+   */
+  uint32_t GetIvSize() const;
+
+  /**
+   * @brief Size of the authentication tag of the current mode, 0 for CBC.
+   */
+  uint32_t GetTagSize() const;
+
+protected:
+  void DoDispose() override;
+
 private:
-  std::vector<uint8_t> m_key;  // Store the last used key for decryption
-  std::vector<uint8_t> m_iv;   // Store the last used IV for decryption
+  /// Crypto++ state: the random number generator and the installed keys' cipher objects
+  struct CryptoContext;
+
+  /**
+   * @brief Size of the key or key ID at the start of the output.
+   */
+  size_t GetKeyFieldSize() const;
+
+  /**
+   * @brief Makes sure a key is selected, generating one unless keys are pre-shared.
+   */
+  bool EnsureKey();
+
+  std::unique_ptr<CryptoContext> m_context;  ///< Crypto++ state, kept across calls
+  KeyMode m_keyMode;                         ///< How the receiver learns the key
+  Mode m_mode;                               ///< Cipher mode
+  IvSource m_ivSource;                       ///< Where IVs and nonces come from
+  Ptr<UniformRandomVariable> m_rng;          ///< Seeds the Counter and Stream IV sources
+  bool m_hasKey;                             ///< Whether a key is selected
+  uint8_t m_keyId;                           ///< ID of the selected key
+  std::vector<uint8_t> m_buffer;             ///< Scratch buffer of the packet methods
 };
 
 } // namespace ns3
@@ -0,0 +1,988 @@
+// Include header files from the module to test
+#include "ns3/crypto-header.h"
+#include "ns3/crypto-sim-helper.h"
+#include "ns3/crypto-sim.h"
+
+// An essential include is test.h
+#include "ns3/test.h"
+#include "ns3/enum.h"
+#include "ns3/node-container.h"
+#include "ns3/packet.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+// Do not put your test classes in namespace ns3. You may find it useful
+// to use the using directive to access the ns3 namespace directly
+using namespace ns3;
+
+// Add a doxygen group for tests.
+/**
+ * @defgroup crypto-sim-tests Tests for crypto-sim
+ * @ingroup crypto-sim
+ * @ingroup tests
+ */
+
+/**
+ * @ingroup crypto-sim-tests
+ * Generates a message, the same for every call with the same size and seed.
+ *
+ * @param size Number of bytes.
+ * @param seed Changes the bytes.
+ * @return The message
+ */
+static std::vector<uint8_t>
+MakeMessage(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        data[i] = static_cast<uint8_t>(i * 31 + seed);
+    }
+    return data;
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for the key schedules kept across calls and rekeys
+ */
+class CryptoSimKeyScheduleTestCase : public TestCase
+{
+public:
+    CryptoSimKeyScheduleTestCase();
+    ~CryptoSimKeyScheduleTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimKeyScheduleTestCase::CryptoSimKeyScheduleTestCase()
+    : TestCase("CryptoSim reuses its key schedules across calls and rekeys")
+{
+}
+
+CryptoSimKeyScheduleTestCase::~CryptoSimKeyScheduleTestCase()
+{
+}
+
+void
+CryptoSimKeyScheduleTestCase::DoRun()
+{
+    Ptr<CryptoSim> sender = CreateObject<CryptoSim>();
+    Ptr<CryptoSim> receiver = CreateObject<CryptoSim>();
+
+    // The first Encrypt() generates a key under ID 0
+    std::vector<uint8_t> message = MakeMessage(100, 1);
+    std::vector<uint8_t> first = sender->Encrypt(message);
+    NS_TEST_ASSERT_MSG_EQ(sender->HasKey(0), true, "No key generated on the first Encrypt()");
+    NS_TEST_ASSERT_MSG_EQ(first.size(), 16 + 16 + 112, "Wrong size of key + IV + ciphertext");
+    NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(first) == message), true, "Round trip failed");
+
+    // Many calls of every padding length run through the same schedules
+    for (size_t size = 1; size <= 80; size++)
+    {
+        std::vector<uint8_t> input = MakeMessage(size, static_cast<uint8_t>(size));
+        std::vector<uint8_t> encrypted = sender->Encrypt(input);
+        NS_TEST_ASSERT_MSG_EQ(encrypted.size() % 16, 0, "Ciphertext not padded to whole blocks");
+        NS_TEST_ASSERT_MSG_EQ((sender->Decrypt(encrypted) == input),
+                              true,
+                              "Round trip on the sender failed");
+        NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(encrypted) == input),
+                              true,
+                              "Round trip on the receiver failed");
+    }
+
+    // A rekey installs a new key and keeps the old one
+    std::vector<uint8_t> key = sender->GetKey(0);
+    NS_TEST_ASSERT_MSG_EQ(sender->Rekey(), 1, "Rekey did not take the next free ID");
+    NS_TEST_ASSERT_MSG_EQ(sender->GetKeyId(), 1, "Rekey did not select the new key");
+    NS_TEST_ASSERT_MSG_EQ((sender->GetKey(0) == key), true, "Rekey replaced the old key");
+    NS_TEST_ASSERT_MSG_EQ((sender->GetKey(1) != key), true, "Rekey reused the old key");
+    std::vector<uint8_t> second = sender->Encrypt(message);
+    NS_TEST_ASSERT_MSG_EQ((std::equal(key.begin(), key.end(), second.begin())),
+                          false,
+                          "Encrypt() still uses the old key");
+    NS_TEST_ASSERT_MSG_EQ((sender->Decrypt(first) == message),
+                          true,
+                          "Data encrypted before the rekey no longer decrypts");
+    NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(second) == message),
+                          true,
+                          "Data encrypted after the rekey does not decrypt");
+
+    // Rekey skips IDs that are in use
+    NS_TEST_ASSERT_MSG_EQ(sender->SetKey(3, MakeMessage(16, 3)), true, "SetKey failed");
+    NS_TEST_ASSERT_MSG_EQ(sender->SelectKey(1), true, "SelectKey failed");
+    NS_TEST_ASSERT_MSG_EQ(sender->SetKey(2, MakeMessage(16, 2)), true, "SetKey failed");
+    NS_TEST_ASSERT_MSG_EQ(sender->Rekey(), 4, "Rekey replaced an installed key");
+    NS_TEST_ASSERT_MSG_EQ((sender->GetKey(2) == MakeMessage(16, 2)), true, "Key 2 was replaced");
+    NS_TEST_ASSERT_MSG_EQ((sender->GetKey(3) == MakeMessage(16, 3)), true, "Key 3 was replaced");
+
+    // Replacing a key under the same ID rebuilds its schedule
+    NS_TEST_ASSERT_MSG_EQ(sender->SetKey(2, MakeMessage(16, 7)), true, "SetKey failed");
+    std::vector<uint8_t> encrypted = sender->Encrypt(message, 2);
+    NS_TEST_ASSERT_MSG_EQ((std::vector<uint8_t>(encrypted.begin(), encrypted.begin() + 16) ==
+                           MakeMessage(16, 7)),
+                          true,
+                          "Encrypt() used the replaced key");
+    NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(encrypted) == message), true, "Round trip failed");
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for the errors of the key management methods
+ */
+class CryptoSimKeyErrorTestCase : public TestCase
+{
+public:
+    CryptoSimKeyErrorTestCase();
+    ~CryptoSimKeyErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimKeyErrorTestCase::CryptoSimKeyErrorTestCase()
+    : TestCase("CryptoSim rejects bad keys and key IDs")
+{
+}
+
+CryptoSimKeyErrorTestCase::~CryptoSimKeyErrorTestCase()
+{
+}
+
+void
+CryptoSimKeyErrorTestCase::DoRun()
+{
+    Ptr<CryptoSim> crypto = CreateObject<CryptoSim>();
+    std::vector<uint8_t> message = MakeMessage(40, 1);
+
+    NS_TEST_ASSERT_MSG_EQ(crypto->SetKey(1, MakeMessage(15, 1)), false, "Accepted a 15-byte key");
+    NS_TEST_ASSERT_MSG_EQ(crypto->SetKey(1, std::vector<uint8_t>()), false, "Accepted no key");
+    NS_TEST_ASSERT_MSG_EQ(crypto->HasKey(1), false, "A rejected key was installed");
+    NS_TEST_ASSERT_MSG_EQ(crypto->SelectKey(1), false, "Selected a missing key");
+    NS_TEST_ASSERT_MSG_EQ(crypto->GetKey(1).size(), 0, "Got the bytes of a missing key");
+    NS_TEST_ASSERT_MSG_EQ(crypto->Encrypt(message, 1).size(), 0, "Encrypted with a missing key");
+
+    // Only 16-byte keys fit in the output in the Embedded key mode
+    NS_TEST_ASSERT_MSG_EQ(crypto->SetKey(1, MakeMessage(32, 1)), true, "Rejected a 32-byte key");
+    NS_TEST_ASSERT_MSG_EQ(crypto->Encrypt(message).size(), 0, "Embedded a 32-byte key");
+
+    // A removed key can no longer be used
+    NS_TEST_ASSERT_MSG_EQ(crypto->SetKey(2, MakeMessage(16, 2)), true, "SetKey failed");
+    std::vector<uint8_t> encrypted = crypto->Encrypt(message);
+    crypto->RemoveKey(2);
+    NS_TEST_ASSERT_MSG_EQ(crypto->HasKey(2), false, "RemoveKey left the key installed");
+    NS_TEST_ASSERT_MSG_EQ(crypto->Encrypt(message, 2).size(), 0, "Encrypted with a removed key");
+    NS_TEST_ASSERT_MSG_EQ((crypto->Decrypt(encrypted) == message),
+                          true,
+                          "An embedded key must not need to be installed");
+
+    // Truncated and empty input
+    std::vector<uint8_t> noCiphertext(encrypted.begin(), encrypted.begin() + 32);
+    std::vector<uint8_t> partialBlock(encrypted.begin(), encrypted.end() - 1);
+    NS_TEST_ASSERT_MSG_EQ(crypto->Decrypt(std::vector<uint8_t>()).size(), 0, "Decrypted no data");
+    NS_TEST_ASSERT_MSG_EQ(crypto->Decrypt(noCiphertext).size(),
+                          0,
+                          "Decrypted a message without ciphertext");
+    NS_TEST_ASSERT_MSG_EQ(crypto->Decrypt(partialBlock).size(), 0, "Decrypted a partial block");
+    NS_TEST_ASSERT_MSG_EQ(crypto->Encrypt(std::vector<uint8_t>()).size(), 0, "Encrypted no data");
+
+    // Rekey fails once all 256 IDs are in use
+    for (int keyId = 0; keyId < 256; keyId++)
+    {
+        crypto->SetKey(static_cast<uint8_t>(keyId), MakeMessage(16, static_cast<uint8_t>(keyId)));
+    }
+    NS_TEST_ASSERT_MSG_EQ(crypto->Rekey(), -1, "Rekey replaced an installed key");
+    for (int keyId = 0; keyId < 256; keyId++)
+    {
+        NS_TEST_ASSERT_MSG_EQ((crypto->GetKey(static_cast<uint8_t>(keyId)) ==
+                               MakeMessage(16, static_cast<uint8_t>(keyId))),
+                              true,
+                              "A failed rekey replaced key " << keyId);
+    }
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for keys installed on both ends out of band
+ */
+class CryptoSimPreSharedKeyTestCase : public TestCase
+{
+public:
+    CryptoSimPreSharedKeyTestCase();
+    ~CryptoSimPreSharedKeyTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimPreSharedKeyTestCase::CryptoSimPreSharedKeyTestCase()
+    : TestCase("CryptoSim sends only the key ID of pre-shared keys")
+{
+}
+
+CryptoSimPreSharedKeyTestCase::~CryptoSimPreSharedKeyTestCase()
+{
+}
+
+void
+CryptoSimPreSharedKeyTestCase::DoRun()
+{
+    Ptr<CryptoSim> sender = CreateObject<CryptoSim>();
+    Ptr<CryptoSim> receiver = CreateObject<CryptoSim>();
+    sender->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+    receiver->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+
+    // Any AES key length works, as the key is not in the output
+    std::vector<uint8_t> message = MakeMessage(100, 1);
+    for (size_t keySize : {16, 24, 32})
+    {
+        uint8_t keyId = static_cast<uint8_t>(keySize);
+        std::vector<uint8_t> key = MakeMessage(keySize, keyId);
+        NS_TEST_ASSERT_MSG_EQ(sender->SetKey(keyId, key), true, "SetKey failed on the sender");
+        NS_TEST_ASSERT_MSG_EQ(receiver->SetKey(keyId, key), true, "SetKey failed on the receiver");
+
+        std::vector<uint8_t> encrypted = sender->Encrypt(message);
+        NS_TEST_ASSERT_MSG_EQ(encrypted.size(),
+                              1 + 16 + 112,
+                              "Wrong size of key ID + IV + ciphertext");
+        NS_TEST_ASSERT_MSG_EQ(+encrypted[0], +keyId, "The output does not start with the key ID");
+        NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(encrypted) == message), true, "Round trip failed");
+    }
+
+    // Each message names its key, so the receiver needs no selected key
+    std::vector<uint8_t> encrypted = sender->Encrypt(message, 16);
+    NS_TEST_ASSERT_MSG_EQ(+encrypted[0], 16, "Encrypt() did not use the given key");
+    receiver->RemoveKey(32);
+    NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(encrypted) == message),
+                          true,
+                          "Round trip with a key that is not selected failed");
+
+    // The helper installs the same key under the same ID on both nodes
+    Ptr<Node> a = CreateObject<Node>();
+    Ptr<Node> b = CreateObject<Node>();
+    Ptr<Node> c = CreateObject<Node>();
+    uint8_t ab = CryptoSimHelper::InstallPairKey(a, b);
+    uint8_t ac = CryptoSimHelper::InstallPairKey(a, c, MakeMessage(32, 5));
+    Ptr<CryptoSim> cryptoA = a->GetObject<CryptoSim>();
+    Ptr<CryptoSim> cryptoB = b->GetObject<CryptoSim>();
+    Ptr<CryptoSim> cryptoC = c->GetObject<CryptoSim>();
+    NS_TEST_ASSERT_MSG_NE(+ab, +ac, "Two pairs share a key ID on the same node");
+    NS_TEST_ASSERT_MSG_EQ((cryptoA->GetKey(ab) == cryptoB->GetKey(ab)), true, "Keys differ");
+    NS_TEST_ASSERT_MSG_EQ((cryptoC->GetKey(ac) == MakeMessage(32, 5)), true, "Wrong key installed");
+    NS_TEST_ASSERT_MSG_EQ((cryptoB->Decrypt(cryptoA->Encrypt(message, ab)) == message),
+                          true,
+                          "Round trip from a to b failed");
+    NS_TEST_ASSERT_MSG_EQ((cryptoA->Decrypt(cryptoB->Encrypt(message, ab)) == message),
+                          true,
+                          "Round trip from b to a failed");
+    NS_TEST_ASSERT_MSG_EQ((cryptoC->Decrypt(cryptoA->Encrypt(message, ac)) == message),
+                          true,
+                          "Round trip from a to c failed");
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for messages whose pre-shared key is missing or wrong
+ */
+class CryptoSimPreSharedKeyErrorTestCase : public TestCase
+{
+public:
+    CryptoSimPreSharedKeyErrorTestCase();
+    ~CryptoSimPreSharedKeyErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimPreSharedKeyErrorTestCase::CryptoSimPreSharedKeyErrorTestCase()
+    : TestCase("CryptoSim rejects messages without a matching pre-shared key")
+{
+}
+
+CryptoSimPreSharedKeyErrorTestCase::~CryptoSimPreSharedKeyErrorTestCase()
+{
+}
+
+void
+CryptoSimPreSharedKeyErrorTestCase::DoRun()
+{
+    Ptr<CryptoSim> sender = CreateObject<CryptoSim>();
+    Ptr<CryptoSim> receiver = CreateObject<CryptoSim>();
+    sender->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+    receiver->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+    std::vector<uint8_t> message = MakeMessage(100, 1);
+
+    // No key is generated behind the receiver's back
+    NS_TEST_ASSERT_MSG_EQ(sender->Encrypt(message).size(), 0, "Encrypted without a selected key");
+    NS_TEST_ASSERT_MSG_EQ(sender->HasKey(0), false, "Generated a key that no peer has");
+
+    sender->SetKey(1, MakeMessage(16, 1));
+    std::vector<uint8_t> encrypted = sender->Encrypt(message);
+    NS_TEST_ASSERT_MSG_EQ(receiver->Decrypt(encrypted).size(), 0, "Decrypted with a missing key");
+
+    // A different key under the same ID does not give the message back
+    receiver->SetKey(1, MakeMessage(16, 2));
+    NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(encrypted) == message),
+                          false,
+                          "Decrypted with the wrong key");
+
+    // Both ends must use the same key mode
+    Ptr<CryptoSim> embedded = CreateObject<CryptoSim>();
+    embedded->SetKey(1, MakeMessage(16, 1));
+    NS_TEST_ASSERT_MSG_EQ((embedded->Decrypt(encrypted) == message),
+                          false,
+                          "Decrypted a key ID as an embedded key");
+    NS_TEST_ASSERT_MSG_EQ((sender->Decrypt(embedded->Encrypt(message)) == message),
+                          false,
+                          "Decrypted an embedded key as a key ID");
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for round trips in the GCM and CCM modes
+ */
+class CryptoSimAeadTestCase : public TestCase
+{
+public:
+    CryptoSimAeadTestCase();
+    ~CryptoSimAeadTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimAeadTestCase::CryptoSimAeadTestCase()
+    : TestCase("CryptoSim round-trips messages in the Gcm and Ccm modes")
+{
+}
+
+CryptoSimAeadTestCase::~CryptoSimAeadTestCase()
+{
+}
+
+void
+CryptoSimAeadTestCase::DoRun()
+{
+    for (CryptoSim::Mode mode : {CryptoSim::MODE_GCM, CryptoSim::MODE_CCM})
+    {
+        Ptr<CryptoSim> sender = CreateObject<CryptoSim>();
+        Ptr<CryptoSim> receiver = CreateObject<CryptoSim>();
+        sender->SetAttribute("Mode", EnumValue(mode));
+        receiver->SetAttribute("Mode", EnumValue(mode));
+        NS_TEST_ASSERT_MSG_EQ(sender->GetIvSize(), 12, "Wrong nonce size in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ(sender->GetTagSize(), 16, "Wrong tag size in mode " << mode);
+
+        // The ciphertext keeps the message length
+        for (size_t size : {1, 15, 16, 100, 1500})
+        {
+            std::vector<uint8_t> message = MakeMessage(size, static_cast<uint8_t>(size));
+            std::vector<uint8_t> encrypted = sender->Encrypt(message);
+            NS_TEST_ASSERT_MSG_EQ(encrypted.size(),
+                                  16 + 12 + size + 16,
+                                  "Wrong size of key + nonce + ciphertext + tag in mode " << mode);
+            NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(encrypted) == message),
+                                  true,
+                                  "Round trip failed in mode " << mode);
+        }
+
+        // Pre-shared keys are authenticated through the key ID
+        sender->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+        receiver->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+        receiver->SetKey(0, sender->GetKey(0));
+        std::vector<uint8_t> message = MakeMessage(100, 1);
+        std::vector<uint8_t> encrypted = sender->Encrypt(message);
+        NS_TEST_ASSERT_MSG_EQ(encrypted.size(), 1 + 12 + 100 + 16, "Wrong size in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(encrypted) == message),
+                              true,
+                              "Pre-shared round trip failed in mode " << mode);
+    }
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for altered messages in the GCM and CCM modes
+ */
+class CryptoSimAeadTamperTestCase : public TestCase
+{
+public:
+    CryptoSimAeadTamperTestCase();
+    ~CryptoSimAeadTamperTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimAeadTamperTestCase::CryptoSimAeadTamperTestCase()
+    : TestCase("CryptoSim rejects altered messages in the Gcm and Ccm modes")
+{
+}
+
+CryptoSimAeadTamperTestCase::~CryptoSimAeadTamperTestCase()
+{
+}
+
+void
+CryptoSimAeadTamperTestCase::DoRun()
+{
+    for (CryptoSim::Mode mode : {CryptoSim::MODE_GCM, CryptoSim::MODE_CCM})
+    {
+        Ptr<CryptoSim> sender = CreateObject<CryptoSim>();
+        Ptr<CryptoSim> receiver = CreateObject<CryptoSim>();
+        sender->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+        receiver->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+        sender->SetAttribute("Mode", EnumValue(mode));
+        receiver->SetAttribute("Mode", EnumValue(mode));
+        sender->SetKey(1, MakeMessage(16, 1));
+        sender->SetKey(2, MakeMessage(16, 2));
+        receiver->SetKey(1, MakeMessage(16, 1));
+        receiver->SetKey(2, MakeMessage(16, 2));
+
+        std::vector<uint8_t> message = MakeMessage(100, 1);
+        std::vector<uint8_t> encrypted = sender->Encrypt(message, 1);
+        NS_TEST_ASSERT_MSG_EQ((receiver->Decrypt(encrypted) == message),
+                              true,
+                              "Round trip failed in mode " << mode);
+
+        // Flipping any bit of the key ID, nonce, ciphertext or tag fails the tag check
+        for (size_t i = 0; i < encrypted.size(); i++)
+        {
+            std::vector<uint8_t> corrupted = encrypted;
+            corrupted[i] ^= 0x10;
+            NS_TEST_ASSERT_MSG_EQ(receiver->Decrypt(corrupted).size(),
+                                  0,
+                                  "Accepted a change of byte " << i << " in mode " << mode);
+        }
+        std::vector<uint8_t> corruptedTag = encrypted;
+        corruptedTag.back() ^= 0x01;
+        NS_TEST_ASSERT_MSG_EQ(receiver->Decrypt(corruptedTag).size(),
+                              0,
+                              "Accepted a corrupted tag in mode " << mode);
+
+        // So does a truncated tag or a message for the other mode
+        std::vector<uint8_t> truncated(encrypted.begin(), encrypted.end() - 1);
+        NS_TEST_ASSERT_MSG_EQ(receiver->Decrypt(truncated).size(),
+                              0,
+                              "Accepted a truncated tag in mode " << mode);
+        Ptr<CryptoSim> other = CreateObject<CryptoSim>();
+        other->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+        other->SetAttribute("Mode",
+                            EnumValue(mode == CryptoSim::MODE_GCM ? CryptoSim::MODE_CCM
+                                                                  : CryptoSim::MODE_GCM));
+        other->SetKey(1, MakeMessage(16, 1));
+        NS_TEST_ASSERT_MSG_EQ(other->Decrypt(encrypted).size(),
+                              0,
+                              "Accepted a message of another mode in mode " << mode);
+    }
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for EncryptInPlace() and DecryptInPlace()
+ */
+class CryptoSimInPlaceTestCase : public TestCase
+{
+public:
+    CryptoSimInPlaceTestCase();
+    ~CryptoSimInPlaceTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimInPlaceTestCase::CryptoSimInPlaceTestCase()
+    : TestCase("CryptoSim encrypts caller buffers in place with a separate tag")
+{
+}
+
+CryptoSimInPlaceTestCase::~CryptoSimInPlaceTestCase()
+{
+}
+
+void
+CryptoSimInPlaceTestCase::DoRun()
+{
+    std::vector<uint8_t> header = MakeMessage(20, 9);
+    for (CryptoSim::Mode mode : {CryptoSim::MODE_GCM, CryptoSim::MODE_CCM})
+    {
+        Ptr<CryptoSim> crypto = CreateObject<CryptoSim>();
+        crypto->SetAttribute("Mode", EnumValue(mode));
+        crypto->SetKey(1, MakeMessage(16, 1));
+
+        std::vector<uint8_t> message = MakeMessage(200, 1);
+        std::vector<uint8_t> data = message;
+        uint8_t nonce[12];
+        uint8_t tag[16];
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->EncryptInPlace(1, data.data(), data.size(), nonce, tag, header.data(), 20),
+            true,
+            "EncryptInPlace failed in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ((data != message), true, "Data not encrypted in mode " << mode);
+
+        // Wrong additional data, a corrupted tag or a wrong key fail the tag check
+        std::vector<uint8_t> ciphertext = data;
+        std::vector<uint8_t> otherHeader = MakeMessage(20, 10);
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->DecryptInPlace(1, data.data(), data.size(), nonce, tag, otherHeader.data(), 20),
+            false,
+            "Accepted other additional data in mode " << mode);
+        data = ciphertext;
+        NS_TEST_ASSERT_MSG_EQ(crypto->DecryptInPlace(1, data.data(), data.size(), nonce, tag),
+                              false,
+                              "Accepted missing additional data in mode " << mode);
+        data = ciphertext;
+        tag[0] ^= 0x01;
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->DecryptInPlace(1, data.data(), data.size(), nonce, tag, header.data(), 20),
+            false,
+            "Accepted a corrupted tag in mode " << mode);
+        tag[0] ^= 0x01;
+        data = ciphertext;
+        crypto->SetKey(2, MakeMessage(16, 2));
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->DecryptInPlace(2, data.data(), data.size(), nonce, tag, header.data(), 20),
+            false,
+            "Accepted the wrong key in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->DecryptInPlace(3, data.data(), data.size(), nonce, tag, header.data(), 20),
+            false,
+            "Accepted a missing key in mode " << mode);
+
+        data = ciphertext;
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->DecryptInPlace(1, data.data(), data.size(), nonce, tag, header.data(), 20),
+            true,
+            "DecryptInPlace failed in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ((data == message), true, "Round trip failed in mode " << mode);
+    }
+
+    // The CBC mode has no tag to keep apart
+    Ptr<CryptoSim> cbc = CreateObject<CryptoSim>();
+    cbc->SetKey(1, MakeMessage(16, 1));
+    std::vector<uint8_t> data = MakeMessage(32, 1);
+    uint8_t nonce[16];
+    uint8_t tag[16];
+    NS_TEST_ASSERT_MSG_EQ(cbc->GetTagSize(), 0, "CBC has a tag");
+    NS_TEST_ASSERT_MSG_EQ(cbc->EncryptInPlace(1, data.data(), data.size(), nonce, tag),
+                          false,
+                          "EncryptInPlace worked in the CBC mode");
+    NS_TEST_ASSERT_MSG_EQ(cbc->DecryptInPlace(1, data.data(), data.size(), nonce, tag),
+                          false,
+                          "DecryptInPlace worked in the CBC mode");
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Copies the bytes of a packet.
+ *
+ * @param packet The packet.
+ * @return The bytes
+ */
+static std::vector<uint8_t>
+GetPacketBytes(Ptr<const Packet> packet)
+{
+    std::vector<uint8_t> data(packet->GetSize());
+    packet->CopyData(data.data(), data.size());
+    return data;
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for Encrypt() and Decrypt() over caller-owned buffers
+ */
+class CryptoSimBufferTestCase : public TestCase
+{
+public:
+    CryptoSimBufferTestCase();
+    ~CryptoSimBufferTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimBufferTestCase::CryptoSimBufferTestCase()
+    : TestCase("CryptoSim encrypts into caller buffers and in place")
+{
+}
+
+CryptoSimBufferTestCase::~CryptoSimBufferTestCase()
+{
+}
+
+void
+CryptoSimBufferTestCase::DoRun()
+{
+    for (CryptoSim::Mode mode : {CryptoSim::MODE_CBC, CryptoSim::MODE_GCM, CryptoSim::MODE_CCM})
+    {
+        Ptr<CryptoSim> crypto = CreateObject<CryptoSim>();
+        crypto->SetAttribute("Mode", EnumValue(mode));
+        crypto->SetKey(1, MakeMessage(16, 1));
+        std::vector<uint8_t> message = MakeMessage(100, 1);
+        size_t encryptedSize = crypto->Encrypt(message).size();
+
+        // Into a separate buffer, readable by the vector methods
+        std::vector<uint8_t> encrypted(encryptedSize + 10);
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->Encrypt(message.data(), message.size(), encrypted.data(), encrypted.size()),
+            static_cast<int64_t>(encryptedSize),
+            "Encrypt into a buffer failed in mode " << mode);
+        encrypted.resize(encryptedSize);
+        NS_TEST_ASSERT_MSG_EQ((crypto->Decrypt(encrypted) == message),
+                              true,
+                              "Round trip through a buffer failed in mode " << mode);
+        // The output needs room for the ciphertext, padding included
+        size_t ciphertextSize = encryptedSize - 16 - crypto->GetIvSize() - crypto->GetTagSize();
+        std::vector<uint8_t> decrypted(ciphertextSize);
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->Decrypt(encrypted.data(), encrypted.size(), decrypted.data(), decrypted.size()),
+            static_cast<int64_t>(message.size()),
+            "Decrypt into a buffer failed in mode " << mode);
+        decrypted.resize(message.size());
+        NS_TEST_ASSERT_MSG_EQ((decrypted == message), true, "Round trip failed in mode " << mode);
+
+        // In place, with the message at the start of the buffer
+        std::vector<uint8_t> buffer(encryptedSize);
+        std::copy(message.begin(), message.end(), buffer.begin());
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->Encrypt(buffer.data(), message.size(), buffer.data(), buffer.size(), 1),
+            static_cast<int64_t>(encryptedSize),
+            "Encrypt in place failed in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->Decrypt(buffer.data(), buffer.size(), buffer.data(), buffer.size()),
+            static_cast<int64_t>(message.size()),
+            "Decrypt in place failed in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ((std::equal(message.begin(), message.end(), buffer.begin())),
+                              true,
+                              "Round trip in place failed in mode " << mode);
+
+        // Buffers that are too small are refused, not overrun
+        std::vector<uint8_t> small(encryptedSize - 1);
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->Encrypt(message.data(), message.size(), small.data(), small.size()),
+            -1,
+            "Encrypted into a small buffer in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ(
+            crypto->Decrypt(encrypted.data(), encrypted.size(), small.data(), ciphertextSize - 1),
+            -1,
+            "Decrypted into a small buffer in mode " << mode);
+        NS_TEST_ASSERT_MSG_EQ(crypto->Decrypt(encrypted.data(), 20, small.data(), small.size()),
+                              -1,
+                              "Decrypted a truncated message in mode " << mode);
+    }
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for EncryptPacket() and DecryptPacket()
+ */
+class CryptoSimPacketTestCase : public TestCase
+{
+public:
+    CryptoSimPacketTestCase();
+    ~CryptoSimPacketTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimPacketTestCase::CryptoSimPacketTestCase()
+    : TestCase("CryptoSim encrypts packets behind a CryptoHeader")
+{
+}
+
+CryptoSimPacketTestCase::~CryptoSimPacketTestCase()
+{
+}
+
+void
+CryptoSimPacketTestCase::DoRun()
+{
+    for (CryptoSim::KeyMode keyMode : {CryptoSim::KEY_EMBEDDED, CryptoSim::KEY_PRESHARED})
+    {
+        for (CryptoSim::Mode mode : {CryptoSim::MODE_CBC, CryptoSim::MODE_GCM, CryptoSim::MODE_CCM})
+        {
+            Ptr<CryptoSim> sender = CreateObject<CryptoSim>();
+            Ptr<CryptoSim> receiver = CreateObject<CryptoSim>();
+            sender->SetAttribute("KeyMode", EnumValue(keyMode));
+            sender->SetAttribute("Mode", EnumValue(mode));
+            receiver->SetAttribute("KeyMode", EnumValue(keyMode));
+            sender->SetKey(4, MakeMessage(16, 4));
+            receiver->SetKey(4, MakeMessage(16, 4));
+
+            for (uint32_t size : {0, 1, 16, 1000})
+            {
+                std::vector<uint8_t> message = MakeMessage(size, 1);
+                Ptr<Packet> packet = Create<Packet>(message.data(), size);
+                NS_TEST_ASSERT_MSG_EQ(sender->EncryptPacket(packet), true, "EncryptPacket failed");
+
+                // The header tells the receiver the mode and key field
+                CryptoHeader header;
+                packet->PeekHeader(header);
+                NS_TEST_ASSERT_MSG_EQ(+header.GetMode(), +mode, "Wrong mode in the header");
+                NS_TEST_ASSERT_MSG_EQ(header.HasEmbeddedKey(),
+                                      (keyMode == CryptoSim::KEY_EMBEDDED),
+                                      "Wrong key field in the header");
+                uint32_t payloadSize = mode == CryptoSim::MODE_CBC ? (size / 16 + 1) * 16 : size;
+                NS_TEST_ASSERT_MSG_EQ(packet->GetSize(),
+                                      header.GetSerializedSize() + payloadSize,
+                                      "Wrong size of the encrypted packet");
+
+                NS_TEST_ASSERT_MSG_EQ(receiver->DecryptPacket(packet),
+                                      true,
+                                      "DecryptPacket failed in mode " << mode << " for size "
+                                                                      << size);
+                NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == message),
+                                      true,
+                                      "Round trip failed in mode " << mode << " for size " << size);
+            }
+        }
+    }
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for packets DecryptPacket() must refuse
+ */
+class CryptoSimPacketErrorTestCase : public TestCase
+{
+public:
+    CryptoSimPacketErrorTestCase();
+    ~CryptoSimPacketErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+CryptoSimPacketErrorTestCase::CryptoSimPacketErrorTestCase()
+    : TestCase("CryptoSim leaves packets it cannot decrypt unchanged")
+{
+}
+
+CryptoSimPacketErrorTestCase::~CryptoSimPacketErrorTestCase()
+{
+}
+
+void
+CryptoSimPacketErrorTestCase::DoRun()
+{
+    Ptr<CryptoSim> sender = CreateObject<CryptoSim>();
+    Ptr<CryptoSim> receiver = CreateObject<CryptoSim>();
+    sender->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+    sender->SetAttribute("Mode", EnumValue(CryptoSim::MODE_GCM));
+    receiver->SetAttribute("KeyMode", EnumValue(CryptoSim::KEY_PRESHARED));
+    sender->SetKey(1, MakeMessage(16, 1));
+    receiver->SetKey(1, MakeMessage(16, 1));
+    std::vector<uint8_t> message = MakeMessage(100, 1);
+
+    Ptr<Packet> packet = Create<Packet>(message.data(), message.size());
+    sender->EncryptPacket(packet);
+    std::vector<uint8_t> encrypted = GetPacketBytes(packet);
+
+    // The last payload byte, and the first tag byte after the flags, key ID and nonce
+    for (size_t offset : {encrypted.size() - 1, static_cast<size_t>(1 + 1 + 12)})
+    {
+        std::vector<uint8_t> corrupted = encrypted;
+        corrupted[offset] ^= 0x01;
+        Ptr<Packet> received = Create<Packet>(corrupted.data(), corrupted.size());
+        NS_TEST_ASSERT_MSG_EQ(receiver->DecryptPacket(received),
+                              false,
+                              "Accepted a change of byte " << offset);
+        NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(received) == corrupted),
+                              true,
+                              "A rejected packet was changed");
+    }
+
+    // An attacker's own key, embedded in the header, must not be trusted
+    Ptr<CryptoSim> forger = CreateObject<CryptoSim>();
+    forger->SetAttribute("Mode", EnumValue(CryptoSim::MODE_GCM));
+    forger->SetKey(1, MakeMessage(16, 2));
+    Ptr<Packet> forged = Create<Packet>(message.data(), message.size());
+    forger->EncryptPacket(forged);
+    std::vector<uint8_t> forgedBytes = GetPacketBytes(forged);
+    NS_TEST_ASSERT_MSG_EQ(receiver->DecryptPacket(forged), false, "Accepted an embedded key");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(forged) == forgedBytes), true, "Forged packet changed");
+
+    // An unknown mode, an unknown key ID and a truncated header
+    std::vector<uint8_t> unknownMode = encrypted;
+    unknownMode[0] |= CryptoHeader::MODE_MASK;
+    std::vector<uint8_t> unknownKey = encrypted;
+    unknownKey[1] = 9;
+    std::vector<uint8_t> truncated(encrypted.begin(), encrypted.begin() + 20);
+    for (const auto& bytes : {unknownMode, unknownKey, truncated, std::vector<uint8_t>()})
+    {
+        Ptr<Packet> received = Create<Packet>(bytes.data(), bytes.size());
+        NS_TEST_ASSERT_MSG_EQ(receiver->DecryptPacket(received),
+                              false,
+                              "Accepted a packet of " << bytes.size() << " bytes");
+        NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(received) == bytes), true, "Packet changed");
+    }
+
+    // The original still decrypts
+    NS_TEST_ASSERT_MSG_EQ(receiver->DecryptPacket(packet), true, "DecryptPacket failed");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == message), true, "Round trip failed");
+
+    // Sending with a missing key leaves the packet unchanged too
+    Ptr<Packet> unsent = Create<Packet>(message.data(), message.size());
+    NS_TEST_ASSERT_MSG_EQ(sender->EncryptPacket(unsent, 7), false, "Encrypted with a missing key");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(unsent) == message), true, "Unsent packet changed");
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * Test case for the IV and nonce sources
+ */
+class CryptoSimIvSourceTestCase : public TestCase
+{
+public:
+    CryptoSimIvSourceTestCase();
+    ~CryptoSimIvSourceTestCase() override;
+
+private:
+    void DoRun() override;
+
+    /**
+     * Encrypts the same messages with a fresh CryptoSim.
+     *
+     * @param mode Cipher mode.
+     * @param ivSource IV source.
+     * @param stream Stream given to AssignStreams(), or -1 for none.
+     * @return The vector and packet outputs, in order
+     */
+    std::vector<std::vector<uint8_t>> EncryptAll(CryptoSim::Mode mode,
+                                                 CryptoSim::IvSource ivSource,
+                                                 int64_t stream);
+};
+
+CryptoSimIvSourceTestCase::CryptoSimIvSourceTestCase()
+    : TestCase("CryptoSim draws unique IVs, reproducible from the stream")
+{
+}
+
+CryptoSimIvSourceTestCase::~CryptoSimIvSourceTestCase()
+{
+}
+
+std::vector<std::vector<uint8_t>>
+CryptoSimIvSourceTestCase::EncryptAll(CryptoSim::Mode mode,
+                                      CryptoSim::IvSource ivSource,
+                                      int64_t stream)
+{
+    Ptr<CryptoSim> sender = CreateObject<CryptoSim>();
+    Ptr<CryptoSim> receiver = CreateObject<CryptoSim>();
+    sender->SetAttribute("Mode", EnumValue(mode));
+    sender->SetAttribute("IvSource", EnumValue(ivSource));
+    receiver->SetAttribute("Mode", EnumValue(mode));
+    sender->SetKey(1, MakeMessage(16, 1));
+    if (stream >= 0)
+    {
+        sender->AssignStreams(stream);
+    }
+
+    std::vector<std::vector<uint8_t>> outputs;
+    std::vector<uint8_t> message = MakeMessage(40, 1);
+    for (int i = 0; i < 50; i++)
+    {
+        outputs.push_back(sender->Encrypt(message));
+        NS_TEST_EXPECT_MSG_EQ((receiver->Decrypt(outputs.back()) == message),
+                              true,
+                              "Round trip failed with IV source " << ivSource);
+    }
+    Ptr<Packet> packet = Create<Packet>(message.data(), message.size());
+    sender->EncryptPacket(packet);
+    outputs.push_back(GetPacketBytes(packet));
+    NS_TEST_EXPECT_MSG_EQ(receiver->DecryptPacket(packet),
+                          true,
+                          "Packet round trip failed with IV source " << ivSource);
+    return outputs;
+}
+
+void
+CryptoSimIvSourceTestCase::DoRun()
+{
+    for (CryptoSim::Mode mode : {CryptoSim::MODE_CBC, CryptoSim::MODE_GCM, CryptoSim::MODE_CCM})
+    {
+        // No IV repeats under the key, whatever the source
+        for (CryptoSim::IvSource ivSource :
+             {CryptoSim::IV_RANDOM, CryptoSim::IV_COUNTER, CryptoSim::IV_STREAM})
+        {
+            std::vector<std::vector<uint8_t>> outputs = EncryptAll(mode, ivSource, 3);
+            std::set<std::vector<uint8_t>> unique(outputs.begin(), outputs.end());
+            NS_TEST_ASSERT_MSG_EQ(unique.size(),
+                                  outputs.size(),
+                                  "Repeated ciphertext in mode " << mode << " with IV source "
+                                                                 << ivSource);
+        }
+
+        // The same stream gives the same ciphertexts, another stream others
+        for (CryptoSim::IvSource ivSource : {CryptoSim::IV_COUNTER, CryptoSim::IV_STREAM})
+        {
+            std::vector<std::vector<uint8_t>> first = EncryptAll(mode, ivSource, 3);
+            NS_TEST_ASSERT_MSG_EQ((EncryptAll(mode, ivSource, 3) == first),
+                                  true,
+                                  "Same stream, different ciphertext in mode "
+                                      << mode << " with IV source " << ivSource);
+            std::vector<std::vector<uint8_t>> other = EncryptAll(mode, ivSource, 4);
+            NS_TEST_ASSERT_MSG_EQ((other[0] != first[0]),
+                                  true,
+                                  "Other stream, same ciphertext in mode "
+                                      << mode << " with IV source " << ivSource);
+        }
+
+        // The operating system source does not depend on the stream
+        NS_TEST_ASSERT_MSG_EQ((EncryptAll(mode, CryptoSim::IV_RANDOM, 3)[0] !=
+                               EncryptAll(mode, CryptoSim::IV_RANDOM, 3)[0]),
+                              true,
+                              "Random IVs repeated in mode " << mode);
+    }
+
+    // The helper assigns the streams of whole nodes
+    std::vector<std::vector<uint8_t>> outputs;
+    for (int run = 0; run < 2; run++)
+    {
+        NodeContainer nodes;
+        nodes.Create(2);
+        CryptoSimHelper::AssignStreams(nodes, 7);
+        Ptr<CryptoSim> crypto = nodes.Get(1)->GetObject<CryptoSim>();
+        NS_TEST_ASSERT_MSG_NE(crypto, nullptr, "AssignStreams installed no CryptoSim");
+        crypto->SetAttribute("IvSource", EnumValue(CryptoSim::IV_COUNTER));
+        crypto->SetKey(1, MakeMessage(16, 1));
+        outputs.push_back(crypto->Encrypt(MakeMessage(40, 1)));
+    }
+    NS_TEST_ASSERT_MSG_EQ((outputs[0] == outputs[1]),
+                          true,
+                          "Same node streams, different ciphertext");
+}
+
+/**
+ * @ingroup crypto-sim-tests
+ * TestSuite for module crypto-sim
+ */
+class CryptoSimTestSuite : public TestSuite
+{
+public:
+    CryptoSimTestSuite();
+};
+
+CryptoSimTestSuite::CryptoSimTestSuite()
+    : TestSuite("crypto-sim", Type::UNIT)
+{
+    AddTestCase(new CryptoSimKeyScheduleTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimKeyErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimPreSharedKeyTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimPreSharedKeyErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimAeadTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimAeadTamperTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimInPlaceTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimBufferTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimPacketTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimPacketErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CryptoSimIvSourceTestCase, TestCase::Duration::QUICK);
+}
+
+// Do not forget to allocate an instance of this TestSuite
+/**
+ * @ingroup crypto-sim-tests
+ * Static variable for test initialization
+ */
+static CryptoSimTestSuite sCryptoSimTestSuite;
@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2025-28 NITK Surathkal
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Authors: Samved Sajankila <samved58117@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+// Throughput and ratio benchmark of ZlibInteg.
+//
+// Sweeps payload size (minSize to maxSize, multiplied by sizeStep at every
+// step), level, strategy and data type, and reports for every combination
+// the compression ratio, deflate and inflate throughput, p50/p99 latency per
+// call, the heap allocations per call and the zlib blocks handed out by
+// ZlibMemoryPool per call, as CSV or JSON. Every point
+// runs for at least minTime, so small payloads get many samples. The sweep
+// is deterministic apart from the timings, so two runs can be compared to
+// catch regressions:
+//
+//   ./ns3 run "zlib-integ-benchmark --levels=1,6 --data=json --maxSize=1048576 --output=before.csv"
+
+#include "ns3/core-module.h"
+#include "ns3/zlib-integ.h"
+#include "ns3/zlib-memory-pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("ZlibIntegBenchmark");
+
+/// Most calls measured per operation of a point
+static const size_t MAX_SAMPLES = 1000000;
+
+/// Calls to the global operator new made by the whole process
+static std::atomic<uint64_t> g_heapAllocations(0);
+
+// Replacing the global allocation functions counts every C++ heap allocation,
+// including those made inside the ns-3 libraries. zlib allocates with malloc
+// through ZlibMemoryPool, whose system allocations are added separately.
+void*
+operator new(std::size_t size)
+{
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* block = std::malloc(size == 0 ? 1 : size);
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void*
+operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void
+operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void
+operator delete[](void* block) noexcept
+{
+    std::free(block);
+}
+
+void
+operator delete(void* block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+void
+operator delete[](void* block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+/**
+ * Results of one combination of the sweep.
+ */
+struct BenchmarkResult
+{
+    std::string data;           ///< Data type
+    uint64_t size;              ///< Payload size in bytes
+    int level;                  ///< Compression level
+    std::string strategy;       ///< Strategy name
+    uint64_t compressedSize;    ///< Output size of one Deflate() call
+    bool roundTrip;             ///< Whether Inflate() restored the payload
+    double deflateMBps;         ///< Deflate throughput, in MB of input per second
+    double inflateMBps;         ///< Inflate throughput, in MB of output per second
+    double deflateP50;          ///< Median Deflate() latency in microseconds
+    double deflateP99;          ///< 99th percentile Deflate() latency in microseconds
+    double inflateP50;          ///< Median Inflate() latency in microseconds
+    double inflateP99;          ///< 99th percentile Inflate() latency in microseconds
+    double deflateHeapAllocs;   ///< Heap allocations per Deflate() call
+    double inflateHeapAllocs;   ///< Heap allocations per Inflate() call
+    double deflateZlibBlocks;   ///< ZlibMemoryPool blocks handed out per Deflate() call
+    double inflateZlibBlocks;   ///< ZlibMemoryPool blocks handed out per Inflate() call
+};
+
+static std::vector<std::string>
+SplitList(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static ZlibInteg::Strategy
+ParseStrategy(const std::string& name)
+{
+    if (name == "default")
+    {
+        return ZlibInteg::DEFAULT_STRATEGY;
+    }
+    if (name == "filtered")
+    {
+        return ZlibInteg::FILTERED;
+    }
+    if (name == "huffman")
+    {
+        return ZlibInteg::HUFFMAN_ONLY;
+    }
+    if (name == "rle")
+    {
+        return ZlibInteg::RLE;
+    }
+    NS_ABORT_MSG_IF(name != "fixed", "Unknown strategy " << name);
+    return ZlibInteg::FIXED;
+}
+
+/**
+ * Generates a deterministic payload of one of the benchmark's data types.
+ */
+static std::vector<uint8_t>
+GeneratePayload(const std::string& type, uint64_t size)
+{
+    std::mt19937 rng(42);
+    std::vector<uint8_t> data;
+    data.reserve(size + 256);
+
+    if (type == "random")
+    {
+        std::uniform_int_distribution<int> byte(0, 255);
+        data.resize(size);
+        for (uint8_t& b : data)
+        {
+            b = static_cast<uint8_t>(byte(rng));
+        }
+        return data;
+    }
+
+    static const char* words[] = {"the", "packet", "link", "node", "queue", "delay", "rate", "is",
+                                  "of", "a", "compressed", "simulation", "and", "to", "network",
+                                  "buffer", "with", "throughput", "latency", "channel"};
+    std::uniform_int_distribution<size_t> word(0, sizeof(words) / sizeof(words[0]) - 1);
+    std::uniform_int_distribution<int> number(0, 9999);
+    uint32_t index = 0;
+    while (data.size() < size)
+    {
+        std::string chunk;
+        if (type == "text")
+        {
+            chunk = std::string(words[word(rng)]) + (number(rng) % 12 == 0 ? ".\n" : " ");
+        }
+        else if (type == "json")
+        {
+            chunk = "{\"id\":" + std::to_string(index++) + ",\"node\":\"sensor-" +
+                    std::to_string(number(rng) % 64) + "\",\"value\":" + std::to_string(number(rng)) +
+                    ",\"status\":\"" + words[word(rng)] + "\"},";
+        }
+        else
+        {
+            NS_ABORT_MSG_IF(type != "repetitive", "Unknown data type " << type);
+            // A fixed 64-byte record with a rare one-byte change
+            chunk = "HEADER:0123456789abcdefghijklmnopqrstuvwxyz:ABCDEFGHIJKLMNOPQRST:";
+            if (number(rng) % 100 == 0)
+            {
+                chunk[7] = static_cast<char>('0' + number(rng) % 10);
+            }
+        }
+        data.insert(data.end(), chunk.begin(), chunk.end());
+    }
+    data.resize(size);
+    return data;
+}
+
+static double
+Percentile(std::vector<double>& samples, double fraction)
+{
+    size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+/**
+ * Calls an operation repeatedly for at least minTime and one call.
+ *
+ * @param operation The operation; returns false on failure.
+ * @param minTime Least total time to spend.
+ * @param latencies Receives the duration of every call, in microseconds.
+ * @param heapAllocations Receives the heap allocations per call: operator new
+ * calls plus the blocks ZlibMemoryPool had to obtain from malloc.
+ * @param zlibBlocks Receives the blocks ZlibMemoryPool handed out per call,
+ * whether recycled or new.
+ * @return The total time spent, in seconds
+ */
+static double
+Measure(const std::function<bool()>& operation,
+        Time minTime,
+        std::vector<double>& latencies,
+        double& heapAllocations,
+        double& zlibBlocks)
+{
+    // Warm up: first-use allocations and caches are not part of steady state
+    operation();
+
+    // The latency vector grows while measuring, so its storage is reserved
+    // up front to keep it out of the count
+    latencies.clear();
+    latencies.reserve(MAX_SAMPLES);
+    ZlibMemoryPool* pool = ZlibMemoryPool::Get();
+    uint64_t blocksBefore = pool->GetAllocations();
+    uint64_t heapBefore = g_heapAllocations.load() + pool->GetSystemAllocations();
+    double total = 0;
+    while (latencies.empty() || (total < minTime.GetSeconds() && latencies.size() < MAX_SAMPLES))
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = operation();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        NS_ABORT_MSG_IF(!ok, "Benchmark operation failed");
+        total += elapsed.count();
+        latencies.push_back(elapsed.count() * 1e6);
+    }
+    uint64_t heapAfter = g_heapAllocations.load() + pool->GetSystemAllocations();
+    heapAllocations = double(heapAfter - heapBefore) / latencies.size();
+    zlibBlocks = double(pool->GetAllocations() - blocksBefore) / latencies.size();
+    return total;
+}
+
+static void
+WriteCsv(std::ostream& os, const std::vector<BenchmarkResult>& results)
+{
+    os << "data,size,level,strategy,compressed_size,ratio,round_trip,deflate_mbps,inflate_mbps,"
+          "deflate_p50_us,deflate_p99_us,inflate_p50_us,inflate_p99_us,"
+          "deflate_heap_allocs_per_call,inflate_heap_allocs_per_call,"
+          "deflate_zlib_blocks_per_call,inflate_zlib_blocks_per_call\n";
+    for (const BenchmarkResult& r : results)
+    {
+        os << r.data << "," << r.size << "," << r.level << "," << r.strategy << ","
+           << r.compressedSize << "," << double(r.compressedSize) / r.size << ","
+           << (r.roundTrip ? 1 : 0) << "," << r.deflateMBps << "," << r.inflateMBps << ","
+           << r.deflateP50 << "," << r.deflateP99 << "," << r.inflateP50 << "," << r.inflateP99
+           << "," << r.deflateHeapAllocs << "," << r.inflateHeapAllocs << "," << r.deflateZlibBlocks
+           << "," << r.inflateZlibBlocks << "\n";
+    }
+}
+
+static void
+WriteJson(std::ostream& os, const std::vector<BenchmarkResult>& results)
+{
+    os << "[\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchmarkResult& r = results[i];
+        os << "  {\"data\": \"" << r.data << "\", \"size\": " << r.size << ", \"level\": " << r.level
+           << ", \"strategy\": \"" << r.strategy << "\", \"compressed_size\": " << r.compressedSize
+           << ", \"ratio\": " << double(r.compressedSize) / r.size
+           << ", \"round_trip\": " << (r.roundTrip ? "true" : "false")
+           << ", \"deflate_mbps\": " << r.deflateMBps << ", \"inflate_mbps\": " << r.inflateMBps
+           << ", \"deflate_p50_us\": " << r.deflateP50 << ", \"deflate_p99_us\": " << r.deflateP99
+           << ", \"inflate_p50_us\": " << r.inflateP50 << ", \"inflate_p99_us\": " << r.inflateP99
+           << ", \"deflate_heap_allocs_per_call\": " << r.deflateHeapAllocs
+           << ", \"inflate_heap_allocs_per_call\": " << r.inflateHeapAllocs
+           << ", \"deflate_zlib_blocks_per_call\": " << r.deflateZlibBlocks
+           << ", \"inflate_zlib_blocks_per_call\": " << r.inflateZlibBlocks << "}"
+           << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "]\n";
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t minSize = 64;
+    uint64_t maxSize = 64 * 1024 * 1024;
+    uint32_t sizeStep = 8;
+    std::string levels = "1,6,9";
+    std::string strategies = "default";
+    std::string dataTypes = "text,json,random,repetitive";
+    Time minTime = MilliSeconds(200);
+    uint32_t threads = 1;
+    double skipEntropy = 8.0;
+    std::string format = "csv";
+    std::string output;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("minSize", "Smallest payload in bytes", minSize);
+    cmd.AddValue("maxSize", "Largest payload in bytes", maxSize);
+    cmd.AddValue("sizeStep", "Factor between successive payload sizes", sizeStep);
+    cmd.AddValue("levels", "Comma-separated compression levels", levels);
+    cmd.AddValue("strategies", "Comma-separated strategies (default,filtered,huffman,rle,fixed)", strategies);
+    cmd.AddValue("data", "Comma-separated data types (text,json,random,repetitive)", dataTypes);
+    cmd.AddValue("minTime", "Least time spent measuring each operation of a point", minTime);
+    cmd.AddValue("threads", "ZlibInteg Threads attribute", threads);
+    cmd.AddValue("skipEntropy", "ZlibInteg SkipEntropy attribute (8 = always compress)", skipEntropy);
+    cmd.AddValue("format", "Output format: csv or json", format);
+    cmd.AddValue("output", "Output file (standard output if empty)", output);
+    cmd.Parse(argc, argv);
+
+    NS_ABORT_MSG_IF(format != "csv" && format != "json", "Unknown output format " << format);
+    NS_ABORT_MSG_IF(sizeStep < 2, "sizeStep must be at least 2");
+    NS_ABORT_MSG_IF(minSize == 0 || minSize > maxSize, "Invalid payload size range");
+
+    // Every parallel Deflate() worker has its own context; the pool keeps
+    // their blocks between calls, so the allocation counts show the steady state
+    if (threads > 1)
+    {
+        ZlibMemoryPool::Get()->SetMaxCachedBytes(uint64_t(threads) * 1024 * 1024);
+    }
+
+    std::vector<uint64_t> sizes;
+    for (uint64_t size = minSize; size < maxSize; size *= sizeStep)
+    {
+        sizes.push_back(size);
+    }
+    sizes.push_back(maxSize);
+
+    std::vector<BenchmarkResult> results;
+    for (const std::string& type : SplitList(dataTypes))
+    {
+        // Generated once at the largest size; smaller points use a prefix
+        std::vector<uint8_t> payload = GeneratePayload(type, maxSize);
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> restored(maxSize);
+
+        for (const std::string& strategyName : SplitList(strategies))
+        {
+            for (const std::string& levelName : SplitList(levels))
+            {
+                Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+                zlib->SetAttribute("Level", IntegerValue(std::stoi(levelName)));
+                zlib->SetAttribute("Strategy", EnumValue<ZlibInteg::Strategy>(ParseStrategy(strategyName)));
+                zlib->SetAttribute("Threads", UintegerValue(threads));
+                zlib->SetAttribute("SkipEntropy", DoubleValue(skipEntropy));
+
+                for (uint64_t size : sizes)
+                {
+                    BenchmarkResult result;
+                    result.data = type;
+                    result.size = size;
+                    result.level = std::stoi(levelName);
+                    result.strategy = strategyName;
+
+                    compressed.resize(zlib->GetDeflateBound(size));
+                    int64_t compressedSize = 0;
+                    std::vector<double> latencies;
+                    double seconds = Measure(
+                        [&]() {
+                            compressedSize = zlib->Deflate(payload.data(), size, compressed.data(), compressed.size());
+                            return compressedSize > 0;
+                        },
+                        minTime,
+                        latencies,
+                        result.deflateHeapAllocs,
+                        result.deflateZlibBlocks);
+                    result.compressedSize = compressedSize;
+                    result.deflateMBps = size * latencies.size() / seconds / 1e6;
+                    result.deflateP50 = Percentile(latencies, 0.5);
+                    result.deflateP99 = Percentile(latencies, 0.99);
+
+                    int64_t restoredSize = 0;
+                    seconds = Measure(
+                        [&]() {
+                            restoredSize = zlib->Inflate(compressed.data(), compressedSize, restored.data(), size);
+                            return restoredSize >= 0;
+                        },
+                        minTime,
+                        latencies,
+                        result.inflateHeapAllocs,
+                        result.inflateZlibBlocks);
+                    result.roundTrip = restoredSize == static_cast<int64_t>(size) &&
+                                       std::equal(restored.begin(), restored.begin() + size, payload.begin());
+                    result.inflateMBps = size * latencies.size() / seconds / 1e6;
+                    result.inflateP50 = Percentile(latencies, 0.5);
+                    result.inflateP99 = Percentile(latencies, 0.99);
+
+                    NS_LOG_INFO(type << " " << size << " B, level " << levelName << ", " << strategyName
+                                     << ": ratio " << double(result.compressedSize) / size << ", "
+                                     << result.deflateMBps << " / " << result.inflateMBps << " MB/s");
+                    results.push_back(result);
+                }
+                zlib->Dispose();
+            }
+        }
+    }
+
+    std::ofstream file;
+    if (!output.empty())
+    {
+        file.open(output);
+        NS_ABORT_MSG_IF(!file, "Cannot create " << output);
+    }
+    std::ostream& os = output.empty() ? std::cout : file;
+    os << std::setprecision(6);
+    if (format == "csv")
+    {
+        WriteCsv(os, results);
+    }
+    else
+    {
+        WriteJson(os, results);
+    }
+    return 0;
+}
@@ -104,6 +104,21 @@ int main(int argc, char* argv[])
     {
         std::cout << "FAILURE: Data mismatch after decompression!" << std::endl;
     }
+
+    // Compress a packet in place, as a sending node would do in flight
+    std::cout << "\n=== Demonstrating Packet Compression ===" << std::endl;
+    Ptr<Packet> packet = Create<Packet>(inputVector.data(), inputVector.size());
+    compressor->CompressPacket(packet);
+    std::cout << "Compressed packet size:   " << packet->GetSize() << " bytes (including ZlibHeader)" << std::endl;
+
+    if (compressor->DecompressPacket(packet) && packet->GetSize() == inputVector.size())
+    {
+        std::cout << "SUCCESS: Packet restored to " << packet->GetSize() << " bytes!" << std::endl;
+    }
+    else
+    {
+        std::cout << "FAILURE: Packet decompression failed!" << std::endl;
+    }
     
     Simulator::Destroy();
     return 0;
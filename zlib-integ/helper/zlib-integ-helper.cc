@@ -1,12 +1,139 @@
 #include "zlib-integ-helper.h"
+#include "ns3/compression-receive-hook.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
 #include "ns3/object-factory.h"
+#include "ns3/simulator.h"
+#include "ns3/traffic-control-helper.h"
+#include "ns3/traffic-control-layer.h"
+#include <sstream>
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE("ZlibIntegHelper");
+
+/**
+ * @brief Sniffer trace sink stamping packets with the simulation time
+ */
+static void
+CompressedPcapSink(Ptr<CompressedPcapWriter> writer, Ptr<const Packet> packet)
+{
+  writer->Write(Simulator::Now(), packet);
+}
+
 Ptr<ZlibInteg> 
 ZlibIntegHelper::Create()
 {
   return CreateObject<ZlibInteg>();
 }
 
+QueueDiscContainer
+ZlibIntegHelper::InstallLinkCompression(NetDeviceContainer devices)
+{
+  TrafficControlHelper tch;
+  tch.SetRootQueueDisc("ns3::CompressionQueueDisc");
+
+  QueueDiscContainer queueDiscs;
+  for (NetDeviceContainer::Iterator i = devices.Begin(); i != devices.End(); ++i)
+  {
+    Ptr<NetDevice> device = *i;
+    Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+    NS_ABORT_MSG_IF(!tc, "Link compression requires the internet stack on the node");
+
+    // Addresses may already have been assigned, which installs a default root queue disc
+    if (tc->GetRootQueueDiscOnDevice(device))
+    {
+      tc->DeleteRootQueueDiscOnDevice(device);
+    }
+    queueDiscs.Add(tch.Install(device));
+
+    Ptr<CompressionReceiveHook> hook = CreateObject<CompressionReceiveHook>();
+    hook->Install(device);
+  }
+  return queueDiscs;
+}
+
+void
+ZlibIntegHelper::InstallCostModel(NodeContainer nodes, double cpuSpeed)
+{
+  for (NodeContainer::Iterator i = nodes.Begin(); i != nodes.End(); ++i)
+  {
+    NS_ABORT_MSG_IF((*i)->GetObject<CompressionCostModel>(), "Node already has a CompressionCostModel");
+    Ptr<CompressionCostModel> model = CreateObject<CompressionCostModel>();
+    model->SetAttribute("CpuSpeed", DoubleValue(cpuSpeed));
+    (*i)->AggregateObject(model);
+  }
+}
+
+std::vector<uint8_t>
+ZlibIntegHelper::TrainDictionary(const std::vector<Ptr<const Packet>>& packets, size_t maxSize)
+{
+  std::vector<std::vector<uint8_t>> samples;
+  samples.reserve(packets.size());
+  for (const Ptr<const Packet>& packet : packets)
+  {
+    std::vector<uint8_t> sample(packet->GetSize());
+    packet->CopyData(sample.data(), sample.size());
+    samples.push_back(std::move(sample));
+  }
+  return ZlibInteg::TrainDictionary(samples, maxSize);
+}
+
+std::vector<Ptr<CompressedPcapWriter>>
+ZlibIntegHelper::EnablePcapCompressed(const std::string& prefix,
+                                      NetDeviceContainer devices,
+                                      bool promiscuous)
+{
+  std::vector<Ptr<CompressedPcapWriter>> writers;
+  for (NetDeviceContainer::Iterator i = devices.Begin(); i != devices.End(); ++i)
+  {
+    Ptr<NetDevice> device = *i;
+    std::string type = device->GetInstanceTypeId().GetName();
+    uint32_t dataLinkType;
+    if (type == "ns3::CsmaNetDevice")
+    {
+      dataLinkType = CompressedPcapWriter::DLT_EN10MB;
+    }
+    else if (type == "ns3::PointToPointNetDevice")
+    {
+      dataLinkType = CompressedPcapWriter::DLT_PPP;
+    }
+    else
+    {
+      NS_LOG_WARN("No compressed pcap support for " << type << ", skipping it");
+      continue;
+    }
+
+    std::ostringstream filename;
+    filename << prefix << "-" << device->GetNode()->GetId() << "-" << device->GetIfIndex() << ".pcap.gz";
+    Ptr<CompressedPcapWriter> writer = CreateObject<CompressedPcapWriter>();
+    if (!writer->Open(filename.str(), dataLinkType))
+    {
+      continue;
+    }
+    device->TraceConnectWithoutContext(promiscuous ? "PromiscSniffer" : "Sniffer",
+                                       MakeBoundCallback(&CompressedPcapSink, writer));
+    Simulator::ScheduleDestroy(&CompressedPcapWriter::Close, writer);
+    writers.push_back(writer);
+  }
+  return writers;
+}
+
+std::vector<Ptr<CompressedPcapWriter>>
+ZlibIntegHelper::EnablePcapCompressedAll(const std::string& prefix, bool promiscuous)
+{
+  NetDeviceContainer devices;
+  for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i)
+  {
+    Ptr<Node> node = NodeList::GetNode(i);
+    for (uint32_t j = 0; j < node->GetNDevices(); ++j)
+    {
+      devices.Add(node->GetDevice(j));
+    }
+  }
+  return EnablePcapCompressed(prefix, devices, promiscuous);
+}
+
 } // namespace ns3
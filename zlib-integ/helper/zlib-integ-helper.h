@@ -2,7 +2,11 @@
 #define ZLIB_INTEG_HELPER_H
 
 #include "ns3/zlib-integ.h"
+#include "ns3/compressed-pcap-writer.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
 #include "ns3/ptr.h"
+#include "ns3/queue-disc-container.h"
 
 namespace ns3 {
 
@@ -17,6 +21,74 @@ public:
    * @return A smart pointer to the created ZlibInteg object
    */
   static Ptr<ZlibInteg> Create();
+
+  /**
+   * @brief Enable link-level compression on a set of devices
+   *
+   * Replaces the root queue disc of each device with a CompressionQueueDisc
+   * and installs a CompressionReceiveHook on it, so both ends of a link must
+   * be in the container. Call after the internet stack has been installed.
+   *
+   * @param devices The devices to compress traffic on
+   * @return The installed CompressionQueueDisc objects
+   */
+  static QueueDiscContainer InstallLinkCompression(NetDeviceContainer devices);
+
+  /**
+   * @brief Charge simulated CPU time for compression on a set of nodes
+   *
+   * Aggregates a CompressionCostModel to each node, so its CompressionQueueDisc
+   * and CompressionReceiveHook instances delay packets by the time the node's
+   * CPU needs to process them. Other attributes of the model can be set with
+   * Config::SetDefault. May be called before or after InstallLinkCompression().
+   *
+   * @param nodes The nodes to model
+   * @param cpuSpeed CPU speed of the nodes relative to the model's reference
+   */
+  static void InstallCostModel(NodeContainer nodes, double cpuSpeed = 1.0);
+
+  /**
+   * @brief Build a preset dictionary from captured packets
+   *
+   * Each packet's content is one training sample, so packets should be
+   * captured at the layer where they will be compressed (e.g. application
+   * payloads, or IPv4 payloads for link compression). Register the result
+   * on both ends with ZlibInteg::AddDictionary().
+   *
+   * @param packets Packets representative of the traffic
+   * @param maxSize Largest dictionary to build
+   * @return The dictionary, or an empty vector if the packets share no content
+   */
+  static std::vector<uint8_t> TrainDictionary(const std::vector<Ptr<const Packet>>& packets,
+                                              size_t maxSize = 4096);
+
+  /**
+   * @brief Write gzip-compressed pcap traces of a set of devices
+   *
+   * A drop-in for the device helpers' EnablePcap(): each device gets a
+   * CompressedPcapWriter on its "PromiscSniffer" or "Sniffer" trace source,
+   * writing prefix-<node>-<device>.pcap.gz. CSMA devices are written as
+   * Ethernet and point-to-point devices as PPP; other devices are skipped.
+   * The files are closed when the simulator is destroyed.
+   *
+   * @param prefix Filename prefix
+   * @param devices The devices to trace
+   * @param promiscuous Whether to capture all packets on the medium
+   * @return The writers, one per traced device
+   */
+  static std::vector<Ptr<CompressedPcapWriter>> EnablePcapCompressed(const std::string& prefix,
+                                                                     NetDeviceContainer devices,
+                                                                     bool promiscuous = false);
+
+  /**
+   * @brief Write gzip-compressed pcap traces of every device in the simulation
+   *
+   * @param prefix Filename prefix
+   * @param promiscuous Whether to capture all packets on the medium
+   * @return The writers, one per traced device
+   */
+  static std::vector<Ptr<CompressedPcapWriter>> EnablePcapCompressedAll(const std::string& prefix,
+                                                                        bool promiscuous = false);
 };
 
 } // namespace ns3
@@ -0,0 +1,131 @@
+#ifndef COMPRESSED_PCAP_WRITER_H
+#define COMPRESSED_PCAP_WRITER_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Forward declaration of zlib's stream state so that zlib.h stays out of the public header
+struct z_stream_s;
+
+namespace ns3 {
+
+/**
+ * @brief Writes packets to a gzip-compressed pcap file (.pcap.gz).
+ *
+ * Records are collected into blocks of BlockSize bytes. Each full block is
+ * handed to a background thread, which compresses it in gzip format and
+ * appends it to the file as one gzip member. The thread has a deflate
+ * context of its own rather than a ZlibInteg, whose statistics, traces and
+ * logging belong to the simulation thread. A sequence of
+ * gzip members is itself a valid gzip file, so zcat, tcpdump and Wireshark
+ * read the output directly. At most MaxPendingBlocks blocks wait for the
+ * thread; beyond that Write() blocks, which bounds the memory held when the
+ * compressor or the disk cannot keep up with the simulation.
+ *
+ * ZlibIntegHelper::EnablePcapCompressed() connects writers to the sniffer
+ * trace sources of devices, as the device helpers' EnablePcap() does.
+ */
+class CompressedPcapWriter : public Object
+{
+public:
+  /**
+   * @brief pcap link-layer header types.
+   */
+  enum DataLinkType
+  {
+    DLT_EN10MB = 1,  ///< Ethernet, as written by CSMA devices
+    DLT_PPP = 9      ///< PPP, as written by point-to-point devices
+  };
+
+  static TypeId GetTypeId(void);
+  CompressedPcapWriter();
+  ~CompressedPcapWriter() override;
+
+  /**
+   * @brief Creates the file, writes the pcap header and starts the compression thread.
+   *
+   * A file that is already open is closed first.
+   *
+   * @param filename Name of the file, conventionally ending in .pcap.gz.
+   * @param dataLinkType Link-layer header type of the packets.
+   * @param snapLen Largest number of bytes stored per packet.
+   * @return false if the file cannot be created
+   */
+  bool Open(const std::string& filename, uint32_t dataLinkType, uint32_t snapLen = 65535);
+
+  /**
+   * @brief Appends a packet record.
+   *
+   * @param time Timestamp of the record.
+   * @param packet The packet, starting with its link-layer header.
+   */
+  void Write(Time time, Ptr<const Packet> packet);
+
+  /**
+   * @brief Compresses the remaining records, waits for the thread and closes the file.
+   */
+  void Close();
+
+  /**
+   * @brief Whether the file is open.
+   */
+  bool IsOpen() const;
+
+  /**
+   * @brief Bytes of pcap data written so far, before compression.
+   */
+  uint64_t GetUncompressedBytes() const;
+
+  /**
+   * @brief Bytes the compression thread has written to the file so far.
+   */
+  uint64_t GetCompressedBytes() const;
+
+protected:
+  void DoDispose(void) override;
+
+private:
+  /**
+   * @brief Queues the current block for compression, waiting while the queue is full.
+   */
+  void FlushBlock();
+
+  /**
+   * @brief Body of the compression thread.
+   */
+  void CompressBlocks();
+
+  uint32_t m_blockSize;         ///< Uncompressed bytes per gzip member
+  uint32_t m_maxPendingBlocks;  ///< Blocks that may wait for the compression thread
+  int m_level;                  ///< Compression level
+
+  std::string m_filename;       ///< Name of the open file
+  std::FILE* m_file;            ///< The open file, or nullptr
+  uint32_t m_snapLen;           ///< Largest number of bytes stored per packet
+  z_stream_s* m_stream;         ///< gzip deflate context, used by the compression thread only
+  std::vector<uint8_t> m_block; ///< Records collected for the next gzip member
+  uint64_t m_uncompressedBytes; ///< pcap bytes written
+
+  std::mutex m_mutex;                          ///< Guards the queue and the spare blocks
+  std::condition_variable m_blockQueued;       ///< Signalled when a block or the close request is queued
+  std::condition_variable m_blockTaken;        ///< Signalled when the thread takes a block
+  std::deque<std::vector<uint8_t>> m_pending;  ///< Blocks waiting for the compression thread
+  std::vector<std::vector<uint8_t>> m_spare;   ///< Compressed blocks' buffers, for reuse
+  bool m_closing;                              ///< Whether the thread should stop once the queue is empty
+  std::thread m_thread;                        ///< The compression thread
+  std::atomic<uint64_t> m_compressedBytes;     ///< Bytes written to the file
+  std::atomic<bool> m_failed;                  ///< Whether compressing or writing a block failed
+};
+
+} // namespace ns3
+
+#endif /* COMPRESSED_PCAP_WRITER_H */
@@ -0,0 +1,218 @@
+#include "compression-backend.h"
+#include "ns3/log.h"
+#include <zlib.h> // Error codes shared with ZlibInteg
+#include <algorithm>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("CompressionBackend");
+
+NS_OBJECT_ENSURE_REGISTERED(CompressionBackend);
+
+TypeId CompressionBackend::GetTypeId(void)
+{
+  static TypeId tid = TypeId("ns3::CompressionBackend")
+    .SetParent<Object>()
+    .SetGroupName("ZlibInteg");
+  return tid;
+}
+
+#ifdef HAVE_LZ4
+
+NS_OBJECT_ENSURE_REGISTERED(Lz4Backend);
+
+TypeId Lz4Backend::GetTypeId(void)
+{
+  static TypeId tid = TypeId("ns3::Lz4Backend")
+    .SetParent<CompressionBackend>()
+    .SetGroupName("ZlibInteg")
+    .AddConstructor<Lz4Backend>();
+  return tid;
+}
+
+std::string Lz4Backend::GetName() const
+{
+    return "lz4";
+}
+
+size_t Lz4Backend::GetCompressBound(size_t inputSize) const
+{
+    return inputSize > LZ4_MAX_INPUT_SIZE ? 0 : LZ4_compressBound(static_cast<int>(inputSize));
+}
+
+int64_t Lz4Backend::Compress(const uint8_t* input,
+                             size_t inputSize,
+                             uint8_t* output,
+                             size_t outputCapacity,
+                             int level)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity << level);
+
+    if (inputSize > LZ4_MAX_INPUT_SIZE)
+    {
+        NS_LOG_ERROR("Input of " << inputSize << " bytes is too large for lz4");
+        return Z_STREAM_ERROR;
+    }
+    int acceleration = level < 0 ? 1 : 1 << (9 - std::max(level, 1));
+    int produced = LZ4_compress_fast(reinterpret_cast<const char*>(input),
+                                     reinterpret_cast<char*>(output),
+                                     static_cast<int>(inputSize),
+                                     static_cast<int>(std::min<size_t>(outputCapacity, LZ4_MAX_INPUT_SIZE)),
+                                     acceleration);
+    return produced > 0 ? produced : Z_BUF_ERROR;
+}
+
+int64_t Lz4Backend::GetDecompressedSize(const uint8_t* /* input */, size_t /* inputSize */) const
+{
+    // lz4 blocks do not record their decompressed size
+    return Z_DATA_ERROR;
+}
+
+int64_t Lz4Backend::Decompress(const uint8_t* input,
+                               size_t inputSize,
+                               uint8_t* output,
+                               size_t outputCapacity)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity);
+
+    if (inputSize > LZ4_MAX_INPUT_SIZE)
+    {
+        return Z_DATA_ERROR;
+    }
+    // lz4 cannot tell a corrupt block from one that does not fit
+    int produced = LZ4_decompress_safe(reinterpret_cast<const char*>(input),
+                                       reinterpret_cast<char*>(output),
+                                       static_cast<int>(inputSize),
+                                       static_cast<int>(std::min<size_t>(outputCapacity, INT32_MAX)));
+    if (produced < 0)
+    {
+        NS_LOG_ERROR("LZ4_decompress_safe failed with error code: " << produced);
+        return Z_DATA_ERROR;
+    }
+    return produced;
+}
+
+#endif /* HAVE_LZ4 */
+
+#ifdef HAVE_ZSTD
+
+// An RLE block of up to 128 KB costs 4 bytes, which bounds the size a
+// frame can legitimately declare
+static const uint64_t MAX_ZSTD_RATIO = 32768;
+
+NS_OBJECT_ENSURE_REGISTERED(ZstdBackend);
+
+TypeId ZstdBackend::GetTypeId(void)
+{
+  static TypeId tid = TypeId("ns3::ZstdBackend")
+    .SetParent<CompressionBackend>()
+    .SetGroupName("ZlibInteg")
+    .AddConstructor<ZstdBackend>();
+  return tid;
+}
+
+ZstdBackend::ZstdBackend()
+    : m_compressContext(ZSTD_createCCtx()),
+      m_decompressContext(ZSTD_createDCtx())
+{
+    NS_LOG_FUNCTION(this);
+}
+
+ZstdBackend::~ZstdBackend()
+{
+    NS_LOG_FUNCTION(this);
+    // Object::DoDispose() must not run twice, so the contexts are freed
+    // here directly for backends that were never disposed
+    if (m_compressContext)
+    {
+        ZSTD_freeCCtx(m_compressContext);
+    }
+    if (m_decompressContext)
+    {
+        ZSTD_freeDCtx(m_decompressContext);
+    }
+}
+
+void ZstdBackend::DoDispose(void)
+{
+    NS_LOG_FUNCTION(this);
+    ZSTD_freeCCtx(m_compressContext);
+    ZSTD_freeDCtx(m_decompressContext);
+    m_compressContext = nullptr;
+    m_decompressContext = nullptr;
+    CompressionBackend::DoDispose();
+}
+
+std::string ZstdBackend::GetName() const
+{
+    return "zstd";
+}
+
+size_t ZstdBackend::GetCompressBound(size_t inputSize) const
+{
+    return ZSTD_compressBound(inputSize);
+}
+
+int64_t ZstdBackend::Compress(const uint8_t* input,
+                              size_t inputSize,
+                              uint8_t* output,
+                              size_t outputCapacity,
+                              int level)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity << level);
+
+    if (!m_compressContext)
+    {
+        return Z_MEM_ERROR;
+    }
+    size_t produced = ZSTD_compressCCtx(m_compressContext, output, outputCapacity, input, inputSize,
+                                        level < 0 ? ZSTD_CLEVEL_DEFAULT : std::max(level, 1));
+    if (ZSTD_isError(produced))
+    {
+        NS_LOG_ERROR("ZSTD_compressCCtx failed: " << ZSTD_getErrorName(produced));
+        return ZSTD_getErrorCode(produced) == ZSTD_error_dstSize_tooSmall ? Z_BUF_ERROR : Z_STREAM_ERROR;
+    }
+    return static_cast<int64_t>(produced);
+}
+
+int64_t ZstdBackend::GetDecompressedSize(const uint8_t* input, size_t inputSize) const
+{
+    unsigned long long size = ZSTD_getFrameContentSize(input, inputSize);
+    if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR ||
+        size / MAX_ZSTD_RATIO > inputSize)
+    {
+        return Z_DATA_ERROR;
+    }
+    return static_cast<int64_t>(size);
+}
+
+int64_t ZstdBackend::Decompress(const uint8_t* input,
+                                size_t inputSize,
+                                uint8_t* output,
+                                size_t outputCapacity)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity);
+
+    if (!m_decompressContext)
+    {
+        return Z_MEM_ERROR;
+    }
+    size_t produced = ZSTD_decompressDCtx(m_decompressContext, output, outputCapacity, input, inputSize);
+    if (ZSTD_isError(produced))
+    {
+        NS_LOG_ERROR("ZSTD_decompressDCtx failed: " << ZSTD_getErrorName(produced));
+        return ZSTD_getErrorCode(produced) == ZSTD_error_dstSize_tooSmall ? Z_BUF_ERROR : Z_DATA_ERROR;
+    }
+    return static_cast<int64_t>(produced);
+}
+
+#endif /* HAVE_ZSTD */
+
+} // namespace ns3
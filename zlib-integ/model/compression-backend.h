@@ -0,0 +1,164 @@
+#ifndef COMPRESSION_BACKEND_H
+#define COMPRESSION_BACKEND_H
+
+#include "ns3/object.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef HAVE_ZSTD
+// Forward declarations of the zstd contexts so that zstd.h stays out of the public header
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+#endif
+
+namespace ns3 {
+
+/**
+ * @brief Codec that ZlibInteg can delegate compression to instead of zlib.
+ *
+ * A backend only compresses and decompresses whole buffers; ZlibInteg keeps
+ * the framing around them (SizePrefix, ZlibHeader), so the same examples and
+ * queue discs run unchanged with any codec. Errors are reported as negative
+ * zlib error codes, like the rest of ZlibInteg: Z_BUF_ERROR when the output
+ * does not fit, Z_DATA_ERROR for corrupt input. Unlike zlib streams, the lz4
+ * and zstd outputs carry no checksum, so corruption can go unnoticed.
+ *
+ * Select a built-in backend with the ZlibInteg Codec attribute, or plug in
+ * another one with ZlibInteg::SetBackend().
+ */
+class CompressionBackend : public Object
+{
+public:
+  static TypeId GetTypeId(void);
+
+  /**
+   * @brief Short name of the codec, such as "lz4".
+   */
+  virtual std::string GetName() const = 0;
+
+  /**
+   * @brief Worst-case output size of Compress().
+   *
+   * @param inputSize Number of bytes to be compressed.
+   */
+  virtual size_t GetCompressBound(size_t inputSize) const = 0;
+
+  /**
+   * @brief Compresses a buffer.
+   *
+   * @param input Bytes to be compressed.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @param level ZlibInteg's Level attribute (-1 = codec default, 1-9 = faster to stronger),
+   * mapped onto the codec's own scale.
+   * @return The number of bytes written, or a negative zlib error code
+   */
+  virtual int64_t Compress(const uint8_t* input,
+                           size_t inputSize,
+                           uint8_t* output,
+                           size_t outputCapacity,
+                           int level) = 0;
+
+  /**
+   * @brief Reads the decompressed size recorded in a compressed buffer.
+   *
+   * @param input Compressed bytes.
+   * @param inputSize Number of compressed bytes.
+   * @return The decompressed size, or a negative zlib error code if the codec
+   * does not record it or the input is invalid
+   */
+  virtual int64_t GetDecompressedSize(const uint8_t* input, size_t inputSize) const = 0;
+
+  /**
+   * @brief Decompresses a buffer.
+   *
+   * @param input Compressed bytes.
+   * @param inputSize Number of compressed bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of bytes written, or a negative zlib error code
+   */
+  virtual int64_t Decompress(const uint8_t* input,
+                             size_t inputSize,
+                             uint8_t* output,
+                             size_t outputCapacity) = 0;
+};
+
+// The built-in backends are only declared where they are defined, inside the
+// module build, which sees HAVE_LZ4 and HAVE_ZSTD; other code selects them
+// through the ZlibInteg Codec attribute
+
+#ifdef HAVE_LZ4
+
+/**
+ * @brief lz4 block compression. Only available when lz4 was found at build time.
+ *
+ * Levels map to lz4's acceleration factor: level 9 and the default (-1) use
+ * acceleration 1, and every level below 9 doubles it (level 0 behaves like 1).
+ * The block format records no size, so Inflate() of a vector needs SizePrefix.
+ */
+class Lz4Backend : public CompressionBackend
+{
+public:
+  static TypeId GetTypeId(void);
+
+  std::string GetName() const override;
+  size_t GetCompressBound(size_t inputSize) const override;
+  int64_t Compress(const uint8_t* input,
+                   size_t inputSize,
+                   uint8_t* output,
+                   size_t outputCapacity,
+                   int level) override;
+  int64_t GetDecompressedSize(const uint8_t* input, size_t inputSize) const override;
+  int64_t Decompress(const uint8_t* input,
+                     size_t inputSize,
+                     uint8_t* output,
+                     size_t outputCapacity) override;
+};
+
+#endif /* HAVE_LZ4 */
+
+#ifdef HAVE_ZSTD
+
+/**
+ * @brief zstd frame compression. Only available when zstd was found at build time.
+ *
+ * Levels are passed to zstd as they are (-1 selects zstd's default, 3);
+ * zstd levels above 9 are out of reach of the Level attribute. The
+ * compression and decompression contexts live as long as the backend.
+ */
+class ZstdBackend : public CompressionBackend
+{
+public:
+  static TypeId GetTypeId(void);
+  ZstdBackend();
+  ~ZstdBackend() override;
+
+  std::string GetName() const override;
+  size_t GetCompressBound(size_t inputSize) const override;
+  int64_t Compress(const uint8_t* input,
+                   size_t inputSize,
+                   uint8_t* output,
+                   size_t outputCapacity,
+                   int level) override;
+  int64_t GetDecompressedSize(const uint8_t* input, size_t inputSize) const override;
+  int64_t Decompress(const uint8_t* input,
+                     size_t inputSize,
+                     uint8_t* output,
+                     size_t outputCapacity) override;
+
+protected:
+  void DoDispose(void) override;
+
+private:
+  ZSTD_CCtx_s* m_compressContext;    ///< Reused across Compress() calls
+  ZSTD_DCtx_s* m_decompressContext;  ///< Reused across Decompress() calls
+};
+
+#endif /* HAVE_ZSTD */
+
+} // namespace ns3
+
+#endif /* COMPRESSION_BACKEND_H */
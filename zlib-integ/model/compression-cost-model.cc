@@ -0,0 +1,170 @@
+#include "compression-cost-model.h"
+#include "zlib-integ.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/integer.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("CompressionCostModel");
+
+NS_OBJECT_ENSURE_REGISTERED(CompressionCostModel);
+
+// Reference costs in nanoseconds per byte on a ~3 GHz core for text-like
+// payloads: deflate at levels 0-9, then inflate per output byte
+static const double REFERENCE_COSTS_NS[] = {0.3, 8.0, 9.0, 11.0, 14.0, 20.0, 30.0, 40.0, 70.0, 100.0, 3.0};
+
+// Input of the host microbenchmark, and the runs per level (the fastest counts)
+static const size_t CALIBRATION_SIZE = 256 * 1024;
+static const int CALIBRATION_RUNS = 3;
+
+TypeId CompressionCostModel::GetTypeId(void)
+{
+  static TypeId tid = TypeId("ns3::CompressionCostModel")
+    .SetParent<Object>()
+    .SetGroupName("ZlibInteg")
+    .AddConstructor<CompressionCostModel>()
+    .AddAttribute("CpuSpeed",
+                  "Speed of the node's CPU relative to the reference: the host with Calibrate, "
+                  "otherwise a ~3 GHz core (0.25 = four times slower).",
+                  DoubleValue(1.0),
+                  MakeDoubleAccessor(&CompressionCostModel::m_cpuSpeed),
+                  MakeDoubleChecker<double>(1e-6))
+    .AddAttribute("Calibrate",
+                  "Measure the per-byte costs with a microbenchmark on the host, once per "
+                  "process, instead of using the built-in table.",
+                  BooleanValue(false),
+                  MakeBooleanAccessor(&CompressionCostModel::m_calibrate),
+                  MakeBooleanChecker())
+    .AddAttribute("CallOverhead",
+                  "CPU time of every compression or decompression call on top of the per-byte "
+                  "cost, at the reference speed.",
+                  TimeValue(MicroSeconds(1)),
+                  MakeTimeAccessor(&CompressionCostModel::m_callOverhead),
+                  MakeTimeChecker(Time(0)));
+  return tid;
+}
+
+CompressionCostModel::CompressionCostModel()
+    : m_cpuSpeed(1.0),
+      m_calibrate(false)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+CompressionCostModel::~CompressionCostModel()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+const CompressionCostModel::CostTable& CompressionCostModel::GetHostCosts()
+{
+    static const CostTable costs = []() {
+        // Log-like records: repetitive structure, varying numbers
+        std::vector<uint8_t> data;
+        data.reserve(CALIBRATION_SIZE + 64);
+        uint32_t state = 12345;
+        while (data.size() < CALIBRATION_SIZE)
+        {
+            state = state * 1103515245 + 12345;
+            std::string record = "time=" + std::to_string(state % 100000) + " node=" +
+                                 std::to_string((state >> 8) % 64) + " temp=" +
+                                 std::to_string((state >> 16) % 40) + " status=OK\n";
+            data.insert(data.end(), record.begin(), record.end());
+        }
+        data.resize(CALIBRATION_SIZE);
+
+        CostTable table;
+        Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+        zlib->SetAttribute("SkipEntropy", DoubleValue(8.0));
+        std::vector<uint8_t> compressed(zlib->GetDeflateBound(data.size()));
+        std::vector<uint8_t> restored(data.size());
+        int64_t compressedSize = 0;
+        for (int level = 0; level <= 9; ++level)
+        {
+            zlib->SetAttribute("Level", IntegerValue(level));
+            double fastest = std::numeric_limits<double>::max();
+            for (int run = 0; run < CALIBRATION_RUNS; ++run)
+            {
+                auto start = std::chrono::steady_clock::now();
+                compressedSize = zlib->Deflate(data.data(), data.size(), compressed.data(), compressed.size());
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                fastest = std::min(fastest, elapsed.count());
+            }
+            table[level] = fastest / data.size();
+        }
+
+        // Inflate the level 9 stream, the last one produced
+        double fastest = std::numeric_limits<double>::max();
+        for (int run = 0; run < CALIBRATION_RUNS && compressedSize > 0; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            zlib->Inflate(compressed.data(), compressedSize, restored.data(), restored.size());
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            fastest = std::min(fastest, elapsed.count());
+        }
+        table[10] = compressedSize > 0 ? fastest / data.size() : REFERENCE_COSTS_NS[10] * 1e-9;
+        zlib->Dispose();
+
+        NS_LOG_INFO("Host costs (ns/byte): level 1 " << table[1] * 1e9 << ", level 6 "
+                                                     << table[6] * 1e9 << ", level 9 "
+                                                     << table[9] * 1e9 << ", inflate "
+                                                     << table[10] * 1e9);
+        return table;
+    }();
+    return costs;
+}
+
+const CompressionCostModel::CostTable& CompressionCostModel::GetCosts() const
+{
+    static const CostTable reference = []() {
+        CostTable table;
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            table[i] = REFERENCE_COSTS_NS[i] * 1e-9;
+        }
+        return table;
+    }();
+    return m_calibrate ? GetHostCosts() : reference;
+}
+
+Time CompressionCostModel::GetDeflateTime(uint64_t bytes, int level) const
+{
+    // The zlib default level is 6
+    int index = level < 0 ? 6 : std::min(level, 9);
+    return Seconds(GetCosts()[index] * bytes / m_cpuSpeed) + GetCallOverhead();
+}
+
+Time CompressionCostModel::GetInflateTime(uint64_t bytes) const
+{
+    return Seconds(GetCosts()[10] * bytes / m_cpuSpeed) + GetCallOverhead();
+}
+
+Time CompressionCostModel::GetCallOverhead() const
+{
+    return Seconds(m_callOverhead.GetSeconds() / m_cpuSpeed);
+}
+
+Time CompressionCostModel::Process(Time work)
+{
+    NS_LOG_FUNCTION(this << work);
+
+    Time now = Simulator::Now();
+    m_busyUntil = std::max(m_busyUntil, now) + work;
+    m_busyTime += work;
+    return m_busyUntil - now;
+}
+
+Time CompressionCostModel::GetBusyTime() const
+{
+    return m_busyTime;
+}
+
+} // namespace ns3
@@ -0,0 +1,88 @@
+#ifndef COMPRESSION_COST_MODEL_H
+#define COMPRESSION_COST_MODEL_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include <array>
+
+namespace ns3 {
+
+/**
+ * @brief Simulated CPU time spent compressing and decompressing on a node.
+ *
+ * ZlibInteg runs in zero simulated time. Aggregated to a node, this model
+ * turns the work done by the node's CompressionQueueDisc and
+ * CompressionReceiveHook into processing delay: deflating costs a per-byte
+ * time that depends on the level, inflating a per-byte time of the restored
+ * output, and every call a fixed CallOverhead. The node has one CPU, so
+ * packets wait for the ones processed before them.
+ *
+ * The per-byte costs come from a built-in table measured on a ~3 GHz core,
+ * or, with Calibrate, from a microbenchmark run once per process on the
+ * host. Either way they are divided by CpuSpeed, the speed of the simulated
+ * node relative to that reference.
+ */
+class CompressionCostModel : public Object
+{
+public:
+  static TypeId GetTypeId(void);
+  CompressionCostModel();
+  ~CompressionCostModel() override;
+
+  /**
+   * @brief CPU time to deflate a buffer.
+   *
+   * @param bytes Number of input bytes.
+   * @param level Compression level (-1 for the zlib default, 0-9).
+   */
+  Time GetDeflateTime(uint64_t bytes, int level) const;
+
+  /**
+   * @brief CPU time to inflate a buffer.
+   *
+   * @param bytes Number of decompressed bytes.
+   */
+  Time GetInflateTime(uint64_t bytes) const;
+
+  /**
+   * @brief CPU time of a call that did no compression work, such as a cache hit.
+   */
+  Time GetCallOverhead() const;
+
+  /**
+   * @brief Queues work on the node's CPU.
+   *
+   * @param work CPU time of the work.
+   * @return The delay from now until the work is done
+   */
+  Time Process(Time work);
+
+  /**
+   * @brief Total CPU time processed so far.
+   */
+  Time GetBusyTime() const;
+
+private:
+  /// Seconds per byte of deflate at levels 0-9, followed by inflate
+  typedef std::array<double, 11> CostTable;
+
+  /**
+   * @brief Measures the host's costs, once per process.
+   */
+  static const CostTable& GetHostCosts();
+
+  /**
+   * @brief Gets the table selected by the Calibrate attribute.
+   */
+  const CostTable& GetCosts() const;
+
+  double m_cpuSpeed;        ///< Node CPU speed relative to the reference
+  bool m_calibrate;         ///< Whether the costs are measured on the host
+  Time m_callOverhead;      ///< Fixed CPU time of every call
+  Time m_busyUntil;         ///< Time at which the CPU finishes its queued work
+  Time m_busyTime;          ///< Total CPU time processed
+};
+
+} // namespace ns3
+
+#endif /* COMPRESSION_COST_MODEL_H */
@@ -0,0 +1,281 @@
+#include "compression-queue-disc.h"
+#include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/channel.h"
+#include "ns3/double.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/integer.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/net-device-queue-interface.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/zlib-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("CompressionQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED(CompressionQueueDisc);
+
+TypeId CompressionQueueDisc::GetTypeId(void)
+{
+  static TypeId tid = TypeId("ns3::CompressionQueueDisc")
+    .SetParent<QueueDisc>()
+    .SetGroupName("ZlibInteg")
+    .AddConstructor<CompressionQueueDisc>()
+    .AddAttribute("MaxSize",
+                  "The max queue size",
+                  QueueSizeValue(QueueSize("1000p")),
+                  MakeQueueSizeAccessor(&QueueDisc::SetMaxSize, &QueueDisc::GetMaxSize),
+                  MakeQueueSizeChecker())
+    .AddAttribute("MinPayloadSize",
+                  "IPv4 payloads shorter than this many bytes are sent uncompressed.",
+                  UintegerValue(64),
+                  MakeUintegerAccessor(&CompressionQueueDisc::m_minPayloadSize),
+                  MakeUintegerChecker<uint32_t>())
+    .AddAttribute("Level",
+                  "Compression level: -1 selects the zlib default, 0 stores, 1-9 trade speed for ratio.",
+                  IntegerValue(-1),
+                  MakeIntegerAccessor(&CompressionQueueDisc::m_level),
+                  MakeIntegerChecker<int>(-1, 9))
+    .AddAttribute("MaxRatio",
+                  "Bypass threshold: payloads whose compressed/original size ratio is not "
+                  "below this value are sent uncompressed.",
+                  DoubleValue(0.9),
+                  MakeDoubleAccessor(&CompressionQueueDisc::m_maxRatio),
+                  MakeDoubleChecker<double>(0.0, 1.0))
+    .AddAttribute("AdaptiveLevel",
+                  "Pick the compression level of every packet from the link rate and the "
+                  "queue backlog instead of using Level.",
+                  BooleanValue(false),
+                  MakeBooleanAccessor(&CompressionQueueDisc::m_adaptiveLevel),
+                  MakeBooleanChecker())
+    .AddTraceSource("Compress",
+                    "An IPv4 packet was enqueued, with its payload size before and after compression.",
+                    MakeTraceSourceAccessor(&CompressionQueueDisc::m_compressTrace),
+                    "ns3::CompressionQueueDisc::CompressTracedCallback");
+  return tid;
+}
+
+CompressionQueueDisc::CompressionQueueDisc()
+    : QueueDisc(QueueDiscSizePolicy::SINGLE_INTERNAL_QUEUE),
+      m_compressor(CreateObject<ZlibInteg>()),
+      m_chosenLevel(-1),
+      m_costModelChecked(false)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+CompressionQueueDisc::~CompressionQueueDisc()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void CompressionQueueDisc::DoDispose(void)
+{
+    NS_LOG_FUNCTION(this);
+    Simulator::Cancel(m_resumeEvent);
+    m_compressor = nullptr;
+    m_costModel = nullptr;
+    m_readyTimes.clear();
+    QueueDisc::DoDispose();
+}
+
+Ptr<ZlibInteg> CompressionQueueDisc::GetCompressor() const
+{
+    return m_compressor;
+}
+
+Ptr<QueueDiscItem> CompressionQueueDisc::Compress(Ptr<Ipv4QueueDiscItem> item, Time& work)
+{
+    NS_LOG_FUNCTION(this << item);
+
+    // Work on a copy so that trace sinks holding the original packet are unaffected
+    Ptr<Packet> packet = item->GetPacket()->Copy();
+    uint32_t originalSize = packet->GetSize();
+
+    if (originalSize >= m_minPayloadSize)
+    {
+        if (m_adaptiveLevel)
+        {
+            m_compressor->SetLinkState(GetLinkRate(), GetNBytes());
+        }
+        uint64_t compressedCount = m_compressor->GetCompressedCount();
+        m_compressor->CompressPacket(packet, m_maxRatio);
+
+        // Skipped payloads and cache hits cost the call, not the bytes
+        Ptr<CompressionCostModel> costModel = GetCostModel();
+        if (costModel)
+        {
+            work = m_compressor->GetCompressedCount() > compressedCount
+                       ? costModel->GetDeflateTime(originalSize, m_chosenLevel)
+                       : costModel->GetCallOverhead();
+        }
+    }
+    else
+    {
+        packet->AddHeader(ZlibHeader());
+    }
+
+    Ipv4Header header = item->GetHeader();
+    header.SetPayloadSize(packet->GetSize());
+
+    Ptr<Ipv4QueueDiscItem> compressed =
+        Create<Ipv4QueueDiscItem>(packet, item->GetAddress(), item->GetProtocol(), header);
+    compressed->SetTimeStamp(item->GetTimeStamp());
+    compressed->SetTxQueueIndex(item->GetTxQueueIndex());
+
+    NS_LOG_LOGIC("IPv4 payload " << originalSize << " -> " << packet->GetSize() << " bytes");
+    m_compressTrace(originalSize, packet->GetSize());
+    return compressed;
+}
+
+DataRate CompressionQueueDisc::GetLinkRate()
+{
+    if (m_linkRate.GetBitRate() == 0 && GetNetDeviceQueueInterface())
+    {
+        // The queue interface is aggregated to the device
+        Ptr<NetDevice> device = GetNetDeviceQueueInterface()->GetObject<NetDevice>();
+        DataRateValue rate;
+        // Point-to-point devices carry the rate themselves, CSMA devices on their channel
+        if (device && (device->GetAttributeFailSafe("DataRate", rate) ||
+                       (device->GetChannel() &&
+                        device->GetChannel()->GetAttributeFailSafe("DataRate", rate))))
+        {
+            m_linkRate = rate.Get();
+            NS_LOG_LOGIC("Link rate " << m_linkRate);
+        }
+    }
+    return m_linkRate;
+}
+
+Ptr<CompressionCostModel> CompressionQueueDisc::GetCostModel()
+{
+    if (!m_costModelChecked && GetNetDeviceQueueInterface())
+    {
+        m_costModelChecked = true;
+        Ptr<NetDevice> device = GetNetDeviceQueueInterface()->GetObject<NetDevice>();
+        if (device && device->GetNode())
+        {
+            m_costModel = device->GetNode()->GetObject<CompressionCostModel>();
+        }
+    }
+    return m_costModel;
+}
+
+void CompressionQueueDisc::LevelChosen(int level, ZlibInteg::Strategy strategy)
+{
+    NS_LOG_LOGIC("Compressor chose level " << level << " with strategy " << strategy);
+    m_chosenLevel = level;
+}
+
+bool CompressionQueueDisc::DoEnqueue(Ptr<QueueDiscItem> item)
+{
+    NS_LOG_FUNCTION(this << item);
+
+    Time ready = Simulator::Now();
+    Ptr<Ipv4QueueDiscItem> ipv4Item = DynamicCast<Ipv4QueueDiscItem>(item);
+    if (ipv4Item)
+    {
+        Time work;
+        item = Compress(ipv4Item, work);
+        if (m_costModel)
+        {
+            ready += m_costModel->Process(work);
+        }
+    }
+
+    if (GetCurrentSize() + item > GetMaxSize())
+    {
+        NS_LOG_LOGIC("Queue full -- dropping pkt");
+        DropBeforeEnqueue(item, LIMIT_EXCEEDED_DROP);
+        return false;
+    }
+
+    bool retval = GetInternalQueue(0)->Enqueue(item);
+    if (retval)
+    {
+        m_readyTimes.push_back(ready);
+    }
+
+    // If Queue::Enqueue fails, QueueDisc::DropBeforeEnqueue is called by the
+    // internal queue because QueueDisc::AddInternalQueue sets the trace callback
+
+    NS_LOG_LOGIC("Number packets " << GetInternalQueue(0)->GetNPackets());
+    NS_LOG_LOGIC("Number bytes " << GetInternalQueue(0)->GetNBytes());
+
+    return retval;
+}
+
+Ptr<QueueDiscItem> CompressionQueueDisc::DoDequeue(void)
+{
+    NS_LOG_FUNCTION(this);
+
+    // The head packet is still being compressed: resume once the CPU is done
+    Time now = Simulator::Now();
+    if (!m_readyTimes.empty() && m_readyTimes.front() > now)
+    {
+        if (m_resumeEvent.IsExpired())
+        {
+            m_resumeEvent = Simulator::Schedule(m_readyTimes.front() - now, &QueueDisc::Run, this);
+        }
+        NS_LOG_LOGIC("Head packet ready in " << m_readyTimes.front() - now);
+        return nullptr;
+    }
+
+    Ptr<QueueDiscItem> item = GetInternalQueue(0)->Dequeue();
+
+    if (!item)
+    {
+        NS_LOG_LOGIC("Queue empty");
+        return nullptr;
+    }
+
+    m_readyTimes.pop_front();
+    return item;
+}
+
+bool CompressionQueueDisc::CheckConfig(void)
+{
+    NS_LOG_FUNCTION(this);
+    if (GetNQueueDiscClasses() > 0)
+    {
+        NS_LOG_ERROR("CompressionQueueDisc cannot have classes");
+        return false;
+    }
+
+    if (GetNPacketFilters() > 0)
+    {
+        NS_LOG_ERROR("CompressionQueueDisc needs no packet filter");
+        return false;
+    }
+
+    if (GetNInternalQueues() == 0)
+    {
+        // add a DropTail queue
+        AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+            "MaxSize",
+            QueueSizeValue(GetMaxSize())));
+    }
+
+    if (GetNInternalQueues() != 1)
+    {
+        NS_LOG_ERROR("CompressionQueueDisc needs 1 internal queue");
+        return false;
+    }
+
+    return true;
+}
+
+void CompressionQueueDisc::InitializeParams(void)
+{
+    NS_LOG_FUNCTION(this);
+    m_compressor->SetAttribute("Level", IntegerValue(m_level));
+    m_compressor->SetAttribute("AdaptiveLevel", BooleanValue(m_adaptiveLevel));
+    m_chosenLevel = m_level;
+    m_compressor->TraceConnectWithoutContext("ChosenLevel",
+                                             MakeCallback(&CompressionQueueDisc::LevelChosen, this));
+}
+
+} // namespace ns3
@@ -0,0 +1,115 @@
+#ifndef COMPRESSION_QUEUE_DISC_H
+#define COMPRESSION_QUEUE_DISC_H
+
+#include "ns3/compression-cost-model.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/queue-disc.h"
+#include "ns3/traced-callback.h"
+#include "ns3/zlib-integ.h"
+#include <deque>
+
+namespace ns3 {
+
+class Ipv4QueueDiscItem;
+
+/**
+ * @brief FIFO queue disc that compresses IPv4 packets on enqueue.
+ *
+ * Installed as the root queue disc on a CSMA or point-to-point device, it
+ * compresses the IPv4 payload (transport header and data) of every packet
+ * with ZlibInteg::CompressPacket() and fixes up the IPv4 payload length.
+ * Every IPv4 packet leaving the device carries a ZlibHeader, including those
+ * left uncompressed because they are shorter than MinPayloadSize or would not
+ * shrink below MaxRatio, so the peer must run a CompressionReceiveHook on its
+ * device to restore them. Non-IPv4 traffic (e.g. ARP) is queued unchanged.
+ *
+ * Uncompressed packets grow by one byte, so packets already at the device
+ * MTU leave slightly oversized.
+ *
+ * With AdaptiveLevel enabled, the compressor picks the level of every packet
+ * from the device DataRate (read from the device, or from its channel for
+ * CSMA) and the bytes already queued in this queue disc.
+ *
+ * If the node has a CompressionCostModel aggregated, every packet becomes
+ * available for dequeue only once the node's CPU has finished compressing
+ * it, so compression work shows up as latency.
+ */
+class CompressionQueueDisc : public QueueDisc
+{
+public:
+  static TypeId GetTypeId(void);
+  CompressionQueueDisc();
+  ~CompressionQueueDisc() override;
+
+  // Reasons for dropping packets
+  static constexpr const char* LIMIT_EXCEEDED_DROP = "Queue disc limit exceeded"; ///< Packet dropped because the queue disc is full
+
+  /**
+   * @brief TracedCallback signature for compression of a packet.
+   *
+   * @param originalSize IPv4 payload size before compression.
+   * @param wireSize IPv4 payload size after compression, including the ZlibHeader.
+   */
+  typedef void (*CompressTracedCallback)(uint32_t originalSize, uint32_t wireSize);
+
+  /**
+   * @brief Gets the compressor used by this queue disc.
+   */
+  Ptr<ZlibInteg> GetCompressor() const;
+
+protected:
+  void DoDispose(void) override;
+
+private:
+  bool DoEnqueue(Ptr<QueueDiscItem> item) override;
+  Ptr<QueueDiscItem> DoDequeue(void) override;
+  bool CheckConfig(void) override;
+  void InitializeParams(void) override;
+
+  /**
+   * @brief Builds the item actually queued for an IPv4 packet.
+   *
+   * @param item The item handed over by the IPv4 layer.
+   * @param work Receives the CPU time spent on the packet, if there is a cost model.
+   * @return A new item carrying the ZlibHeader and the (possibly) compressed payload
+   */
+  Ptr<QueueDiscItem> Compress(Ptr<Ipv4QueueDiscItem> item, Time& work);
+
+  /**
+   * @brief Gets the cost model of the node this queue disc runs on.
+   *
+   * @return The model, or nullptr if the node has none
+   */
+  Ptr<CompressionCostModel> GetCostModel();
+
+  /**
+   * @brief Records the level the adaptive controller chose for a packet.
+   */
+  void LevelChosen(int level, ZlibInteg::Strategy strategy);
+
+  /**
+   * @brief Gets the data rate of the device this queue disc feeds.
+   *
+   * @return The rate, or 0 bps if it cannot be determined
+   */
+  DataRate GetLinkRate();
+
+  uint32_t m_minPayloadSize;  ///< Payloads shorter than this are not compressed
+  int m_level;                ///< Compression level handed to the compressor
+  double m_maxRatio;          ///< Compressed/original ratio above which the payload is sent as is
+  bool m_adaptiveLevel;       ///< Whether the compressor picks the level per packet
+  DataRate m_linkRate;        ///< Device data rate, looked up on first use
+  Ptr<ZlibInteg> m_compressor; ///< Compressor shared by all packets of this queue disc
+  int m_chosenLevel;          ///< Level the last packet was compressed with
+  Ptr<CompressionCostModel> m_costModel;  ///< Cost model of the node, if any
+  bool m_costModelChecked;    ///< Whether the node was searched for a cost model
+  std::deque<Time> m_readyTimes;  ///< When the CPU is done with each queued packet, in queue order
+  EventId m_resumeEvent;      ///< Restarts dequeuing once the head packet is ready
+
+  TracedCallback<uint32_t, uint32_t> m_compressTrace; ///< Fired for every IPv4 packet enqueued
+};
+
+} // namespace ns3
+
+#endif /* COMPRESSION_QUEUE_DISC_H */
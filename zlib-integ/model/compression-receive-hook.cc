@@ -0,0 +1,146 @@
+#include "compression-receive-hook.h"
+#include "ns3/log.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/zlib-header.h"
+#include "ns3/traffic-control-layer.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("CompressionReceiveHook");
+
+NS_OBJECT_ENSURE_REGISTERED(CompressionReceiveHook);
+
+TypeId CompressionReceiveHook::GetTypeId(void)
+{
+  static TypeId tid = TypeId("ns3::CompressionReceiveHook")
+    .SetParent<Object>()
+    .SetGroupName("ZlibInteg")
+    .AddConstructor<CompressionReceiveHook>()
+    .AddTraceSource("Drop",
+                    "An IPv4 packet whose payload could not be decompressed was dropped.",
+                    MakeTraceSourceAccessor(&CompressionReceiveHook::m_dropTrace),
+                    "ns3::Packet::TracedCallback");
+  return tid;
+}
+
+CompressionReceiveHook::CompressionReceiveHook()
+    : m_decompressor(CreateObject<ZlibInteg>()),
+      m_costModelChecked(false)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+CompressionReceiveHook::~CompressionReceiveHook()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void CompressionReceiveHook::DoDispose(void)
+{
+    NS_LOG_FUNCTION(this);
+    m_device = nullptr;
+    m_tc = nullptr;
+    m_decompressor = nullptr;
+    m_costModel = nullptr;
+    Object::DoDispose();
+}
+
+Ptr<ZlibInteg> CompressionReceiveHook::GetDecompressor() const
+{
+    return m_decompressor;
+}
+
+void CompressionReceiveHook::Install(Ptr<NetDevice> device)
+{
+    NS_LOG_FUNCTION(this << device);
+
+    m_tc = device->GetNode()->GetObject<TrafficControlLayer>();
+    NS_ABORT_MSG_IF(!m_tc, "CompressionReceiveHook requires the internet stack on the node");
+
+    m_device = device;
+    device->AggregateObject(this);
+    device->SetPromiscReceiveCallback(MakeCallback(&CompressionReceiveHook::Receive, this));
+    device->SetReceiveCallback(MakeCallback(&CompressionReceiveHook::Discard, this));
+}
+
+bool CompressionReceiveHook::Discard(Ptr<NetDevice> /* device */,
+                                     Ptr<const Packet> /* packet */,
+                                     uint16_t /* protocol */,
+                                     const Address& /* from */)
+{
+    return true;
+}
+
+bool CompressionReceiveHook::Receive(Ptr<NetDevice> device,
+                                     Ptr<const Packet> packet,
+                                     uint16_t protocol,
+                                     const Address& from,
+                                     const Address& to,
+                                     NetDevice::PacketType packetType)
+{
+    NS_LOG_FUNCTION(this << device << packet << protocol << from << to << packetType);
+
+    // Packets for other hosts only reach promiscuous handlers, which see them as sent
+    if (protocol != Ipv4L3Protocol::PROT_NUMBER || packetType == NetDevice::PACKET_OTHERHOST)
+    {
+        m_tc->Receive(device, packet, protocol, from, to, packetType);
+        return true;
+    }
+
+    Ptr<Packet> copy = packet->Copy();
+    Ipv4Header header;
+    if (Node::ChecksumEnabled())
+    {
+        header.EnableChecksum();
+    }
+    copy->RemoveHeader(header);
+
+    uint8_t flags = 0;
+    bool compressed = copy->CopyData(&flags, 1) == 1 && (flags & ZlibHeader::COMPRESSED);
+
+    // Leave corrupted headers for the IPv4 layer to drop and account for
+    if (!header.IsChecksumOk() || !m_decompressor->DecompressPacket(copy))
+    {
+        if (header.IsChecksumOk())
+        {
+            NS_LOG_WARN("Dropping IPv4 packet whose payload could not be decompressed");
+            m_dropTrace(packet);
+            return true;
+        }
+        m_tc->Receive(device, packet, protocol, from, to, packetType);
+        return true;
+    }
+
+    header.SetPayloadSize(copy->GetSize());
+    copy->AddHeader(header);
+
+    // Looked up on first use, so the model may be aggregated after Install()
+    if (!m_costModelChecked)
+    {
+        m_costModelChecked = true;
+        m_costModel = device->GetNode()->GetObject<CompressionCostModel>();
+    }
+    if (m_costModel)
+    {
+        Time work = compressed ? m_costModel->GetInflateTime(header.GetPayloadSize())
+                               : m_costModel->GetCallOverhead();
+        Simulator::Schedule(m_costModel->Process(work),
+                            &TrafficControlLayer::Receive,
+                            m_tc,
+                            device,
+                            Ptr<const Packet>(copy),
+                            protocol,
+                            from,
+                            to,
+                            packetType);
+        return true;
+    }
+
+    m_tc->Receive(device, copy, protocol, from, to, packetType);
+    return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,89 @@
+#ifndef COMPRESSION_RECEIVE_HOOK_H
+#define COMPRESSION_RECEIVE_HOOK_H
+
+#include "ns3/compression-cost-model.h"
+#include "ns3/net-device.h"
+#include "ns3/traced-callback.h"
+#include "ns3/zlib-integ.h"
+
+namespace ns3 {
+
+class TrafficControlLayer;
+
+/**
+ * @brief Receive-side counterpart of CompressionQueueDisc.
+ *
+ * Install() takes over the receive callbacks of a device: every IPv4 packet
+ * addressed to the node has its ZlibHeader removed, its payload decompressed
+ * and its IPv4 payload length restored before it is handed to the node's
+ * traffic control layer, with the destination address and packet type the
+ * device reported, exactly as the node itself would have done. Other
+ * protocols and packets for other hosts are passed through untouched. The
+ * hook is aggregated to the device, so it lives as long as the device does.
+ *
+ * If the node has a CompressionCostModel aggregated, decompressed packets
+ * reach traffic control only once the node's CPU has inflated them.
+ *
+ * Since the node's own device dispatch is bypassed, protocol handlers
+ * registered directly on the node (rather than through the traffic control
+ * layer) no longer see packets from this device. Registering a promiscuous
+ * handler on the node after Install() would take the device back.
+ */
+class CompressionReceiveHook : public Object
+{
+public:
+  static TypeId GetTypeId(void);
+  CompressionReceiveHook();
+  ~CompressionReceiveHook() override;
+
+  /**
+   * @brief Starts decompressing the packets received by a device.
+   *
+   * Must be called after the internet stack has been installed on the node.
+   *
+   * @param device The device whose peer runs a CompressionQueueDisc.
+   */
+  void Install(Ptr<NetDevice> device);
+
+  /**
+   * @brief Gets the decompressor used by this hook.
+   */
+  Ptr<ZlibInteg> GetDecompressor() const;
+
+protected:
+  void DoDispose(void) override;
+
+private:
+  /**
+   * @brief Promiscuous receive callback installed on the device.
+   *
+   * The promiscuous callback is the one that reports the destination address
+   * and packet type, which traffic control needs to dispatch the packet.
+   */
+  bool Receive(Ptr<NetDevice> device,
+               Ptr<const Packet> packet,
+               uint16_t protocol,
+               const Address& from,
+               const Address& to,
+               NetDevice::PacketType packetType);
+
+  /**
+   * @brief Receive callback installed on the device.
+   *
+   * Devices call it after the promiscuous callback for the same packets, so
+   * it only stops the node from receiving them a second time.
+   */
+  bool Discard(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address& from);
+
+  Ptr<NetDevice> m_device;           ///< Device the hook is installed on
+  Ptr<TrafficControlLayer> m_tc;     ///< Traffic control layer of the device's node
+  Ptr<ZlibInteg> m_decompressor;     ///< Decompressor for this device
+  Ptr<CompressionCostModel> m_costModel;  ///< Cost model of the device's node, if any
+  bool m_costModelChecked;           ///< Whether the node was searched for a cost model
+
+  TracedCallback<Ptr<const Packet>> m_dropTrace; ///< Packets that could not be decompressed
+};
+
+} // namespace ns3
+
+#endif /* COMPRESSION_RECEIVE_HOOK_H */
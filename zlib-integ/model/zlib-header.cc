@@ -0,0 +1,91 @@
+#include "zlib-header.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("ZlibHeader");
+
+NS_OBJECT_ENSURE_REGISTERED(ZlibHeader);
+
+TypeId ZlibHeader::GetTypeId(void)
+{
+  static TypeId tid = TypeId("ns3::ZlibHeader")
+    .SetParent<Header>()
+    .SetGroupName("ZlibInteg")
+    .AddConstructor<ZlibHeader>();
+  return tid;
+}
+
+TypeId ZlibHeader::GetInstanceTypeId(void) const
+{
+  return GetTypeId();
+}
+
+ZlibHeader::ZlibHeader()
+    : m_flags(0),
+      m_originalSize(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+ZlibHeader::~ZlibHeader()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void ZlibHeader::SetFlags(uint8_t flags)
+{
+    m_flags = flags;
+}
+
+uint8_t ZlibHeader::GetFlags() const
+{
+    return m_flags;
+}
+
+bool ZlibHeader::IsCompressed() const
+{
+    return (m_flags & COMPRESSED) != 0;
+}
+
+void ZlibHeader::SetOriginalSize(uint32_t size)
+{
+    m_originalSize = size;
+}
+
+uint32_t ZlibHeader::GetOriginalSize() const
+{
+    return m_originalSize;
+}
+
+void ZlibHeader::Print(std::ostream& os) const
+{
+    os << "flags=0x" << std::hex << static_cast<uint32_t>(m_flags) << std::dec;
+    if (IsCompressed())
+    {
+        os << " originalSize=" << m_originalSize;
+    }
+}
+
+uint32_t ZlibHeader::GetSerializedSize(void) const
+{
+    return IsCompressed() ? 5 : 1;
+}
+
+void ZlibHeader::Serialize(Buffer::Iterator start) const
+{
+    start.WriteU8(m_flags);
+    if (IsCompressed())
+    {
+        start.WriteHtonU32(m_originalSize);
+    }
+}
+
+uint32_t ZlibHeader::Deserialize(Buffer::Iterator start)
+{
+    m_flags = start.ReadU8();
+    m_originalSize = IsCompressed() ? start.ReadNtohU32() : 0;
+    return GetSerializedSize();
+}
+
+} // namespace ns3
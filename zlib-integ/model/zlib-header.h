@@ -0,0 +1,70 @@
+#ifndef ZLIB_HEADER_H
+#define ZLIB_HEADER_H
+
+#include "ns3/header.h"
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * @brief Header prepended to packets transformed by ZlibInteg::CompressPacket().
+ *
+ * The header is one byte of flags, followed by the original payload length
+ * (4 bytes, network order) only when the payload is compressed. Payloads that
+ * were left uncompressed therefore cost a single byte.
+ */
+class ZlibHeader : public Header
+{
+public:
+  /**
+   * @brief Bits of the flags field.
+   */
+  enum Flags : uint8_t
+  {
+    COMPRESSED = 0x01,  ///< The payload following the header is compressed with ZlibInteg's codec
+  };
+
+  static TypeId GetTypeId(void);
+  TypeId GetInstanceTypeId(void) const override;
+
+  ZlibHeader();
+  ~ZlibHeader() override;
+
+  /**
+   * @brief Sets the flags field.
+   */
+  void SetFlags(uint8_t flags);
+
+  /**
+   * @brief Gets the flags field.
+   */
+  uint8_t GetFlags() const;
+
+  /**
+   * @brief Whether the payload following the header is compressed.
+   */
+  bool IsCompressed() const;
+
+  /**
+   * @brief Sets the length of the payload before compression.
+   */
+  void SetOriginalSize(uint32_t size);
+
+  /**
+   * @brief Gets the length of the payload before compression.
+   */
+  uint32_t GetOriginalSize() const;
+
+  void Print(std::ostream& os) const override;
+  uint32_t GetSerializedSize(void) const override;
+  void Serialize(Buffer::Iterator start) const override;
+  uint32_t Deserialize(Buffer::Iterator start) override;
+
+private:
+  uint8_t m_flags;          ///< Flags field
+  uint32_t m_originalSize;  ///< Payload length before compression
+};
+
+} // namespace ns3
+
+#endif /* ZLIB_HEADER_H */
@@ -1,27 +1,804 @@
 #include "zlib-integ.h"
+#include "zlib-header.h"
+#include "zlib-memory-pool.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/hash.h"
+#include "ns3/integer.h"
+#include "ns3/nstime.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
 #include <zlib.h> // The zlib library header
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
 #include <iostream>
+#include <queue>
+#include <streambuf>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 
 namespace ns3 {
 
 // Define a logging component for this module
 NS_LOG_COMPONENT_DEFINE("ZlibInteg");
 
+// Deflate cannot expand data by more than this factor, which bounds the
+// original length a size prefix may legitimately declare
+static const uint64_t MAX_DEFLATE_RATIO = 1032;
+
+// Per-packet flow header: flags byte followed by a 16-bit sequence number
+static const size_t FLOW_HEADER_SIZE = 3;
+static const uint8_t FLOW_RESYNC = 0x01;
+
+// Empty stored block emitted by every Z_SYNC_FLUSH; implied on the wire
+static const uint8_t SYNC_FLUSH_TAIL[] = {0x00, 0x00, 0xff, 0xff};
+
+// zlib framing: header with a dictionary ID, and the Adler-32 trailer
+static const size_t ZLIB_HEADER_MAX_SIZE = 6;
+static const size_t ZLIB_TRAILER_SIZE = 4;
+
+// gzip framing without optional fields, and the CRC-32 and length trailer
+static const size_t GZIP_HEADER_SIZE = 10;
+static const size_t GZIP_TRAILER_SIZE = 8;
+
+// Stored block emitted by a Z_SYNC_FLUSH at the end of a parallel deflate block,
+// plus the bits still pending before it
+static const size_t SYNC_FLUSH_OVERHEAD = 6;
+
+// Seekable container: per-block index entries (compressed and uncompressed
+// offsets) and the footer (total uncompressed size, block count, magic)
+static const size_t SEEKABLE_ENTRY_SIZE = 16;
+static const size_t SEEKABLE_FOOTER_SIZE = 16;
+static const uint32_t SEEKABLE_MAGIC = 0x5a534958; // "ZSIX"
+
+// Compressibility estimate: bytes sampled, in chunks spread over the input
+static const size_t ENTROPY_SAMPLE_SIZE = 4096;
+static const size_t ENTROPY_CHUNK_SIZE = 64;
+
+// Output chunk handed to an InflateStream() sink
+static const size_t INFLATE_CHUNK_SIZE = 16384;
+
+// Largest stored deflate block
+static const size_t MAX_STORED_BLOCK = 65535;
+
+// Memory a cache entry takes besides its input and output: list and index
+// nodes plus the vector headers
+static const size_t CACHE_ENTRY_OVERHEAD = 128;
+
+// Adaptive level controller: weight of a new measurement in the moving
+// averages, and packets between re-measurements of a candidate
+static const double ADAPTIVE_ALPHA = 0.125;
+static const uint32_t ADAPTIVE_EXPLORE_INTERVAL = 32;
+
+// Dictionary training: length of the substrings counted across samples, and
+// of the candidate segments (taken every half segment) the dictionary is built from
+static const size_t TRAIN_GRAM_SIZE = 8;
+static const size_t TRAIN_SEGMENT_SIZE = 64;
+
+namespace {
+
+/**
+ * Runs inflate(), answering a Z_NEED_DICT request from the registered dictionaries.
+ *
+ * zlib stops right after the stream header when the stream was compressed
+ * against a preset dictionary; stream->adler then holds the dictionary ID.
+ * Worker threads run it too, so it does not log; callers report errors.
+ */
+int
+InflateWithDictionary(z_stream* stream,
+                      int flush,
+                      const std::map<uint32_t, std::vector<uint8_t>>& dictionaries)
+{
+    int result = inflate(stream, flush);
+    if (result != Z_NEED_DICT)
+    {
+        return result;
+    }
+
+    auto it = dictionaries.find(static_cast<uint32_t>(stream->adler));
+    if (it == dictionaries.end())
+    {
+        return Z_NEED_DICT;
+    }
+    result = inflateSetDictionary(stream, it->second.data(), static_cast<uInt>(it->second.size()));
+    if (result != Z_OK)
+    {
+        return result;
+    }
+    return inflate(stream, flush);
+}
+
+/**
+ * Runs a worker function on the calling thread and threads - 1 extra threads.
+ *
+ * Workers pull their tasks from a shared atomic counter, so they keep any
+ * per-thread state (such as a z_stream) across tasks.
+ */
+void
+RunWorkers(size_t threads, const std::function<void()>& worker)
+{
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++)
+    {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers)
+    {
+        thread.join();
+    }
+}
+
+void
+WriteBigEndian(uint64_t value, size_t bytes, uint8_t* output)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        output[i] = static_cast<uint8_t>(value >> (8 * (bytes - 1 - i)));
+    }
+}
+
+uint64_t
+ReadBigEndian(const uint8_t* input, size_t bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        value = (value << 8) | input[i];
+    }
+    return value;
+}
+
+/**
+ * Points a stream's allocator at the shared memory pool, or at zlib's default.
+ */
+void
+SetAllocator(z_stream& stream, bool pooled)
+{
+    stream.zalloc = pooled ? &ZlibMemoryPool::Alloc : Z_NULL;
+    stream.zfree = pooled ? &ZlibMemoryPool::Free : Z_NULL;
+    stream.opaque = pooled ? ZlibMemoryPool::Get() : Z_NULL;
+}
+
+/**
+ * Writes the stream header of a format: for zlib (RFC 1950) method and
+ * window size, level hint, and the preset dictionary ID if there is one; for
+ * gzip (RFC 1952) the fixed header without optional fields; nothing for raw.
+ *
+ * @return The header size
+ */
+size_t
+WriteStreamHeader(uint8_t* output, ZlibInteg::Format format, uint8_t windowBits, int level, uint32_t dictionaryId)
+{
+    level = level == Z_DEFAULT_COMPRESSION ? 6 : level;
+    if (format == ZlibInteg::FORMAT_RAW)
+    {
+        return 0;
+    }
+    if (format == ZlibInteg::FORMAT_GZIP)
+    {
+        static const uint8_t header[] = {0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 0xff};
+        std::memcpy(output, header, GZIP_HEADER_SIZE);
+        output[8] = level == 9 ? 2 : level == 1 ? 4 : 0; // XFL: slowest or fastest compression
+        return GZIP_HEADER_SIZE;
+    }
+
+    uint8_t cmf = static_cast<uint8_t>(((windowBits - 8) << 4) | Z_DEFLATED);
+    uint8_t levelHint = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    uint8_t flg = static_cast<uint8_t>((levelHint << 6) | (dictionaryId != 0 ? 0x20 : 0));
+    flg |= 31 - ((cmf << 8) | flg) % 31;
+    output[0] = cmf;
+    output[1] = flg;
+    if (dictionaryId == 0)
+    {
+        return 2;
+    }
+    WriteBigEndian(dictionaryId, 4, output + 2);
+    return ZLIB_HEADER_MAX_SIZE;
+}
+
+/**
+ * Size of the stream trailer of a format.
+ */
+size_t
+GetTrailerSize(ZlibInteg::Format format)
+{
+    return format == ZlibInteg::FORMAT_ZLIB ? ZLIB_TRAILER_SIZE
+           : format == ZlibInteg::FORMAT_GZIP ? GZIP_TRAILER_SIZE
+                                               : 0;
+}
+
+/**
+ * Updates the checksum a format's trailer carries: Adler-32 for zlib,
+ * CRC-32 for gzip. Start with data == nullptr.
+ */
+uLong
+UpdateChecksum(ZlibInteg::Format format, uLong checksum, const uint8_t* data, size_t size)
+{
+    return format == ZlibInteg::FORMAT_GZIP ? crc32(checksum, data, static_cast<uInt>(size))
+                                            : adler32(checksum, data, static_cast<uInt>(size));
+}
+
+/**
+ * Writes the stream trailer of a format.
+ *
+ * @param checksum Checksum of the whole input, from UpdateChecksum().
+ * @param inputSize Size of the whole input.
+ * @return The trailer size
+ */
+size_t
+WriteStreamTrailer(uint8_t* output, ZlibInteg::Format format, uLong checksum, uint64_t inputSize)
+{
+    if (format == ZlibInteg::FORMAT_ZLIB)
+    {
+        WriteBigEndian(checksum, ZLIB_TRAILER_SIZE, output);
+    }
+    else if (format == ZlibInteg::FORMAT_GZIP)
+    {
+        // Little-endian CRC-32, then the input size modulo 2^32
+        for (size_t i = 0; i < 4; i++)
+        {
+            output[i] = static_cast<uint8_t>(checksum >> (8 * i));
+            output[4 + i] = static_cast<uint8_t>(inputSize >> (8 * i));
+        }
+    }
+    return GetTrailerSize(format);
+}
+
+/**
+ * Creates the backend of a built-in codec, or nullptr for zlib.
+ */
+Ptr<CompressionBackend>
+CreateBackend(ZlibInteg::Codec codec)
+{
+    switch (codec)
+    {
+    case ZlibInteg::CODEC_LZ4:
+#ifdef HAVE_LZ4
+        return CreateObject<Lz4Backend>();
+#else
+        NS_ABORT_MSG("The lz4 codec was selected, but lz4 was not found when building zlib-integ");
+#endif
+    case ZlibInteg::CODEC_ZSTD:
+#ifdef HAVE_ZSTD
+        return CreateObject<ZstdBackend>();
+#else
+        NS_ABORT_MSG("The zstd codec was selected, but zstd was not found when building zlib-integ");
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * Output stream buffer that hands everything written to it to a z_stream.
+ *
+ * Packet::CopyData(std::ostream*, ...) walks the packet buffer chunk by chunk,
+ * so this lets zlib consume packet bytes in place instead of from a copy.
+ * The caller sets up next_out/avail_out on the stream beforehand.
+ */
+class ZStreamBuf : public std::streambuf
+{
+  public:
+    ZStreamBuf(z_stream* stream,
+               bool deflating,
+               uint32_t skip,
+               const std::map<uint32_t, std::vector<uint8_t>>* dictionaries = nullptr)
+        : m_stream(stream),
+          m_deflating(deflating),
+          m_skip(skip),
+          m_dictionaries(dictionaries),
+          m_result(Z_OK)
+    {
+    }
+
+    /**
+     * Terminates a deflate stream once all input has been written.
+     * @return Z_STREAM_END on success, or the zlib error code
+     */
+    int Finish()
+    {
+        m_stream->next_in = Z_NULL;
+        m_stream->avail_in = 0;
+        while (m_result == Z_OK)
+        {
+            uInt availOut = m_stream->avail_out;
+            m_result = deflate(m_stream, Z_FINISH);
+            if (m_result == Z_OK && m_stream->avail_out == availOut)
+            {
+                m_result = Z_BUF_ERROR;
+            }
+        }
+        return m_result;
+    }
+
+    /**
+     * @return The last zlib status (Z_STREAM_END once an inflate stream is complete)
+     */
+    int GetResult() const
+    {
+        return m_result;
+    }
+
+  protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        return Feed(reinterpret_cast<const uint8_t*>(s), n) ? n : 0;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            return traits_type::not_eof(c);
+        }
+        uint8_t byte = static_cast<uint8_t>(c);
+        return Feed(&byte, 1) ? c : traits_type::eof();
+    }
+
+  private:
+    bool Feed(const uint8_t* data, size_t size)
+    {
+        size_t skipped = std::min<size_t>(m_skip, size);
+        m_skip -= skipped;
+        data += skipped;
+        size -= skipped;
+        if (size == 0)
+        {
+            return m_result == Z_OK || m_result == Z_STREAM_END;
+        }
+        if (m_result != Z_OK)
+        {
+            // Either an earlier error, or input past the end of the stream
+            m_result = m_result == Z_STREAM_END ? Z_DATA_ERROR : m_result;
+            return false;
+        }
+
+        m_stream->next_in = const_cast<Bytef*>(data);
+        m_stream->avail_in = static_cast<uInt>(size);
+        while (m_stream->avail_in > 0 && m_result == Z_OK)
+        {
+            uInt availIn = m_stream->avail_in;
+            uInt availOut = m_stream->avail_out;
+            if (m_deflating)
+            {
+                m_result = deflate(m_stream, Z_NO_FLUSH);
+            }
+            else
+            {
+                m_result = m_dictionaries
+                               ? InflateWithDictionary(m_stream, Z_NO_FLUSH, *m_dictionaries)
+                               : inflate(m_stream, Z_NO_FLUSH);
+            }
+            if (m_result == Z_OK && m_stream->avail_in == availIn && m_stream->avail_out == availOut)
+            {
+                m_result = Z_BUF_ERROR;
+            }
+        }
+        if (m_result == Z_STREAM_END && m_stream->avail_in > 0)
+        {
+            m_result = Z_DATA_ERROR;
+        }
+        return m_result == Z_OK || m_result == Z_STREAM_END;
+    }
+
+    z_stream* m_stream;
+    bool m_deflating;
+    uint32_t m_skip;
+    const std::map<uint32_t, std::vector<uint8_t>>* m_dictionaries;
+    int m_result;
+};
+
+/**
+ * Distance between the starts of consecutive entropy sample chunks.
+ * @param size Input size, larger than ENTROPY_SAMPLE_SIZE
+ */
+size_t GetEntropyChunkStride(size_t size)
+{
+    return (size - ENTROPY_CHUNK_SIZE) / (ENTROPY_SAMPLE_SIZE / ENTROPY_CHUNK_SIZE - 1);
+}
+
+/**
+ * Output stream buffer that keeps the entropy sample chunks of the bytes
+ * written to it and drops everything else.
+ *
+ * Lets CompressPacket() sample a packet the way EstimateEntropy() samples a
+ * buffer, with chunks spread over the whole payload, without copying the
+ * payload out first.
+ */
+class EntropySampleBuf : public std::streambuf
+{
+  public:
+    /**
+     * @param size Payload size, larger than ENTROPY_SAMPLE_SIZE
+     * @param sample Receives the ENTROPY_SAMPLE_SIZE sampled bytes
+     */
+    EntropySampleBuf(size_t size, uint8_t* sample)
+        : m_stride(GetEntropyChunkStride(size)),
+          m_sample(sample),
+          m_position(0),
+          m_sampled(0)
+    {
+    }
+
+    /**
+     * @return Number of payload bytes that must be written to fill the sample
+     */
+    size_t GetSampleEnd() const
+    {
+        return (ENTROPY_SAMPLE_SIZE / ENTROPY_CHUNK_SIZE - 1) * m_stride + ENTROPY_CHUNK_SIZE;
+    }
+
+  protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        Feed(reinterpret_cast<const uint8_t*>(s), n);
+        return n;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            return traits_type::not_eof(c);
+        }
+        uint8_t byte = static_cast<uint8_t>(c);
+        Feed(&byte, 1);
+        return c;
+    }
+
+  private:
+    void Feed(const uint8_t* data, size_t size)
+    {
+        size_t end = m_position + size;
+        while (m_sampled < ENTROPY_SAMPLE_SIZE)
+        {
+            // Next byte still missing from the sample, as a payload offset
+            size_t chunk = m_sampled / ENTROPY_CHUNK_SIZE;
+            size_t wanted = chunk * m_stride + m_sampled % ENTROPY_CHUNK_SIZE;
+            size_t chunkEnd = chunk * m_stride + ENTROPY_CHUNK_SIZE;
+            if (wanted >= end)
+            {
+                break;
+            }
+            size_t from = std::max(wanted, m_position);
+            size_t length = std::min(chunkEnd, end) - from;
+            std::memcpy(m_sample + m_sampled, data + (from - m_position), length);
+            m_sampled += length;
+        }
+        m_position = end;
+    }
+
+    size_t m_stride;
+    uint8_t* m_sample;
+    size_t m_position;
+    size_t m_sampled;
+};
+
+} // namespace
+
 TypeId ZlibInteg::GetTypeId(void)
 {
   static TypeId tid = TypeId("ns3::ZlibInteg")
     .SetParent<Object>()
-    .SetGroupName("ZlibInteg");
+    .SetGroupName("ZlibInteg")
+    .AddConstructor<ZlibInteg>()
+    .AddAttribute("Level",
+                  "Compression level: -1 selects the zlib default, 0 stores, 1-9 trade speed for ratio.",
+                  IntegerValue(Z_DEFAULT_COMPRESSION),
+                  MakeIntegerAccessor(&ZlibInteg::m_level),
+                  MakeIntegerChecker<int>(-1, 9))
+    .AddAttribute("WindowBits",
+                  "Base two logarithm of the history window size, used for both deflate and inflate.",
+                  UintegerValue(MAX_WBITS),
+                  MakeUintegerAccessor(&ZlibInteg::m_windowBits),
+                  MakeUintegerChecker<uint8_t>(9, MAX_WBITS))
+    .AddAttribute("MemLevel",
+                  "Memory allocated for the internal compression state (1 = least, 9 = fastest).",
+                  UintegerValue(8),
+                  MakeUintegerAccessor(&ZlibInteg::m_memLevel),
+                  MakeUintegerChecker<uint8_t>(1, MAX_MEM_LEVEL))
+    .AddAttribute("Strategy",
+                  "Deflate strategy, unless AdaptiveLevel picks one per packet.",
+                  EnumValue(ZlibInteg::DEFAULT_STRATEGY),
+                  MakeEnumAccessor<Strategy>(&ZlibInteg::m_strategy),
+                  MakeEnumChecker(ZlibInteg::DEFAULT_STRATEGY, "Default",
+                                  ZlibInteg::FILTERED, "Filtered",
+                                  ZlibInteg::HUFFMAN_ONLY, "HuffmanOnly",
+                                  ZlibInteg::RLE, "Rle",
+                                  ZlibInteg::FIXED, "Fixed"))
+    .AddAttribute("Format",
+                  "Framing of the streams: zlib, raw deflate (no header or trailer) or gzip. "
+                  "Preset dictionaries need the zlib framing.",
+                  EnumValue(ZlibInteg::FORMAT_ZLIB),
+                  MakeEnumAccessor<Format>(&ZlibInteg::m_format),
+                  MakeEnumChecker(ZlibInteg::FORMAT_ZLIB, "Zlib",
+                                  ZlibInteg::FORMAT_RAW, "Raw",
+                                  ZlibInteg::FORMAT_GZIP, "Gzip"))
+    .AddAttribute("Codec",
+                  "Codec Deflate, Inflate, CompressPacket and DecompressPacket use. "
+                  "Lz4 and Zstd are only available if found at build time.",
+                  EnumValue(ZlibInteg::CODEC_ZLIB),
+                  MakeEnumAccessor<Codec>(&ZlibInteg::m_codec),
+                  MakeEnumChecker(ZlibInteg::CODEC_ZLIB, "Zlib",
+                                  ZlibInteg::CODEC_LZ4, "Lz4",
+                                  ZlibInteg::CODEC_ZSTD, "Zstd"))
+    .AddAttribute("MemoryPool",
+                  "Allocate zlib's state from the process-wide ZlibMemoryPool, which recycles "
+                  "blocks across ZlibInteg objects, instead of malloc.",
+                  BooleanValue(true),
+                  MakeBooleanAccessor(&ZlibInteg::m_memoryPool),
+                  MakeBooleanChecker())
+    .AddAttribute("SizePrefix",
+                  "Prefix each compressed stream with its original length as a varint, "
+                  "so Inflate can decompress in one pass into an exactly sized buffer.",
+                  BooleanValue(false),
+                  MakeBooleanAccessor(&ZlibInteg::m_sizePrefix),
+                  MakeBooleanChecker())
+    .AddAttribute("MaxInflateSize",
+                  "Largest decompressed size Inflate, InflateStream, DecompressPacket and "
+                  "InflateFlow accept before failing, guarding against decompression bombs "
+                  "(0 = unlimited).",
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_maxInflateSize),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("FlowResyncInterval",
+                  "Number of packets after which DeflateFlow restarts a flow's history, "
+                  "bounding how long a receiver stays out of sync after a loss (0 = only on ResetFlow).",
+                  UintegerValue(32),
+                  MakeUintegerAccessor(&ZlibInteg::m_flowResyncInterval),
+                  MakeUintegerChecker<uint32_t>())
+    .AddAttribute("DictionaryId",
+                  "ID of the preset dictionary (registered with AddDictionary) that Deflate "
+                  "primes its context with (0 = none).",
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_dictionaryId),
+                  MakeUintegerChecker<uint32_t>())
+    .AddAttribute("Threads",
+                  "Worker threads Deflate uses for inputs larger than BlockSize (1 = serial).",
+                  UintegerValue(1),
+                  MakeUintegerAccessor(&ZlibInteg::m_threads),
+                  MakeUintegerChecker<uint32_t>(1, 256))
+    .AddAttribute("BlockSize",
+                  "Input bytes compressed per block when Deflate runs on several threads, "
+                  "and the random-access granularity of DeflateSeekable.",
+                  UintegerValue(128 * 1024),
+                  MakeUintegerAccessor(&ZlibInteg::m_blockSize),
+                  MakeUintegerChecker<uint32_t>(4 * 1024))
+    .AddAttribute("SkipEntropy",
+                  "Estimated entropy, in bits per byte, above which Deflate and CompressPacket "
+                  "pass data through instead of compressing it (8 = always compress).",
+                  DoubleValue(7.5),
+                  MakeDoubleAccessor(&ZlibInteg::m_skipEntropy),
+                  MakeDoubleChecker<double>(0.0, 8.0))
+    .AddAttribute("CacheSize",
+                  "Memory budget, in bytes, of the cache of recent Deflate and CompressPacket "
+                  "outputs, which spares recompressing repeated payloads (0 = no cache).",
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_cacheSize),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("AdaptiveLevel",
+                  "Let CompressPacket pick the level and strategy of every packet from measured "
+                  "costs and the link state reported by SetLinkState.",
+                  BooleanValue(false),
+                  MakeBooleanAccessor(&ZlibInteg::m_adaptive),
+                  MakeBooleanChecker())
+    .AddAttribute("CpuBudget",
+                  "In adaptive mode, the largest CPU time a packet may be compressed with, "
+                  "as a fraction of its transmission time on the link.",
+                  DoubleValue(1.0),
+                  MakeDoubleAccessor(&ZlibInteg::m_cpuBudget),
+                  MakeDoubleChecker<double>(0.0))
+    .AddAttribute("DeflateCalls",
+                  "Number of compression calls made so far.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_deflateCalls),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("DeflateFailures",
+                  "Number of compression calls that failed.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_deflateFailures),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("DeflateBytesIn",
+                  "Input bytes of the successful compression calls.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_deflateBytesIn),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("DeflateBytesOut",
+                  "Output bytes of the successful compression calls.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_deflateBytesOut),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("DeflateTime",
+                  "Wall-clock time spent in compression calls.",
+                  TypeId::ATTR_GET,
+                  TimeValue(Time(0)),
+                  MakeTimeAccessor(&ZlibInteg::m_deflateTime),
+                  MakeTimeChecker())
+    .AddAttribute("InflateCalls",
+                  "Number of decompression calls made so far.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_inflateCalls),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("InflateFailures",
+                  "Number of decompression calls that failed.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_inflateFailures),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("InflateBytesIn",
+                  "Input bytes of the successful decompression calls.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_inflateBytesIn),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("InflateBytesOut",
+                  "Output bytes of the successful decompression calls.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_inflateBytesOut),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("InflateTime",
+                  "Wall-clock time spent in decompression calls.",
+                  TypeId::ATTR_GET,
+                  TimeValue(Time(0)),
+                  MakeTimeAccessor(&ZlibInteg::m_inflateTime),
+                  MakeTimeChecker())
+    .AddAttribute("CompressedCount",
+                  "Number of Deflate() and CompressPacket() calls that ran deflate, "
+                  "not counting those answered from the cache (see CacheHits).",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_compressedCount),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("SkippedCount",
+                  "Number of Deflate() and CompressPacket() calls whose input was judged "
+                  "incompressible and passed through.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_skippedCount),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("CacheHits",
+                  "Number of compressions served from the cache.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_cacheHits),
+                  MakeUintegerChecker<uint64_t>())
+    .AddAttribute("CacheMisses",
+                  "Number of cache lookups that had to compress.",
+                  TypeId::ATTR_GET,
+                  UintegerValue(0),
+                  MakeUintegerAccessor(&ZlibInteg::m_cacheMisses),
+                  MakeUintegerChecker<uint64_t>())
+    .AddTraceSource("ChosenLevel",
+                    "The adaptive controller chose the level and strategy for a packet.",
+                    MakeTraceSourceAccessor(&ZlibInteg::m_levelTrace),
+                    "ns3::ZlibInteg::LevelTracedCallback")
+    .AddTraceSource("Deflate",
+                    "A compression call succeeded: input bytes, output bytes, wall-clock time.",
+                    MakeTraceSourceAccessor(&ZlibInteg::m_deflateTrace),
+                    "ns3::ZlibInteg::OperationTracedCallback")
+    .AddTraceSource("Inflate",
+                    "A decompression call succeeded: input bytes, output bytes, wall-clock time.",
+                    MakeTraceSourceAccessor(&ZlibInteg::m_inflateTrace),
+                    "ns3::ZlibInteg::OperationTracedCallback")
+    .AddTraceSource("DeflateFailure",
+                    "A compression call failed with a zlib error code.",
+                    MakeTraceSourceAccessor(&ZlibInteg::m_deflateFailureTrace),
+                    "ns3::ZlibInteg::FailureTracedCallback")
+    .AddTraceSource("InflateFailure",
+                    "A decompression call failed with a zlib error code.",
+                    MakeTraceSourceAccessor(&ZlibInteg::m_inflateFailureTrace),
+                    "ns3::ZlibInteg::FailureTracedCallback");
   return tid;
 }
 
-ZlibInteg::ZlibInteg() {
+ZlibInteg::ZlibInteg()
+    : m_strategy(DEFAULT_STRATEGY),
+      m_memoryPool(true),
+      m_maxInflateSize(0),
+      m_format(FORMAT_ZLIB),
+      m_codec(CODEC_ZLIB),
+      m_backendCodec(CODEC_ZLIB),
+      m_deflateStream(nullptr),
+      m_inflateStream(nullptr),
+      m_deflateLevel(0),
+      m_deflateWindowBits(0),
+      m_deflateMemLevel(0),
+      m_deflateStrategy(DEFAULT_STRATEGY),
+      m_inflateWindowBits(0),
+      m_threads(1),
+      m_blockSize(128 * 1024),
+      m_dictionaryId(0),
+      m_skipEntropy(7.5),
+      m_compressedCount(0),
+      m_skippedCount(0),
+      m_cacheSize(0),
+      m_cacheBytes(0),
+      m_cacheHits(0),
+      m_cacheMisses(0),
+      m_adaptive(false),
+      m_cpuBudget(1.0),
+      m_backlogBytes(0),
+      m_adaptivePackets(0),
+      m_nextExplored(0),
+      m_operationDepth(0),
+      m_deflateCalls(0),
+      m_deflateFailures(0),
+      m_deflateBytesIn(0),
+      m_deflateBytesOut(0),
+      m_inflateCalls(0),
+      m_inflateFailures(0),
+      m_inflateBytesIn(0),
+      m_inflateBytesOut(0)
+{
     NS_LOG_FUNCTION(this);
+
+    // Storing costs nothing and saves nothing, so it needs no measurement
+    m_candidates = {{0, DEFAULT_STRATEGY, 0.0, 1.0, 1},
+                    {1, HUFFMAN_ONLY, 0.0, 1.0, 0},
+                    {1, RLE, 0.0, 1.0, 0},
+                    {1, DEFAULT_STRATEGY, 0.0, 1.0, 0},
+                    {3, DEFAULT_STRATEGY, 0.0, 1.0, 0},
+                    {6, DEFAULT_STRATEGY, 0.0, 1.0, 0},
+                    {9, DEFAULT_STRATEGY, 0.0, 1.0, 0}};
 }
 
 ZlibInteg::~ZlibInteg() {
     NS_LOG_FUNCTION(this);
+    ReleaseStreams();
+}
+
+void ZlibInteg::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    ReleaseStreams();
+    ClearCache();
+    m_backend = nullptr;
+    m_customBackend = nullptr;
+    Object::DoDispose();
+}
+
+void ZlibInteg::ReleaseStreams()
+{
+    for (auto& flow : m_deflateFlows)
+    {
+        ReleaseFlowState(flow.second, true);
+    }
+    m_deflateFlows.clear();
+    for (auto& flow : m_inflateFlows)
+    {
+        ReleaseFlowState(flow.second, false);
+    }
+    m_inflateFlows.clear();
+
+    if (m_deflateStream)
+    {
+        deflateEnd(m_deflateStream);
+        delete m_deflateStream;
+        m_deflateStream = nullptr;
+    }
+    if (m_inflateStream)
+    {
+        inflateEnd(m_inflateStream);
+        delete m_inflateStream;
+        m_inflateStream = nullptr;
+    }
 }
 
 std::string ZlibInteg::GetVersion()
@@ -29,106 +806,2382 @@ std::string ZlibInteg::GetVersion()
     return zlibVersion();
 }
 
-// --- Implementation of Deflate (Compression) using the one-shot compress() function ---
-std::vector<uint8_t> ZlibInteg::Deflate(const std::vector<uint8_t>& inputData)
+void ZlibInteg::SetBackend(Ptr<CompressionBackend> backend)
 {
-    NS_LOG_FUNCTION(this);
+    NS_LOG_FUNCTION(this << backend);
+    m_customBackend = backend;
+}
 
-    if (inputData.empty())
+Ptr<CompressionBackend> ZlibInteg::GetBackend()
+{
+    if (m_customBackend)
     {
-        NS_LOG_WARN("Input data for deflate is empty.");
-        return {};
+        return m_customBackend;
+    }
+    if (m_backendCodec != m_codec)
+    {
+        m_backend = CreateBackend(m_codec);
+        m_backendCodec = m_codec;
     }
+    return m_backend;
+}
 
-    // Determine the maximum possible compressed size using compressBound
-    uLongf compressedSize = compressBound(inputData.size());
-    
-    // Create a vector to hold the compressed data
-    std::vector<uint8_t> compressedData(compressedSize);
+bool ZlibInteg::IsZlibCodec() const
+{
+    return !m_customBackend && m_codec == CODEC_ZLIB;
+}
+
+int ZlibInteg::GetStreamWindowBits() const
+{
+    return m_format == FORMAT_RAW ? -m_windowBits : m_format == FORMAT_GZIP ? m_windowBits + 16 : m_windowBits;
+}
 
-    // Perform the compression in a single call
-    int result = compress(
-        compressedData.data(),      // destination buffer
-        &compressedSize,            // destination size (will be updated)
-        inputData.data(),           // source buffer
-        inputData.size()            // source size
-    );
+bool ZlibInteg::EnsureDeflateStream()
+{
+    return EnsureDeflateStream(m_level, m_strategy);
+}
 
-    if (result != Z_OK)
+bool ZlibInteg::EnsureDeflateStream(int level, Strategy strategy)
+{
+    int windowBits = GetStreamWindowBits();
+    if (m_deflateStream && m_deflateWindowBits == windowBits && m_deflateMemLevel == m_memLevel)
     {
-        NS_LOG_ERROR("compress failed with error code: " << result);
-        return {}; // Return empty vector on failure
+        if (m_deflateLevel == level && m_deflateStrategy == strategy)
+        {
+            return true;
+        }
+
+        // The window and hash tables only depend on windowBits and memLevel;
+        // on a freshly reset stream deflateParams() neither flushes nor allocates
+        deflateReset(m_deflateStream);
+        int result = deflateParams(m_deflateStream, level, static_cast<int>(strategy));
+        if (result != Z_OK)
+        {
+            NS_LOG_ERROR("deflateParams failed with error code: " << result);
+            return false;
+        }
+        m_deflateLevel = level;
+        m_deflateStrategy = strategy;
+        return true;
     }
 
-    // Resize the vector to the actual compressed size
-    compressedData.resize(compressedSize);
+    if (m_deflateStream)
+    {
+        NS_LOG_LOGIC("Window size, memory level or format changed, re-creating the deflate context");
+        deflateEnd(m_deflateStream);
+    }
+    else
+    {
+        m_deflateStream = new z_stream;
+    }
 
-    return compressedData;
-}
+    SetAllocator(*m_deflateStream, m_memoryPool);
 
+    int result = deflateInit2(m_deflateStream, level, Z_DEFLATED, windowBits, m_memLevel,
+                              static_cast<int>(strategy));
+    if (result != Z_OK)
+    {
+        NS_LOG_ERROR("deflateInit2 failed with error code: " << result);
+        delete m_deflateStream;
+        m_deflateStream = nullptr;
+        return false;
+    }
 
-// --- Implementation of Inflate (Decompression) using streaming approach ---
-std::vector<uint8_t> ZlibInteg::Inflate(const std::vector<uint8_t>& compressedData)
+    m_deflateLevel = level;
+    m_deflateStrategy = strategy;
+    m_deflateWindowBits = windowBits;
+    m_deflateMemLevel = m_memLevel;
+    return true;
+}
+
+bool ZlibInteg::EnsureInflateStream()
 {
-    NS_LOG_FUNCTION(this);
+    int windowBits = GetStreamWindowBits();
+    if (m_inflateStream && m_inflateWindowBits == windowBits)
+    {
+        return true;
+    }
 
-    if (compressedData.empty()) {
-        NS_LOG_WARN("Input data for inflate is empty.");
-        return {};
+    if (m_inflateStream)
+    {
+        NS_LOG_LOGIC("Window size or format changed, re-creating the inflate context");
+        inflateEnd(m_inflateStream);
+    }
+    else
+    {
+        m_inflateStream = new z_stream;
     }
 
-    // Initialize zlib stream structure
-    z_stream stream;
-    stream.zalloc = Z_NULL;
-    stream.zfree = Z_NULL;
-    stream.opaque = Z_NULL;
-    stream.avail_in = 0;
-    stream.next_in = Z_NULL;
+    SetAllocator(*m_inflateStream, m_memoryPool);
+    m_inflateStream->avail_in = 0;
+    m_inflateStream->next_in = Z_NULL;
 
-    // Initialize the stream for decompression
-    int result = inflateInit(&stream);
-    if (result != Z_OK) {
-        NS_LOG_ERROR("inflateInit failed with error code: " << result);
-        return {};
+    int result = inflateInit2(m_inflateStream, windowBits);
+    if (result != Z_OK)
+    {
+        NS_LOG_ERROR("inflateInit2 failed with error code: " << result);
+        delete m_inflateStream;
+        m_inflateStream = nullptr;
+        return false;
     }
 
-    // Set up input data
-    stream.avail_in = compressedData.size();
-    stream.next_in = const_cast<Bytef*>(compressedData.data());
+    m_inflateWindowBits = windowBits;
+    return true;
+}
 
-    // Output buffer - we'll grow this as needed
-    std::vector<uint8_t> decompressedData;
-    const size_t CHUNK = 16384; // 16KB chunks
-    std::vector<uint8_t> outBuffer(CHUNK);
+int ZlibInteg::ResetDeflateStream(z_stream_s* stream) const
+{
+    deflateReset(stream);
 
-    do {
-        stream.avail_out = CHUNK;
-        stream.next_out = outBuffer.data();
+    const std::vector<uint8_t>* dictionary;
+    int result = GetSelectedDictionary(dictionary);
+    if (result != Z_OK || !dictionary)
+    {
+        return result;
+    }
+    return deflateSetDictionary(stream, dictionary->data(), static_cast<uInt>(dictionary->size()));
+}
 
-        result = inflate(&stream, Z_NO_FLUSH);
-        
-        if (result == Z_STREAM_ERROR || result == Z_NEED_DICT || 
-            result == Z_DATA_ERROR || result == Z_MEM_ERROR) {
-            NS_LOG_ERROR("inflate failed with error code: " << result);
-            inflateEnd(&stream);
-            return {};
-        }
+int ZlibInteg::GetSelectedDictionary(const std::vector<uint8_t>*& dictionary) const
+{
+    dictionary = nullptr;
+    if (m_dictionaryId == 0)
+    {
+        return Z_OK;
+    }
 
-        size_t have = CHUNK - stream.avail_out;
-        decompressedData.insert(decompressedData.end(), outBuffer.begin(), outBuffer.begin() + have);
-        
-    } while (stream.avail_out == 0);
+    auto it = m_dictionaries.find(m_dictionaryId);
+    if (it == m_dictionaries.end())
+    {
+        NS_LOG_ERROR("Dictionary " << m_dictionaryId << " is not registered");
+        return Z_STREAM_ERROR;
+    }
+    if (m_format != FORMAT_ZLIB)
+    {
+        NS_LOG_ERROR("Preset dictionaries need the zlib format");
+        return Z_STREAM_ERROR;
+    }
+    dictionary = &it->second;
+    return Z_OK;
+}
 
-    // Clean up
-    inflateEnd(&stream);
+bool ZlibInteg::UseParallelDeflate(size_t inputSize) const
+{
+    return m_threads > 1 && inputSize > m_blockSize;
+}
 
-    if (result != Z_STREAM_END) {
-        NS_LOG_ERROR("inflate did not complete successfully, error code: " << result);
-        return {};
+size_t ZlibInteg::GetDeflateBound(size_t inputSize)
+{
+    if (Ptr<CompressionBackend> backend = GetBackend())
+    {
+        return (m_sizePrefix ? VarintSize(inputSize) : 0) + backend->GetCompressBound(inputSize);
+    }
+    if (!EnsureDeflateStream())
+    {
+        return 0;
+    }
+    if (UseParallelDeflate(inputSize))
+    {
+        // Every block may expand like a whole stream, plus its flush marker;
+        // the stream header (with dictionary ID) and trailer come once
+        size_t blocks = (inputSize + m_blockSize - 1) / m_blockSize;
+        return (m_sizePrefix ? VarintSize(inputSize) : 0) + GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE +
+               blocks * (deflateBound(m_deflateStream, m_blockSize) + SYNC_FLUSH_OVERHEAD);
     }
+    return DeflateBoundOn(m_deflateStream, inputSize);
+}
 
-    return decompressedData;
+size_t ZlibInteg::DeflateBoundOn(z_stream_s* stream, size_t inputSize) const
+{
+    // deflateBound() counts the zlib or gzip wrapper only on a freshly reset
+    // stream, and never a dictionary ID, so the largest framing is added on top
+    size_t framing = m_format == FORMAT_ZLIB ? ZLIB_HEADER_MAX_SIZE + ZLIB_TRAILER_SIZE
+                     : m_format == FORMAT_GZIP ? GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE
+                                               : 0;
+    return (m_sizePrefix ? VarintSize(inputSize) : 0) + framing + deflateBound(stream, inputSize);
 }
 
-} // namespace ns3
+bool ZlibInteg::IsIncompressible(const uint8_t* data, size_t size) const
+{
+    return m_skipEntropy < 8 && EstimateEntropy(data, size) > m_skipEntropy;
+}
+
+int64_t ZlibInteg::GetInflatedSize(const uint8_t* input, size_t inputSize) const
+{
+    uint64_t originalSize = 0;
+    size_t prefixSize = ReadVarint(input, inputSize, originalSize);
+    if (!m_sizePrefix || prefixSize == 0 || originalSize == 0 ||
+        (IsZlibCodec() && originalSize / MAX_DEFLATE_RATIO > inputSize - prefixSize))
+    {
+        return Z_DATA_ERROR;
+    }
+    if (m_maxInflateSize > 0 && originalSize > m_maxInflateSize)
+    {
+        return Z_BUF_ERROR;
+    }
+    return static_cast<int64_t>(originalSize);
+}
+
+// --- Implementation of Deflate (Compression) on the persistent deflate context ---
+int64_t ZlibInteg::Deflate(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity);
+    OperationScope scope(this, true, inputSize);
+
+    if (input == nullptr || inputSize == 0)
+    {
+        NS_LOG_WARN("Input data for deflate is empty.");
+        return scope.Finish(Z_STREAM_ERROR);
+    }
+    if (m_cacheSize == 0)
+    {
+        return scope.Finish(DeflateUncached(input, inputSize, output, outputCapacity));
+    }
+
+    uint64_t hash;
+    const std::vector<uint8_t>* cached = LookupCache(input, inputSize, false, hash);
+    if (cached)
+    {
+        if (cached->size() > outputCapacity)
+        {
+            return scope.Finish(Z_BUF_ERROR);
+        }
+        std::memcpy(output, cached->data(), cached->size());
+        return scope.Finish(cached->size());
+    }
 
+    int64_t produced = DeflateUncached(input, inputSize, output, outputCapacity);
+    if (produced > 0)
+    {
+        InsertCache(hash, input, inputSize, output, produced, false);
+    }
+    return scope.Finish(produced);
+}
+
+int64_t ZlibInteg::DeflateUncached(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity)
+{
+    Ptr<CompressionBackend> backend = GetBackend();
+    if (!backend && !EnsureDeflateStream())
+    {
+        return Z_MEM_ERROR;
+    }
+
+    size_t prefixSize = 0;
+    if (m_sizePrefix)
+    {
+        prefixSize = VarintSize(inputSize);
+        if (outputCapacity < prefixSize)
+        {
+            return Z_BUF_ERROR;
+        }
+        WriteVarint(inputSize, output);
+    }
+
+    if (backend)
+    {
+        m_compressedCount++;
+        int64_t produced = backend->Compress(input, inputSize, output + prefixSize, outputCapacity - prefixSize, m_level);
+        return produced < 0 ? produced : static_cast<int64_t>(prefixSize) + produced;
+    }
+
+    bool store = IsIncompressible(input, inputSize);
+    if (store)
+    {
+        NS_LOG_LOGIC("Input looks incompressible, storing it");
+        m_skippedCount++;
+    }
+    else
+    {
+        m_compressedCount++;
+    }
+
+    int64_t produced;
+    if (!store && UseParallelDeflate(inputSize))
+    {
+        produced = DeflateParallel(input, inputSize, output + prefixSize, outputCapacity - prefixSize);
+    }
+    else
+    {
+        produced = DeflateInto(m_deflateStream, input, inputSize, output + prefixSize,
+                               outputCapacity - prefixSize, store);
+        if (produced < 0)
+        {
+            NS_LOG_ERROR("deflate failed with error code: " << produced);
+        }
+    }
+    return produced < 0 ? produced : static_cast<int64_t>(prefixSize) + produced;
+}
+
+int64_t ZlibInteg::DeflateInto(z_stream_s* stream,
+                               const uint8_t* input,
+                               size_t inputSize,
+                               uint8_t* output,
+                               size_t outputCapacity,
+                               bool store) const
+{
+    if (store)
+    {
+        return StoreInto(input, inputSize, output, outputCapacity);
+    }
+
+    int result = ResetDeflateStream(stream);
+    if (result != Z_OK)
+    {
+        return result;
+    }
+
+    stream->next_in = const_cast<Bytef*>(input);
+    stream->next_out = output;
+
+    // avail_in/avail_out are 32-bit, so very large buffers are fed in slices
+    size_t remainingIn = inputSize;
+    size_t remainingOut = outputCapacity;
+    do
+    {
+        stream->avail_in = static_cast<uInt>(std::min<size_t>(remainingIn, UINT_MAX));
+        stream->avail_out = static_cast<uInt>(std::min<size_t>(remainingOut, UINT_MAX));
+        uInt availIn = stream->avail_in;
+        uInt availOut = stream->avail_out;
+
+        result = deflate(stream, remainingIn == availIn ? Z_FINISH : Z_NO_FLUSH);
+
+        remainingIn -= availIn - stream->avail_in;
+        remainingOut -= availOut - stream->avail_out;
+    } while (result == Z_OK);
+
+    if (result != Z_STREAM_END)
+    {
+        return result;
+    }
+
+    return static_cast<int64_t>(outputCapacity - remainingOut);
+}
+
+int64_t ZlibInteg::StoreInto(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity) const
+{
+    size_t blocks = (inputSize + MAX_STORED_BLOCK - 1) / MAX_STORED_BLOCK;
+    size_t framing = (m_format == FORMAT_GZIP ? GZIP_HEADER_SIZE : m_format == FORMAT_ZLIB ? 2 : 0) +
+                     GetTrailerSize(m_format);
+    if (outputCapacity < framing + blocks * 5 + inputSize)
+    {
+        return Z_BUF_ERROR;
+    }
+
+    // The stream declares no dictionary, so any inflater can read it
+    size_t produced = WriteStreamHeader(output, m_format, m_windowBits, 0, 0);
+    uLong checksum = UpdateChecksum(m_format, 0L, Z_NULL, 0);
+    for (size_t offset = 0; offset < inputSize; offset += MAX_STORED_BLOCK)
+    {
+        size_t length = std::min(MAX_STORED_BLOCK, inputSize - offset);
+        output[produced++] = offset + length == inputSize ? 0x01 : 0x00; // BFINAL, BTYPE 00
+        output[produced++] = static_cast<uint8_t>(length);
+        output[produced++] = static_cast<uint8_t>(length >> 8);
+        output[produced++] = static_cast<uint8_t>(~length);
+        output[produced++] = static_cast<uint8_t>(~length >> 8);
+        std::memcpy(output + produced, input + offset, length);
+        produced += length;
+        checksum = UpdateChecksum(m_format, checksum, input + offset, length);
+    }
+    produced += WriteStreamTrailer(output + produced, m_format, checksum, inputSize);
+    return static_cast<int64_t>(produced);
+}
+
+double ZlibInteg::EstimateEntropy(const uint8_t* data, size_t size)
+{
+    uint32_t counts[256] = {};
+    size_t sampled = 0;
+    if (size <= ENTROPY_SAMPLE_SIZE)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            counts[data[i]]++;
+        }
+        sampled = size;
+    }
+    else
+    {
+        // Evenly spread chunks, so a compressible header or trailer cannot
+        // hide an incompressible body (or the other way round)
+        size_t chunks = ENTROPY_SAMPLE_SIZE / ENTROPY_CHUNK_SIZE;
+        size_t stride = GetEntropyChunkStride(size);
+        for (size_t c = 0; c < chunks; c++)
+        {
+            const uint8_t* chunk = data + c * stride;
+            for (size_t i = 0; i < ENTROPY_CHUNK_SIZE; i++)
+            {
+                counts[chunk[i]]++;
+            }
+        }
+        sampled = chunks * ENTROPY_CHUNK_SIZE;
+    }
+    if (sampled == 0)
+    {
+        return 0.0;
+    }
+
+    double entropy = 0.0;
+    size_t distinct = 0;
+    for (uint32_t count : counts)
+    {
+        if (count > 0)
+        {
+            double p = double(count) / sampled;
+            entropy -= p * std::log2(p);
+            distinct++;
+        }
+    }
+    // Miller-Madow correction: a small sample under-represents rare symbols
+    entropy += (distinct - 1) / (2.0 * sampled * std::log(2.0));
+    return std::min(entropy, 8.0);
+}
+
+uint64_t ZlibInteg::GetCompressedCount() const
+{
+    return m_compressedCount;
+}
+
+uint64_t ZlibInteg::GetSkippedCount() const
+{
+    return m_skippedCount;
+}
+
+uint64_t ZlibInteg::GetCacheHits() const
+{
+    return m_cacheHits;
+}
+
+uint64_t ZlibInteg::GetCacheMisses() const
+{
+    return m_cacheMisses;
+}
+
+void ZlibInteg::ClearCache()
+{
+    NS_LOG_FUNCTION(this);
+    m_cache.clear();
+    m_cacheIndex.clear();
+    m_cacheBytes = 0;
+}
+
+void ZlibInteg::ResetStatistics()
+{
+    NS_LOG_FUNCTION(this);
+    m_compressedCount = 0;
+    m_skippedCount = 0;
+    m_cacheHits = 0;
+    m_cacheMisses = 0;
+    m_deflateCalls = 0;
+    m_deflateFailures = 0;
+    m_deflateBytesIn = 0;
+    m_deflateBytesOut = 0;
+    m_deflateTime = Time(0);
+    m_inflateCalls = 0;
+    m_inflateFailures = 0;
+    m_inflateBytesIn = 0;
+    m_inflateBytesOut = 0;
+    m_inflateTime = Time(0);
+}
+
+ZlibInteg::OperationScope::OperationScope(ZlibInteg* owner, bool deflating, uint64_t inputSize)
+    : m_owner(owner),
+      m_deflating(deflating),
+      m_outermost(owner->m_operationDepth++ == 0),
+      m_inputSize(inputSize),
+      m_result(Z_ERRNO),
+      m_start(std::chrono::steady_clock::now())
+{
+}
+
+ZlibInteg::OperationScope::~OperationScope()
+{
+    m_owner->m_operationDepth--;
+    if (!m_outermost)
+    {
+        return;
+    }
+
+    Time elapsed = NanoSeconds(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - m_start)
+                                   .count());
+    ZlibInteg* o = m_owner;
+    if (m_deflating)
+    {
+        o->m_deflateCalls++;
+        o->m_deflateTime += elapsed;
+        if (m_result < 0)
+        {
+            o->m_deflateFailures++;
+            o->m_deflateFailureTrace(static_cast<int>(m_result));
+            return;
+        }
+        o->m_deflateBytesIn += m_inputSize;
+        o->m_deflateBytesOut += m_result;
+        o->m_deflateTrace(m_inputSize, m_result, elapsed);
+    }
+    else
+    {
+        o->m_inflateCalls++;
+        o->m_inflateTime += elapsed;
+        if (m_result < 0)
+        {
+            o->m_inflateFailures++;
+            o->m_inflateFailureTrace(static_cast<int>(m_result));
+            return;
+        }
+        o->m_inflateBytesIn += m_inputSize;
+        o->m_inflateBytesOut += m_result;
+        o->m_inflateTrace(m_inputSize, m_result, elapsed);
+    }
+}
+
+int64_t ZlibInteg::OperationScope::Finish(int64_t result)
+{
+    m_result = result;
+    return result;
+}
+
+void ZlibInteg::OperationScope::Succeed(uint64_t outputSize)
+{
+    m_result = static_cast<int64_t>(outputSize);
+}
+
+void ZlibInteg::OperationScope::Fail(int error)
+{
+    m_result = error;
+}
+
+ZlibInteg::CacheSettings ZlibInteg::GetCacheSettings() const
+{
+    return CacheSettings(m_level, m_strategy, m_windowBits, m_memLevel, m_format, m_codec,
+                         PeekPointer(m_customBackend), m_dictionaryId, m_sizePrefix, m_skipEntropy,
+                         m_threads, m_blockSize);
+}
+
+const std::vector<uint8_t>* ZlibInteg::LookupCache(const uint8_t* input, size_t inputSize, bool packet, uint64_t& hash)
+{
+    CacheSettings settings = GetCacheSettings();
+    if (settings != m_cacheSettings)
+    {
+        ClearCache();
+        m_cacheSettings = settings;
+    }
+
+    hash = Hash64(reinterpret_cast<const char*>(input), inputSize);
+    auto range = m_cacheIndex.equal_range(hash);
+    for (auto i = range.first; i != range.second; ++i)
+    {
+        std::list<CacheEntry>::iterator entry = i->second;
+        if (entry->packet == packet && entry->input.size() == inputSize &&
+            std::memcmp(entry->input.data(), input, inputSize) == 0)
+        {
+            m_cacheHits++;
+            m_cache.splice(m_cache.begin(), m_cache, entry);
+            return &entry->output;
+        }
+    }
+    m_cacheMisses++;
+    return nullptr;
+}
+
+void ZlibInteg::InsertCache(uint64_t hash,
+                            const uint8_t* input,
+                            size_t inputSize,
+                            const uint8_t* output,
+                            size_t outputSize,
+                            bool packet)
+{
+    uint64_t cost = inputSize + outputSize + CACHE_ENTRY_OVERHEAD;
+    if (cost > m_cacheSize)
+    {
+        return;
+    }
+
+    while (m_cacheBytes + cost > m_cacheSize)
+    {
+        const CacheEntry& oldest = m_cache.back();
+        auto range = m_cacheIndex.equal_range(oldest.hash);
+        for (auto i = range.first; i != range.second; ++i)
+        {
+            if (&*i->second == &oldest)
+            {
+                m_cacheIndex.erase(i);
+                break;
+            }
+        }
+        m_cacheBytes -= oldest.input.size() + oldest.output.size() + CACHE_ENTRY_OVERHEAD;
+        m_cache.pop_back();
+    }
+
+    m_cache.push_front({hash, packet, std::vector<uint8_t>(input, input + inputSize),
+                        std::vector<uint8_t>(output, output + outputSize)});
+    m_cacheIndex.emplace(hash, m_cache.begin());
+    m_cacheBytes += cost;
+}
+
+int64_t ZlibInteg::DeflateParallel(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity);
+
+    const std::vector<uint8_t>* dictionary;
+    if (GetSelectedDictionary(dictionary) != Z_OK)
+    {
+        return Z_STREAM_ERROR;
+    }
+
+    if (outputCapacity < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE)
+    {
+        return Z_BUF_ERROR;
+    }
+    size_t headerSize = WriteStreamHeader(output, m_format, m_windowBits, m_level, dictionary ? m_dictionaryId : 0);
+
+    // Each block is primed with the window of input before it (or the preset
+    // dictionary for the first block), so it compresses almost as well as in
+    // a serial stream while depending on nothing but the input
+    const size_t window = size_t(1) << m_windowBits;
+    const size_t blocks = (inputSize + m_blockSize - 1) / m_blockSize;
+    std::vector<std::vector<uint8_t>> compressed(blocks);
+    std::vector<uLong> checksums(blocks);
+    std::vector<int> results(blocks, Z_OK);
+    std::atomic<size_t> nextBlock(0);
+
+    auto worker = [&]() {
+        z_stream stream;
+        SetAllocator(stream, m_memoryPool);
+        int result = deflateInit2(&stream, m_level, Z_DEFLATED, -m_windowBits, m_memLevel,
+                                  static_cast<int>(m_strategy));
+        for (size_t block = nextBlock++; block < blocks; block = nextBlock++)
+        {
+            if (result != Z_OK)
+            {
+                results[block] = result;
+                continue;
+            }
+            deflateReset(&stream);
+
+            size_t offset = block * m_blockSize;
+            size_t length = std::min<size_t>(m_blockSize, inputSize - offset);
+            bool last = block + 1 == blocks;
+            if (offset > 0)
+            {
+                size_t primed = std::min(window, offset);
+                deflateSetDictionary(&stream, input + offset - primed, static_cast<uInt>(primed));
+            }
+            else if (dictionary)
+            {
+                deflateSetDictionary(&stream, dictionary->data(), static_cast<uInt>(dictionary->size()));
+            }
+
+            std::vector<uint8_t>& out = compressed[block];
+            out.resize(deflateBound(&stream, length) + SYNC_FLUSH_OVERHEAD);
+            stream.next_in = const_cast<Bytef*>(input + offset);
+            stream.avail_in = static_cast<uInt>(length);
+            stream.next_out = out.data();
+            stream.avail_out = static_cast<uInt>(out.size());
+
+            // Non-final blocks end byte-aligned on an empty stored block, so
+            // the next block's bits can simply be appended
+            int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+            if (status == (last ? Z_STREAM_END : Z_OK) && stream.avail_in == 0 && stream.avail_out > 0)
+            {
+                out.resize(out.size() - stream.avail_out);
+                checksums[block] = UpdateChecksum(m_format, UpdateChecksum(m_format, 0L, Z_NULL, 0),
+                                                  input + offset, length);
+            }
+            else
+            {
+                results[block] = status == Z_OK || status == Z_STREAM_END ? Z_BUF_ERROR : status;
+            }
+        }
+        if (result == Z_OK)
+        {
+            deflateEnd(&stream);
+        }
+    };
+
+    size_t threads = std::min<size_t>(m_threads, blocks);
+    RunWorkers(threads, worker);
+
+    // Stitch the blocks together and combine their checksums
+    size_t produced = headerSize;
+    uLong checksum = UpdateChecksum(m_format, 0L, Z_NULL, 0);
+    for (size_t block = 0; block < blocks; block++)
+    {
+        if (results[block] != Z_OK)
+        {
+            NS_LOG_ERROR("deflate of block " << block << " failed with error code: " << results[block]);
+            return results[block];
+        }
+        const std::vector<uint8_t>& out = compressed[block];
+        if (produced + out.size() + GetTrailerSize(m_format) > outputCapacity)
+        {
+            return Z_BUF_ERROR;
+        }
+        std::copy(out.begin(), out.end(), output + produced);
+        produced += out.size();
+
+        size_t length = std::min<size_t>(m_blockSize, inputSize - block * m_blockSize);
+        checksum = m_format == FORMAT_GZIP
+                       ? crc32_combine(checksum, checksums[block], static_cast<z_off_t>(length))
+                       : adler32_combine(checksum, checksums[block], static_cast<z_off_t>(length));
+    }
+
+    produced += WriteStreamTrailer(output + produced, m_format, checksum, inputSize);
+
+    NS_LOG_LOGIC("Deflated " << inputSize << " bytes in " << blocks << " blocks on " << threads
+                             << " threads -> " << produced << " bytes");
+    return static_cast<int64_t>(produced);
+}
+
+std::vector<uint8_t> ZlibInteg::DeflateSeekable(const std::vector<uint8_t>& inputData)
+{
+    NS_LOG_FUNCTION(this << inputData.size());
+    OperationScope scope(this, true, inputData.size());
+
+    if (inputData.empty())
+    {
+        NS_LOG_WARN("Input data for deflate is empty.");
+        scope.Fail(Z_STREAM_ERROR);
+        return {};
+    }
+
+    const std::vector<uint8_t>* dictionary;
+    int status = GetSelectedDictionary(dictionary);
+    if (status != Z_OK)
+    {
+        scope.Fail(status);
+        return {};
+    }
+
+    const size_t blocks = (inputData.size() + m_blockSize - 1) / m_blockSize;
+    std::vector<std::vector<uint8_t>> compressed(blocks);
+    std::vector<int> results(blocks, Z_OK);
+    std::atomic<size_t> nextBlock(0);
+
+    auto worker = [&]() {
+        z_stream stream;
+        SetAllocator(stream, m_memoryPool);
+        int result = deflateInit2(&stream, m_level, Z_DEFLATED, GetStreamWindowBits(), m_memLevel,
+                                  static_cast<int>(m_strategy));
+        for (size_t block = nextBlock++; block < blocks; block = nextBlock++)
+        {
+            if (result != Z_OK)
+            {
+                results[block] = result;
+                continue;
+            }
+            deflateReset(&stream);
+            if (dictionary)
+            {
+                deflateSetDictionary(&stream, dictionary->data(), static_cast<uInt>(dictionary->size()));
+            }
+
+            size_t offset = block * m_blockSize;
+            size_t length = std::min<size_t>(m_blockSize, inputData.size() - offset);
+            std::vector<uint8_t>& out = compressed[block];
+            out.resize(deflateBound(&stream, length));
+            stream.next_in = const_cast<Bytef*>(inputData.data() + offset);
+            stream.avail_in = static_cast<uInt>(length);
+            stream.next_out = out.data();
+            stream.avail_out = static_cast<uInt>(out.size());
+
+            int status = deflate(&stream, Z_FINISH);
+            if (status == Z_STREAM_END)
+            {
+                out.resize(out.size() - stream.avail_out);
+            }
+            else
+            {
+                results[block] = status == Z_OK ? Z_BUF_ERROR : status;
+            }
+        }
+        if (result == Z_OK)
+        {
+            deflateEnd(&stream);
+        }
+    };
+    RunWorkers(std::min<size_t>(m_threads, blocks), worker);
+
+    size_t containerSize = blocks * SEEKABLE_ENTRY_SIZE + SEEKABLE_FOOTER_SIZE;
+    for (size_t block = 0; block < blocks; block++)
+    {
+        if (results[block] != Z_OK)
+        {
+            NS_LOG_ERROR("deflate of block " << block << " failed with error code: " << results[block]);
+            scope.Fail(results[block]);
+            return {};
+        }
+        containerSize += compressed[block].size();
+    }
+
+    std::vector<uint8_t> container(containerSize);
+    size_t indexOffset = containerSize - blocks * SEEKABLE_ENTRY_SIZE - SEEKABLE_FOOTER_SIZE;
+    size_t produced = 0;
+    for (size_t block = 0; block < blocks; block++)
+    {
+        uint8_t* entry = container.data() + indexOffset + block * SEEKABLE_ENTRY_SIZE;
+        WriteBigEndian(produced, 8, entry);
+        WriteBigEndian(block * m_blockSize, 8, entry + 8);
+        std::copy(compressed[block].begin(), compressed[block].end(), container.begin() + produced);
+        produced += compressed[block].size();
+    }
+    uint8_t* footer = container.data() + containerSize - SEEKABLE_FOOTER_SIZE;
+    WriteBigEndian(inputData.size(), 8, footer);
+    WriteBigEndian(blocks, 4, footer + 8);
+    WriteBigEndian(SEEKABLE_MAGIC, 4, footer + 12);
+
+    NS_LOG_LOGIC("Seekable container: " << inputData.size() << " bytes in " << blocks << " blocks -> "
+                                        << containerSize << " bytes");
+    scope.Succeed(container.size());
+    return container;
+}
+
+bool ZlibInteg::ReadSeekableIndex(const std::vector<uint8_t>& container,
+                                  std::vector<SeekableBlock>& blocks,
+                                  uint64_t& totalSize)
+{
+    if (container.size() < SEEKABLE_FOOTER_SIZE)
+    {
+        NS_LOG_ERROR("Seekable container too short");
+        return false;
+    }
+    const uint8_t* footer = container.data() + container.size() - SEEKABLE_FOOTER_SIZE;
+    totalSize = ReadBigEndian(footer, 8);
+    uint64_t count = ReadBigEndian(footer + 8, 4);
+    if (ReadBigEndian(footer + 12, 4) != SEEKABLE_MAGIC || count == 0 ||
+        count > (container.size() - SEEKABLE_FOOTER_SIZE) / SEEKABLE_ENTRY_SIZE)
+    {
+        NS_LOG_ERROR("Invalid seekable container footer");
+        return false;
+    }
+
+    uint64_t indexOffset = container.size() - SEEKABLE_FOOTER_SIZE - count * SEEKABLE_ENTRY_SIZE;
+    blocks.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t* entry = container.data() + indexOffset + i * SEEKABLE_ENTRY_SIZE;
+        blocks[i].compressedOffset = ReadBigEndian(entry, 8);
+        blocks[i].uncompressedOffset = ReadBigEndian(entry + 8, 8);
+    }
+
+    // Sizes follow from the next block's offsets; every block must be non-empty,
+    // fit a single zlib call and respect deflate's maximum ratio
+    for (size_t i = 0; i < count; i++)
+    {
+        SeekableBlock& block = blocks[i];
+        uint64_t compressedEnd = i + 1 < count ? blocks[i + 1].compressedOffset : indexOffset;
+        uint64_t uncompressedEnd = i + 1 < count ? blocks[i + 1].uncompressedOffset : totalSize;
+        if ((i == 0 && (block.compressedOffset != 0 || block.uncompressedOffset != 0)) ||
+            compressedEnd <= block.compressedOffset || uncompressedEnd <= block.uncompressedOffset)
+        {
+            NS_LOG_ERROR("Invalid seekable container index entry " << i);
+            return false;
+        }
+        block.compressedSize = compressedEnd - block.compressedOffset;
+        block.uncompressedSize = uncompressedEnd - block.uncompressedOffset;
+        if (block.uncompressedSize > UINT_MAX || block.compressedSize > UINT_MAX ||
+            block.uncompressedSize / MAX_DEFLATE_RATIO > block.compressedSize)
+        {
+            NS_LOG_ERROR("Invalid seekable container index entry " << i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t ZlibInteg::GetSeekableSize(const std::vector<uint8_t>& container)
+{
+    std::vector<SeekableBlock> blocks;
+    uint64_t totalSize;
+    if (!ReadSeekableIndex(container, blocks, totalSize))
+    {
+        return Z_DATA_ERROR;
+    }
+    return static_cast<int64_t>(totalSize);
+}
+
+std::vector<uint8_t> ZlibInteg::InflateRange(const std::vector<uint8_t>& container,
+                                             uint64_t offset,
+                                             uint64_t length)
+{
+    NS_LOG_FUNCTION(this << container.size() << offset << length);
+    OperationScope scope(this, false, container.size());
+
+    std::vector<SeekableBlock> blocks;
+    uint64_t totalSize;
+    if (!ReadSeekableIndex(container, blocks, totalSize))
+    {
+        scope.Fail(Z_DATA_ERROR);
+        return {};
+    }
+    if (offset >= totalSize || length == 0)
+    {
+        NS_LOG_WARN("Range starts past the end of the container or is empty.");
+        scope.Fail(Z_STREAM_ERROR);
+        return {};
+    }
+    length = std::min(length, totalSize - offset);
+    uint64_t end = offset + length;
+
+    // Blocks whose content overlaps [offset, end)
+    auto byStart = [](uint64_t value, const SeekableBlock& block) {
+        return value < block.uncompressedOffset;
+    };
+    size_t first = std::upper_bound(blocks.begin(), blocks.end(), offset, byStart) - blocks.begin() - 1;
+    size_t last = std::upper_bound(blocks.begin(), blocks.end(), end - 1, byStart) - blocks.begin() - 1;
+
+    std::vector<uint8_t> rangeData(length);
+    std::vector<int> results(last - first + 1, Z_OK);
+    std::atomic<size_t> nextBlock(first);
+
+    auto worker = [&]() {
+        z_stream stream;
+        SetAllocator(stream, m_memoryPool);
+        stream.avail_in = 0;
+        stream.next_in = Z_NULL;
+        int result = inflateInit2(&stream, GetStreamWindowBits());
+        std::vector<uint8_t> partial;
+        for (size_t i = nextBlock++; i <= last; i = nextBlock++)
+        {
+            if (result != Z_OK)
+            {
+                results[i - first] = result;
+                continue;
+            }
+            inflateReset(&stream);
+
+            // Blocks entirely inside the range inflate in place; the ones at
+            // the edges go through a buffer and are trimmed
+            const SeekableBlock& block = blocks[i];
+            uint64_t blockEnd = block.uncompressedOffset + block.uncompressedSize;
+            uint64_t copyStart = std::max(offset, block.uncompressedOffset);
+            uint64_t copyEnd = std::min(end, blockEnd);
+            bool whole = copyStart == block.uncompressedOffset && copyEnd == blockEnd;
+            if (!whole)
+            {
+                partial.resize(block.uncompressedSize);
+            }
+            uint8_t* target = whole ? rangeData.data() + (copyStart - offset) : partial.data();
+
+            stream.next_in = const_cast<Bytef*>(container.data() + block.compressedOffset);
+            stream.avail_in = static_cast<uInt>(block.compressedSize);
+            stream.next_out = target;
+            stream.avail_out = static_cast<uInt>(block.uncompressedSize);
+
+            int status = InflateWithDictionary(&stream, Z_FINISH, m_dictionaries);
+            if (status != Z_STREAM_END || stream.avail_in != 0 || stream.avail_out != 0)
+            {
+                results[i - first] = status == Z_STREAM_END || status == Z_OK ? Z_DATA_ERROR : status;
+            }
+            else if (!whole)
+            {
+                std::copy(partial.begin() + (copyStart - block.uncompressedOffset),
+                          partial.begin() + (copyEnd - block.uncompressedOffset),
+                          rangeData.begin() + (copyStart - offset));
+            }
+        }
+        if (result == Z_OK)
+        {
+            inflateEnd(&stream);
+        }
+    };
+    RunWorkers(std::min<size_t>(m_threads, last - first + 1), worker);
+
+    for (size_t i = first; i <= last; i++)
+    {
+        if (results[i - first] != Z_OK)
+        {
+            NS_LOG_ERROR("inflate of block " << i << " failed with error code: " << results[i - first]);
+            scope.Fail(results[i - first]);
+            return {};
+        }
+    }
+    scope.Succeed(rangeData.size());
+    return rangeData;
+}
+
+std::vector<uint8_t> ZlibInteg::Deflate(const std::vector<uint8_t>& inputData)
+{
+    NS_LOG_FUNCTION(this);
+    OperationScope scope(this, true, inputData.size());
+
+    if (inputData.empty())
+    {
+        NS_LOG_WARN("Input data for deflate is empty.");
+        scope.Fail(Z_STREAM_ERROR);
+        return {};
+    }
+
+    // Compress into the reusable scratch buffer, then copy out exactly the bytes produced
+    size_t bound = GetDeflateBound(inputData.size());
+    if (m_scratch.size() < bound)
+    {
+        m_scratch.resize(bound);
+    }
+
+    int64_t compressedSize = Deflate(inputData.data(), inputData.size(), m_scratch.data(), m_scratch.size());
+    if (scope.Finish(compressedSize) < 0)
+    {
+        return {}; // Return empty vector on failure
+    }
+
+    return std::vector<uint8_t>(m_scratch.begin(), m_scratch.begin() + compressedSize);
+}
+
+
+// --- Implementation of Inflate (Decompression) on the persistent inflate context ---
+int64_t ZlibInteg::Inflate(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity)
+{
+    NS_LOG_FUNCTION(this << inputSize << outputCapacity);
+    OperationScope scope(this, false, inputSize);
+
+    if (input == nullptr || inputSize == 0)
+    {
+        NS_LOG_WARN("Input data for inflate is empty.");
+        return scope.Finish(Z_STREAM_ERROR);
+    }
+
+    Ptr<CompressionBackend> backend = GetBackend();
+    if (!backend && !EnsureInflateStream())
+    {
+        return scope.Finish(Z_MEM_ERROR);
+    }
+
+    if (!m_sizePrefix)
+    {
+        int64_t produced = backend ? backend->Decompress(input, inputSize, output, outputCapacity)
+                                   : InflateInto(m_inflateStream, input, inputSize, output, outputCapacity);
+        if (produced < 0 && !backend)
+        {
+            NS_LOG_ERROR("inflate did not complete successfully, error code: " << produced);
+        }
+        return scope.Finish(produced);
+    }
+
+    int64_t originalSize = GetInflatedSize(input, inputSize);
+    if (originalSize < 0)
+    {
+        NS_LOG_ERROR((originalSize == Z_BUF_ERROR ? "Size prefix declares more than MaxInflateSize"
+                                                  : "Invalid size prefix on compressed data"));
+        return scope.Finish(originalSize);
+    }
+    if (static_cast<uint64_t>(originalSize) > outputCapacity)
+    {
+        return scope.Finish(Z_BUF_ERROR);
+    }
+
+    size_t prefixSize = VarintSize(originalSize);
+    int64_t produced = backend ? backend->Decompress(input + prefixSize, inputSize - prefixSize, output, originalSize)
+                               : InflateInto(m_inflateStream, input + prefixSize, inputSize - prefixSize, output,
+                                             originalSize);
+    if (produced < 0 && !backend)
+    {
+        NS_LOG_ERROR("inflate did not complete successfully, error code: " << produced);
+    }
+    if (produced >= 0 && produced != originalSize)
+    {
+        NS_LOG_ERROR("inflate produced " << produced << " bytes, size prefix declared " << originalSize);
+        return scope.Finish(Z_DATA_ERROR);
+    }
+    return scope.Finish(produced);
+}
+
+std::vector<uint8_t> ZlibInteg::Inflate(const std::vector<uint8_t>& compressedData)
+{
+    NS_LOG_FUNCTION(this);
+    OperationScope scope(this, false, compressedData.size());
+
+    if (compressedData.empty()) {
+        NS_LOG_WARN("Input data for inflate is empty.");
+        scope.Fail(Z_STREAM_ERROR);
+        return {};
+    }
+
+    Ptr<CompressionBackend> backend = GetBackend();
+    if (!backend && !EnsureInflateStream())
+    {
+        scope.Fail(Z_MEM_ERROR);
+        return {};
+    }
+
+    if (m_sizePrefix || backend)
+    {
+        // Backends are asked for the size their own format records, if any
+        int64_t originalSize = m_sizePrefix
+                                   ? GetInflatedSize(compressedData.data(), compressedData.size())
+                                   : backend->GetDecompressedSize(compressedData.data(), compressedData.size());
+        if (originalSize < 0)
+        {
+            NS_LOG_ERROR((!m_sizePrefix ? "Codec records no decompressed size, SizePrefix is needed"
+                          : originalSize == Z_BUF_ERROR ? "Size prefix declares more than MaxInflateSize"
+                                                        : "Invalid size prefix on compressed data"));
+            scope.Fail(static_cast<int>(originalSize));
+            return {};
+        }
+        if (m_maxInflateSize > 0 && static_cast<uint64_t>(originalSize) > m_maxInflateSize)
+        {
+            NS_LOG_WARN("Decompressed data exceeds MaxInflateSize");
+            scope.Fail(Z_BUF_ERROR);
+            return {};
+        }
+
+        std::vector<uint8_t> decompressedData(originalSize);
+        int64_t produced = Inflate(compressedData.data(), compressedData.size(), decompressedData.data(),
+                                   decompressedData.size());
+        if (produced != originalSize)
+        {
+            scope.Fail(produced < 0 ? static_cast<int>(produced) : Z_DATA_ERROR);
+            return {};
+        }
+        scope.Succeed(decompressedData.size());
+        return decompressedData;
+    }
+
+    z_stream& stream = *m_inflateStream;
+    inflateReset(&stream);
+
+    // Set up input data
+    stream.avail_in = compressedData.size();
+    stream.next_in = const_cast<Bytef*>(compressedData.data());
+
+    // Output buffer - we'll grow this as needed
+    std::vector<uint8_t> decompressedData;
+    const size_t CHUNK = 16384; // 16KB chunks
+    std::vector<uint8_t> outBuffer(CHUNK);
+    int result;
+
+    do {
+        stream.avail_out = CHUNK;
+        stream.next_out = outBuffer.data();
+
+        result = InflateWithDictionary(&stream, Z_NO_FLUSH, m_dictionaries);
+
+        if (result == Z_STREAM_ERROR || result == Z_NEED_DICT ||
+            result == Z_DATA_ERROR || result == Z_MEM_ERROR) {
+            NS_LOG_ERROR("inflate failed with error code: " << result);
+            scope.Fail(result);
+            return {};
+        }
+
+        size_t have = CHUNK - stream.avail_out;
+        decompressedData.insert(decompressedData.end(), outBuffer.begin(), outBuffer.begin() + have);
+        if (m_maxInflateSize > 0 && decompressedData.size() > m_maxInflateSize)
+        {
+            NS_LOG_WARN("Decompressed data exceeds MaxInflateSize");
+            scope.Fail(Z_BUF_ERROR);
+            return {};
+        }
+
+    } while (stream.avail_out == 0);
+
+    if (result != Z_STREAM_END) {
+        NS_LOG_ERROR("inflate did not complete successfully, error code: " << result);
+        scope.Fail(result == Z_OK || result == Z_BUF_ERROR ? Z_DATA_ERROR : result);
+        return {};
+    }
+
+    scope.Succeed(decompressedData.size());
+    return decompressedData;
+}
+
+int64_t ZlibInteg::InflateStream(const uint8_t* input, size_t inputSize, InflateSink sink)
+{
+    NS_LOG_FUNCTION(this << inputSize);
+    OperationScope scope(this, false, inputSize);
+
+    if (input == nullptr || inputSize == 0)
+    {
+        NS_LOG_WARN("Input data for inflate is empty.");
+        return scope.Finish(Z_STREAM_ERROR);
+    }
+
+    if (!EnsureInflateStream())
+    {
+        return scope.Finish(Z_MEM_ERROR);
+    }
+
+    int64_t declaredSize = -1;
+    if (m_sizePrefix)
+    {
+        declaredSize = GetInflatedSize(input, inputSize);
+        if (declaredSize < 0)
+        {
+            NS_LOG_ERROR((declaredSize == Z_BUF_ERROR ? "Size prefix declares more than MaxInflateSize"
+                                                      : "Invalid size prefix on compressed data"));
+            return scope.Finish(declaredSize);
+        }
+        size_t prefixSize = VarintSize(declaredSize);
+        input += prefixSize;
+        inputSize -= prefixSize;
+    }
+
+    z_stream& stream = *m_inflateStream;
+    inflateReset(&stream);
+    stream.next_in = const_cast<Bytef*>(input);
+
+    std::vector<uint8_t>& chunk = m_inflateChunk;
+    chunk.resize(INFLATE_CHUNK_SIZE);
+    size_t remainingIn = inputSize;
+    uint64_t produced = 0;
+    int result;
+    do
+    {
+        stream.avail_in = static_cast<uInt>(std::min<size_t>(remainingIn, UINT_MAX));
+        stream.next_out = chunk.data();
+        stream.avail_out = static_cast<uInt>(chunk.size());
+        uInt availIn = stream.avail_in;
+
+        result = InflateWithDictionary(&stream, Z_NO_FLUSH, m_dictionaries);
+        remainingIn -= availIn - stream.avail_in;
+        if (result == Z_BUF_ERROR)
+        {
+            // The chunk always has room, so inflate ran out of input: a
+            // truncated stream, not the MaxInflateSize limit
+            NS_LOG_ERROR("Compressed data ends before its stream end");
+            return scope.Finish(Z_DATA_ERROR);
+        }
+        if (result != Z_OK && result != Z_STREAM_END)
+        {
+            NS_LOG_ERROR("inflate failed with error code: " << result);
+            return scope.Finish(result);
+        }
+
+        size_t have = chunk.size() - stream.avail_out;
+        produced += have;
+        if (m_maxInflateSize > 0 && produced > m_maxInflateSize)
+        {
+            NS_LOG_WARN("Decompressed data exceeds MaxInflateSize");
+            return scope.Finish(Z_BUF_ERROR);
+        }
+        if (have > 0 && !sink(chunk.data(), static_cast<uint32_t>(have)))
+        {
+            NS_LOG_LOGIC("Sink aborted the decompression after " << produced << " bytes");
+            return scope.Finish(Z_STREAM_ERROR);
+        }
+    } while (result == Z_OK);
+
+    if (remainingIn > 0 || (declaredSize >= 0 && produced != static_cast<uint64_t>(declaredSize)))
+    {
+        NS_LOG_ERROR("Compressed data does not match its stream end or size prefix");
+        return scope.Finish(Z_DATA_ERROR);
+    }
+    return scope.Finish(produced);
+}
+
+int64_t ZlibInteg::InflateStream(const std::vector<uint8_t>& compressedData, InflateSink sink)
+{
+    return InflateStream(compressedData.data(), compressedData.size(), sink);
+}
+
+size_t ZlibInteg::Batch::GetCount() const
+{
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+const uint8_t* ZlibInteg::Batch::GetItem(size_t index) const
+{
+    return data.data() + offsets[index];
+}
+
+size_t ZlibInteg::Batch::GetItemSize(size_t index) const
+{
+    return offsets[index + 1] - offsets[index];
+}
+
+void ZlibInteg::Batch::Add(const uint8_t* item, size_t size)
+{
+    if (offsets.empty())
+    {
+        offsets.push_back(0);
+    }
+    data.insert(data.end(), item, item + size);
+    offsets.push_back(data.size());
+}
+
+void ZlibInteg::Batch::Clear()
+{
+    data.clear();
+    offsets.assign(1, 0);
+}
+
+bool ZlibInteg::DeflateBatch(const Batch& input, Batch& output)
+{
+    NS_LOG_FUNCTION(this << input.GetCount());
+
+    BatchItems items;
+    items.reserve(input.GetCount());
+    for (size_t i = 0; i < input.GetCount(); i++)
+    {
+        items.emplace_back(input.GetItem(i), input.GetItemSize(i));
+    }
+    return TransformBatch(items, output, true);
+}
+
+bool ZlibInteg::DeflateBatch(const std::vector<std::vector<uint8_t>>& inputs, Batch& output)
+{
+    NS_LOG_FUNCTION(this << inputs.size());
+
+    BatchItems items;
+    items.reserve(inputs.size());
+    for (const std::vector<uint8_t>& item : inputs)
+    {
+        items.emplace_back(item.data(), item.size());
+    }
+    return TransformBatch(items, output, true);
+}
+
+bool ZlibInteg::InflateBatch(const Batch& input, Batch& output)
+{
+    NS_LOG_FUNCTION(this << input.GetCount());
+
+    BatchItems items;
+    items.reserve(input.GetCount());
+    for (size_t i = 0; i < input.GetCount(); i++)
+    {
+        items.emplace_back(input.GetItem(i), input.GetItemSize(i));
+    }
+    return TransformBatch(items, output, false);
+}
+
+bool ZlibInteg::InflateBatch(const std::vector<std::vector<uint8_t>>& inputs, Batch& output)
+{
+    NS_LOG_FUNCTION(this << inputs.size());
+
+    BatchItems items;
+    items.reserve(inputs.size());
+    for (const std::vector<uint8_t>& item : inputs)
+    {
+        items.emplace_back(item.data(), item.size());
+    }
+    return TransformBatch(items, output, false);
+}
+
+bool ZlibInteg::TransformBatch(const BatchItems& items, Batch& output, bool deflating)
+{
+    // The batch is accounted as one call, which fails if any item does
+    uint64_t inputBytes = 0;
+    for (const auto& item : items)
+    {
+        inputBytes += item.second;
+    }
+    OperationScope scope(this, deflating, inputBytes);
+
+    output.Clear();
+    if (items.empty())
+    {
+        scope.Succeed(0);
+        return true;
+    }
+
+    // Fail early rather than once per item if the dictionary is unknown
+    const std::vector<uint8_t>* dictionary;
+    int status = deflating ? GetSelectedDictionary(dictionary) : Z_OK;
+    if (status != Z_OK)
+    {
+        scope.Fail(status);
+        return false;
+    }
+
+    // Consecutive items are grouped into tasks of about BlockSize input bytes;
+    // each task fills its own arena, and the arenas are joined in order
+    std::vector<size_t> groupStarts;
+    size_t groupBytes = m_blockSize;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (groupBytes >= m_blockSize)
+        {
+            groupStarts.push_back(i);
+            groupBytes = 0;
+        }
+        groupBytes += items[i].second;
+    }
+    groupStarts.push_back(items.size());
+    size_t groups = groupStarts.size() - 1;
+
+    std::vector<std::vector<uint8_t>> arenas(groups);
+    std::vector<size_t> sizes(items.size(), 0);
+    std::vector<int> errors(items.size(), Z_OK);
+    std::atomic<size_t> nextGroup(0);
+    std::atomic<uint64_t> skipped(0);
+
+    auto worker = [&]() {
+        z_stream stream;
+        SetAllocator(stream, m_memoryPool);
+        stream.avail_in = 0;
+        stream.next_in = Z_NULL;
+        int result = deflating ? deflateInit2(&stream, m_level, Z_DEFLATED, GetStreamWindowBits(),
+                                              m_memLevel, static_cast<int>(m_strategy))
+                               : inflateInit2(&stream, GetStreamWindowBits());
+        for (size_t g = nextGroup++; g < groups; g = nextGroup++)
+        {
+            size_t first = groupStarts[g];
+            size_t last = groupStarts[g + 1];
+            if (result != Z_OK)
+            {
+                std::fill(errors.begin() + first, errors.begin() + last, result);
+                continue;
+            }
+
+            std::vector<uint8_t>& arena = arenas[g];
+            for (size_t i = first; i < last; i++)
+            {
+                const uint8_t* input = items[i].first;
+                size_t inputSize = items[i].second;
+                if (inputSize == 0)
+                {
+                    errors[i] = Z_STREAM_ERROR;
+                    continue;
+                }
+
+                int64_t produced;
+                bool store = false;
+                if (deflating)
+                {
+                    size_t start = arena.size();
+                    arena.resize(start + DeflateBoundOn(&stream, inputSize));
+                    size_t prefixSize = m_sizePrefix ? WriteVarint(inputSize, arena.data() + start) : 0;
+                    store = IsIncompressible(input, inputSize);
+                    produced = DeflateInto(&stream, input, inputSize, arena.data() + start + prefixSize,
+                                           arena.size() - start - prefixSize, store);
+                    produced = produced < 0 ? produced : static_cast<int64_t>(prefixSize) + produced;
+                    arena.resize(start + std::max<int64_t>(produced, 0));
+                }
+                else
+                {
+                    produced = InflateAppend(&stream, input, inputSize, arena);
+                }
+
+                if (produced < 0)
+                {
+                    errors[i] = static_cast<int>(produced);
+                    continue;
+                }
+                sizes[i] = static_cast<size_t>(produced);
+                skipped += store ? 1 : 0;
+            }
+        }
+        if (result == Z_OK)
+        {
+            deflating ? deflateEnd(&stream) : inflateEnd(&stream);
+        }
+    };
+    RunWorkers(std::min<size_t>(m_threads, groups), worker);
+
+    size_t totalSize = 0;
+    for (const std::vector<uint8_t>& arena : arenas)
+    {
+        totalSize += arena.size();
+    }
+    output.data.reserve(totalSize);
+    output.offsets.reserve(items.size() + 1);
+    for (size_t g = 0; g < groups; g++)
+    {
+        output.data.insert(output.data.end(), arenas[g].begin(), arenas[g].end());
+        std::vector<uint8_t>().swap(arenas[g]);
+        for (size_t i = groupStarts[g]; i < groupStarts[g + 1]; i++)
+        {
+            output.offsets.push_back(output.offsets.back() + sizes[i]);
+        }
+    }
+
+    // The call fails with the error of its first failing item
+    uint64_t failed = 0;
+    int firstError = Z_OK;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (errors[i] != Z_OK)
+        {
+            firstError = failed == 0 ? errors[i] : firstError;
+            failed++;
+        }
+    }
+
+    if (deflating)
+    {
+        m_skippedCount += skipped;
+        m_compressedCount += items.size() - failed - skipped;
+    }
+    if (failed > 0)
+    {
+        NS_LOG_WARN(failed << " of " << items.size() << " batch items failed, the first with error code: "
+                           << firstError);
+        scope.Fail(firstError);
+        return false;
+    }
+    scope.Succeed(output.data.size());
+    return true;
+}
+
+int64_t ZlibInteg::InflateAppend(z_stream_s* stream,
+                                 const uint8_t* input,
+                                 size_t inputSize,
+                                 std::vector<uint8_t>& arena) const
+{
+    size_t start = arena.size();
+    if (m_sizePrefix)
+    {
+        int64_t originalSize = GetInflatedSize(input, inputSize);
+        if (originalSize < 0)
+        {
+            return originalSize;
+        }
+        size_t prefixSize = VarintSize(originalSize);
+        arena.resize(start + originalSize);
+        int64_t produced = InflateInto(stream, input + prefixSize, inputSize - prefixSize,
+                                       arena.data() + start, originalSize);
+        if (produced != originalSize)
+        {
+            arena.resize(start);
+            return produced < 0 ? produced : Z_DATA_ERROR;
+        }
+        return produced;
+    }
+
+    // Without a prefix, grow the arena in place until the stream ends
+    inflateReset(stream);
+    stream->next_in = const_cast<Bytef*>(input);
+    size_t remainingIn = inputSize;
+    size_t produced = 0;
+    int result;
+    do
+    {
+        size_t room = std::min<size_t>(std::max(INFLATE_CHUNK_SIZE, produced), UINT_MAX);
+        if (m_maxInflateSize > 0)
+        {
+            // One byte past the limit is enough to tell the item is too large
+            room = std::min<size_t>(room, m_maxInflateSize + 1 - produced);
+        }
+        arena.resize(start + produced + room);
+        stream->next_out = arena.data() + start + produced;
+        stream->avail_out = static_cast<uInt>(room);
+        stream->avail_in = static_cast<uInt>(std::min<size_t>(remainingIn, UINT_MAX));
+        uInt availIn = stream->avail_in;
+
+        result = InflateWithDictionary(stream, Z_NO_FLUSH, m_dictionaries);
+
+        remainingIn -= availIn - stream->avail_in;
+        produced += room - stream->avail_out;
+        if (m_maxInflateSize > 0 && produced > m_maxInflateSize)
+        {
+            arena.resize(start);
+            return Z_BUF_ERROR;
+        }
+    } while (result == Z_OK);
+
+    if (result != Z_STREAM_END || remainingIn != 0)
+    {
+        // A truncated stream ends in Z_BUF_ERROR, trailing garbage after Z_STREAM_END
+        arena.resize(start);
+        return result == Z_STREAM_END || result == Z_BUF_ERROR ? Z_DATA_ERROR : result;
+    }
+    arena.resize(start + produced);
+    return static_cast<int64_t>(produced);
+}
+
+bool ZlibInteg::CompressPacket(Ptr<Packet> packet, double maxRatio)
+{
+    NS_LOG_FUNCTION(this << packet << maxRatio);
+
+    uint32_t originalSize = packet->GetSize();
+    OperationScope scope(this, true, originalSize);
+    ZlibHeader header;
+
+    bool skip = false;
+    if (originalSize > 0)
+    {
+        // Large payloads are sampled in chunks spread over the whole packet,
+        // as EstimateEntropy() does, not just from their first bytes
+        uint8_t sample[ENTROPY_SAMPLE_SIZE];
+        uint32_t sampled = originalSize;
+        if (originalSize <= ENTROPY_SAMPLE_SIZE)
+        {
+            packet->CopyData(sample, originalSize);
+        }
+        else
+        {
+            EntropySampleBuf sampler(originalSize, sample);
+            std::ostream os(&sampler);
+            packet->CopyData(&os, sampler.GetSampleEnd());
+            sampled = ENTROPY_SAMPLE_SIZE;
+        }
+        skip = IsIncompressible(sample, sampled);
+    }
+
+    int level = m_level;
+    Strategy strategy = m_strategy;
+    size_t candidate = m_candidates.size();
+    Ptr<CompressionBackend> backend = GetBackend();
+    if (skip)
+    {
+        NS_LOG_LOGIC("Payload looks incompressible, sending it as is");
+        m_skippedCount++;
+    }
+    else if (m_adaptive && originalSize > 0 && !backend)
+    {
+        candidate = ChooseCandidate(originalSize);
+        if (candidate < m_candidates.size())
+        {
+            level = m_candidates[candidate].level;
+            strategy = m_candidates[candidate].strategy;
+        }
+        m_levelTrace(level, strategy);
+    }
+
+    // A compressed packet's header also carries the original size
+    header.SetFlags(ZlibHeader::COMPRESSED);
+    size_t extraHeader = header.GetSerializedSize() - 1;
+    header.SetFlags(0);
+
+    bool attempted = false;
+    int result = Z_OK;
+    size_t compressedSize = 0;
+
+    // The cache needs the payload contiguous to hash and compare it
+    bool caching = m_cacheSize > 0 && originalSize > 0 && !skip && !m_adaptive;
+    const std::vector<uint8_t>* cached = nullptr;
+    uint64_t hash = 0;
+    if (caching)
+    {
+        m_backendInput.resize(originalSize);
+        packet->CopyData(m_backendInput.data(), originalSize);
+        cached = LookupCache(m_backendInput.data(), originalSize, true, hash);
+    }
+
+    if (cached)
+    {
+        attempted = true;
+        result = Z_STREAM_END;
+        compressedSize = cached->size();
+        if (m_scratch.size() < compressedSize)
+        {
+            m_scratch.resize(compressedSize);
+        }
+        std::memcpy(m_scratch.data(), cached->data(), compressedSize);
+    }
+    else if (originalSize > 0 && !skip && backend)
+    {
+        attempted = true;
+        // Backends take contiguous input, so the payload is copied out first
+        m_compressedCount++;
+        if (!caching)
+        {
+            m_backendInput.resize(originalSize);
+            packet->CopyData(m_backendInput.data(), originalSize);
+        }
+        size_t bound = backend->GetCompressBound(originalSize);
+        if (m_scratch.size() < bound)
+        {
+            m_scratch.resize(bound);
+        }
+        int64_t produced = backend->Compress(m_backendInput.data(), originalSize, m_scratch.data(), bound, level);
+        result = produced < 0 ? static_cast<int>(produced) : Z_STREAM_END;
+        compressedSize = produced < 0 ? 0 : static_cast<size_t>(produced);
+    }
+    // In adaptive mode level 0 means sending the packet as is, not storing it
+    else if (originalSize > 0 && !skip && !(m_adaptive && level == 0) &&
+             EnsureDeflateStream(level, strategy) && ResetDeflateStream(m_deflateStream) == Z_OK)
+    {
+        attempted = true;
+        m_compressedCount++;
+        z_stream& stream = *m_deflateStream;
+
+        size_t bound = deflateBound(&stream, originalSize);
+        if (m_scratch.size() < bound)
+        {
+            m_scratch.resize(bound);
+        }
+        stream.next_out = m_scratch.data();
+        stream.avail_out = static_cast<uInt>(bound);
+
+        auto start = std::chrono::steady_clock::now();
+        ZStreamBuf sink(&stream, true, 0);
+        std::ostream os(&sink);
+        packet->CopyData(&os, originalSize);
+        result = sink.Finish();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        compressedSize = bound - stream.avail_out;
+
+        if (result == Z_STREAM_END && candidate < m_candidates.size())
+        {
+            // Packets that would grow are sent as is, so they cost their original size
+            LevelCandidate& estimate = m_candidates[candidate];
+            double cpuPerByte = elapsed.count() / originalSize;
+            double ratio = std::min(1.0, double(compressedSize + extraHeader) / originalSize);
+            double alpha = estimate.samples == 0 ? 1.0 : ADAPTIVE_ALPHA;
+            estimate.cpuPerByte += alpha * (cpuPerByte - estimate.cpuPerByte);
+            estimate.ratio += alpha * (ratio - estimate.ratio);
+            estimate.samples++;
+        }
+    }
+
+    if (caching && !cached && result == Z_STREAM_END)
+    {
+        InsertCache(hash, m_backendInput.data(), originalSize, m_scratch.data(), compressedSize, true);
+    }
+
+    if (attempted && result != Z_STREAM_END)
+    {
+        NS_LOG_ERROR("Compression failed with error code: " << result);
+        scope.Fail(result < 0 ? result : Z_BUF_ERROR);
+    }
+    else if (attempted && (compressedSize + extraHeader >= originalSize ||
+                           compressedSize + extraHeader >= maxRatio * originalSize))
+    {
+        NS_LOG_LOGIC("Keeping packet uncompressed: " << originalSize << " -> "
+                                                     << compressedSize << " bytes");
+    }
+    else if (attempted)
+    {
+        header.SetFlags(ZlibHeader::COMPRESSED);
+        header.SetOriginalSize(originalSize);
+        packet->RemoveAtEnd(originalSize);
+        packet->AddAtEnd(Create<Packet>(m_scratch.data(), compressedSize));
+    }
+
+    packet->AddHeader(header);
+    if (!attempted || result == Z_STREAM_END)
+    {
+        scope.Succeed(packet->GetSize());
+    }
+    return header.IsCompressed();
+}
+
+bool ZlibInteg::DecompressPacket(Ptr<Packet> packet)
+{
+    NS_LOG_FUNCTION(this << packet);
+    OperationScope scope(this, false, packet->GetSize());
+
+    uint8_t flags = 0;
+    if (packet->CopyData(&flags, 1) != 1 ||
+        ((flags & ZlibHeader::COMPRESSED) && packet->GetSize() < 5))
+    {
+        NS_LOG_ERROR("Packet too short to carry a ZlibHeader");
+        scope.Fail(Z_DATA_ERROR);
+        return false;
+    }
+
+    ZlibHeader header;
+    packet->PeekHeader(header);
+    if (!header.IsCompressed())
+    {
+        packet->RemoveHeader(header);
+        scope.Succeed(packet->GetSize());
+        return true;
+    }
+
+    uint32_t headerSize = header.GetSerializedSize();
+    uint32_t compressedSize = packet->GetSize() - headerSize;
+    uint32_t originalSize = header.GetOriginalSize();
+    if (originalSize == 0 || (IsZlibCodec() && originalSize / MAX_DEFLATE_RATIO > compressedSize) ||
+        (m_maxInflateSize > 0 && originalSize > m_maxInflateSize))
+    {
+        NS_LOG_ERROR("Invalid original size in ZlibHeader: " << originalSize);
+        scope.Fail(Z_DATA_ERROR);
+        return false;
+    }
+
+    if (m_scratch.size() < originalSize)
+    {
+        m_scratch.resize(originalSize);
+    }
+
+    if (Ptr<CompressionBackend> backend = GetBackend())
+    {
+        // Backends take contiguous input, so the payload is copied out first
+        m_backendInput.resize(compressedSize);
+        packet->CreateFragment(headerSize, compressedSize)->CopyData(m_backendInput.data(), compressedSize);
+        int64_t produced = backend->Decompress(m_backendInput.data(), compressedSize, m_scratch.data(), originalSize);
+        if (produced != originalSize)
+        {
+            NS_LOG_ERROR("Decompression of packet payload failed, error code: " << std::min<int64_t>(produced, 0));
+            scope.Fail(produced < 0 ? static_cast<int>(produced) : Z_DATA_ERROR);
+            return false;
+        }
+    }
+    else
+    {
+        if (!EnsureInflateStream())
+        {
+            scope.Fail(Z_MEM_ERROR);
+            return false;
+        }
+
+        z_stream& stream = *m_inflateStream;
+        inflateReset(&stream);
+        stream.next_out = m_scratch.data();
+        stream.avail_out = originalSize;
+
+        ZStreamBuf sink(&stream, false, headerSize, &m_dictionaries);
+        std::ostream os(&sink);
+        packet->CopyData(&os, packet->GetSize());
+
+        if (sink.GetResult() != Z_STREAM_END || stream.avail_out != 0)
+        {
+            NS_LOG_ERROR("inflate of packet payload failed, error code: " << sink.GetResult());
+            scope.Fail(sink.GetResult() < 0 ? sink.GetResult() : Z_DATA_ERROR);
+            return false;
+        }
+    }
+
+    packet->RemoveAtEnd(packet->GetSize());
+    packet->AddAtEnd(Create<Packet>(m_scratch.data(), originalSize));
+    scope.Succeed(originalSize);
+    return true;
+}
+
+void ZlibInteg::SetLinkState(DataRate rate, uint32_t backlogBytes)
+{
+    NS_LOG_FUNCTION(this << rate << backlogBytes);
+    m_linkRate = rate;
+    m_backlogBytes = backlogBytes;
+}
+
+size_t ZlibInteg::ChooseCandidate(uint32_t size)
+{
+    m_adaptivePackets++;
+
+    // Measure every candidate once, then re-measure them in turn now and then
+    for (size_t i = 0; i < m_candidates.size(); i++)
+    {
+        if (m_candidates[i].samples == 0)
+        {
+            return i;
+        }
+    }
+    if (m_adaptivePackets % ADAPTIVE_EXPLORE_INTERVAL == 0)
+    {
+        size_t explored = m_nextExplored;
+        m_nextExplored = (m_nextExplored + 1) % m_candidates.size();
+        if (m_candidates[explored].level != 0)
+        {
+            return explored;
+        }
+    }
+
+    if (m_linkRate.GetBitRate() == 0)
+    {
+        // No link state yet: fall back to the Level and Strategy attributes
+        return m_candidates.size();
+    }
+
+    // CPU time overlaps with the transmission of the backlog; only the part
+    // beyond it delays the packet
+    double secondsPerByte = 8.0 / m_linkRate.GetBitRate();
+    double budget = m_cpuBudget * size * secondsPerByte;
+    double hidden = m_backlogBytes * secondsPerByte;
+
+    size_t best = 0;
+    double bestCost = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < m_candidates.size(); i++)
+    {
+        const LevelCandidate& estimate = m_candidates[i];
+        double cpu = estimate.cpuPerByte * size;
+        if (cpu > budget && estimate.level != 0)
+        {
+            continue;
+        }
+        double cost = std::max(0.0, cpu - hidden) + estimate.ratio * size * secondsPerByte;
+        if (cost < bestCost)
+        {
+            best = i;
+            bestCost = cost;
+        }
+    }
+
+    NS_LOG_LOGIC("Packet of " << size << " bytes, backlog " << m_backlogBytes << " bytes: level "
+                              << m_candidates[best].level << " strategy "
+                              << m_candidates[best].strategy);
+    return best;
+}
+
+int64_t ZlibInteg::InflateInto(z_stream_s* stream,
+                               const uint8_t* input,
+                               size_t inputSize,
+                               uint8_t* output,
+                               size_t outputCapacity) const
+{
+    inflateReset(stream);
+
+    stream->next_in = const_cast<Bytef*>(input);
+    stream->next_out = output;
+
+    // avail_in/avail_out are 32-bit, so very large buffers are fed in slices
+    size_t remainingIn = inputSize;
+    size_t remainingOut = outputCapacity;
+    int result = Z_OK;
+    do
+    {
+        stream->avail_in = static_cast<uInt>(std::min<size_t>(remainingIn, UINT_MAX));
+        stream->avail_out = static_cast<uInt>(std::min<size_t>(remainingOut, UINT_MAX));
+        uInt availIn = stream->avail_in;
+        uInt availOut = stream->avail_out;
+
+        result = InflateWithDictionary(stream, Z_FINISH, m_dictionaries);
+
+        remainingIn -= availIn - stream->avail_in;
+        remainingOut -= availOut - stream->avail_out;
+    } while (result == Z_OK || (result == Z_BUF_ERROR && remainingIn > 0 && remainingOut > 0));
+
+    if (result != Z_STREAM_END)
+    {
+        return result == Z_OK ? Z_BUF_ERROR : result;
+    }
+    return static_cast<int64_t>(outputCapacity - remainingOut);
+}
+
+bool ZlibInteg::FlowKey::operator<(const FlowKey& other) const
+{
+    return std::tie(source, destination, port) < std::tie(other.source, other.destination, other.port);
+}
+
+ZlibInteg::FlowState* ZlibInteg::GetFlowState(std::map<FlowKey, FlowState>& flows,
+                                              const FlowKey& flow,
+                                              bool deflating)
+{
+    auto it = flows.find(flow);
+    if (it != flows.end())
+    {
+        return &it->second;
+    }
+
+    FlowState state;
+    state.stream = new z_stream;
+    SetAllocator(*state.stream, m_memoryPool);
+    state.stream->avail_in = 0;
+    state.stream->next_in = Z_NULL;
+    state.nextSequence = 0;
+    state.sinceResync = 0;
+    state.synchronized = false;
+
+    // Raw deflate (negative window bits): the flow header replaces the zlib framing
+    int result = deflating ? deflateInit2(state.stream, m_level, Z_DEFLATED, -m_windowBits,
+                                          m_memLevel, static_cast<int>(m_strategy))
+                           : inflateInit2(state.stream, -m_windowBits);
+    if (result != Z_OK)
+    {
+        NS_LOG_ERROR("Flow context initialization failed with error code: " << result);
+        delete state.stream;
+        return nullptr;
+    }
+
+    NS_LOG_LOGIC("New " << (deflating ? "deflate" : "inflate") << " context for flow "
+                        << flow.source << " -> " << flow.destination << ":" << flow.port);
+    return &flows.emplace(flow, state).first->second;
+}
+
+void ZlibInteg::ReleaseFlowState(FlowState& state, bool deflating)
+{
+    if (deflating)
+    {
+        deflateEnd(state.stream);
+    }
+    else
+    {
+        inflateEnd(state.stream);
+    }
+    delete state.stream;
+    state.stream = nullptr;
+}
+
+void ZlibInteg::ResetFlow(const FlowKey& flow)
+{
+    NS_LOG_FUNCTION(this << flow.source << flow.destination << flow.port);
+
+    auto it = m_deflateFlows.find(flow);
+    if (it != m_deflateFlows.end())
+    {
+        it->second.synchronized = false;
+    }
+    it = m_inflateFlows.find(flow);
+    if (it != m_inflateFlows.end())
+    {
+        it->second.synchronized = false;
+    }
+}
+
+void ZlibInteg::RemoveFlow(const FlowKey& flow)
+{
+    NS_LOG_FUNCTION(this << flow.source << flow.destination << flow.port);
+
+    auto it = m_deflateFlows.find(flow);
+    if (it != m_deflateFlows.end())
+    {
+        ReleaseFlowState(it->second, true);
+        m_deflateFlows.erase(it);
+    }
+    it = m_inflateFlows.find(flow);
+    if (it != m_inflateFlows.end())
+    {
+        ReleaseFlowState(it->second, false);
+        m_inflateFlows.erase(it);
+    }
+}
+
+std::vector<uint8_t> ZlibInteg::DeflateFlow(const FlowKey& flow, const std::vector<uint8_t>& inputData)
+{
+    NS_LOG_FUNCTION(this << flow.source << flow.destination << flow.port);
+    OperationScope scope(this, true, inputData.size());
+
+    if (inputData.empty() || inputData.size() > UINT_MAX)
+    {
+        NS_LOG_WARN("Input data for flow deflate is empty or too large.");
+        scope.Fail(Z_STREAM_ERROR);
+        return {};
+    }
+
+    FlowState* state = GetFlowState(m_deflateFlows, flow, true);
+    if (!state)
+    {
+        scope.Fail(Z_MEM_ERROR);
+        return {};
+    }
+    z_stream& stream = *state->stream;
+
+    uint8_t flags = 0;
+    if (!state->synchronized ||
+        (m_flowResyncInterval > 0 && state->sinceResync >= m_flowResyncInterval))
+    {
+        // Start from an empty history so that a receiver can join here
+        deflateReset(&stream);
+        flags |= FLOW_RESYNC;
+        state->synchronized = true;
+        state->sinceResync = 0;
+    }
+
+    std::vector<uint8_t> compressedData(FLOW_HEADER_SIZE + deflateBound(&stream, inputData.size()) +
+                                        sizeof(SYNC_FLUSH_TAIL));
+    compressedData[0] = flags;
+    compressedData[1] = static_cast<uint8_t>(state->nextSequence >> 8);
+    compressedData[2] = static_cast<uint8_t>(state->nextSequence);
+
+    stream.next_in = const_cast<Bytef*>(inputData.data());
+    stream.avail_in = static_cast<uInt>(inputData.size());
+
+    size_t produced = FLOW_HEADER_SIZE;
+    bool retry = false;
+    int result;
+    do
+    {
+        if (produced == compressedData.size())
+        {
+            compressedData.resize(compressedData.size() * 2);
+        }
+        stream.next_out = compressedData.data() + produced;
+        stream.avail_out = static_cast<uInt>(compressedData.size() - produced);
+
+        result = deflate(&stream, Z_SYNC_FLUSH);
+        if (result == Z_BUF_ERROR && retry)
+        {
+            // Nothing was left pending after a flush that exactly filled the buffer
+            result = Z_OK;
+        }
+        produced = compressedData.size() - stream.avail_out;
+        retry = true;
+    } while (result == Z_OK && stream.avail_out == 0);
+
+    if (result != Z_OK || produced < FLOW_HEADER_SIZE + sizeof(SYNC_FLUSH_TAIL))
+    {
+        NS_LOG_ERROR("Flow deflate failed with error code: " << result);
+        state->synchronized = false;
+        scope.Fail(result != Z_OK ? result : Z_BUF_ERROR);
+        return {};
+    }
+
+    state->nextSequence++;
+    state->sinceResync++;
+
+    // Every sync flush ends with the same empty stored block; the receiver re-appends it
+    compressedData.resize(produced - sizeof(SYNC_FLUSH_TAIL));
+    scope.Succeed(compressedData.size());
+    return compressedData;
+}
+
+std::vector<uint8_t> ZlibInteg::InflateFlow(const FlowKey& flow, const std::vector<uint8_t>& compressedData)
+{
+    NS_LOG_FUNCTION(this << flow.source << flow.destination << flow.port);
+    OperationScope scope(this, false, compressedData.size());
+
+    if (compressedData.size() <= FLOW_HEADER_SIZE)
+    {
+        NS_LOG_WARN("Input data for flow inflate is too short.");
+        scope.Fail(Z_STREAM_ERROR);
+        return {};
+    }
+
+    FlowState* state = GetFlowState(m_inflateFlows, flow, false);
+    if (!state)
+    {
+        scope.Fail(Z_MEM_ERROR);
+        return {};
+    }
+    z_stream& stream = *state->stream;
+
+    uint8_t flags = compressedData[0];
+    uint16_t sequence = static_cast<uint16_t>((compressedData[1] << 8) | compressedData[2]);
+
+    if (flags & FLOW_RESYNC)
+    {
+        inflateReset(&stream);
+        state->synchronized = true;
+    }
+    else if (!state->synchronized || sequence != state->nextSequence)
+    {
+        if (state->synchronized)
+        {
+            NS_LOG_WARN("Flow packet " << state->nextSequence << " lost (got " << sequence
+                                       << "), waiting for a resynchronization point");
+        }
+        state->synchronized = false;
+        scope.Fail(Z_DATA_ERROR);
+        return {};
+    }
+    state->nextSequence = sequence + 1;
+
+    // Re-append the sync flush tail stripped by the sender
+    size_t bodySize = compressedData.size() - FLOW_HEADER_SIZE;
+    size_t inputSize = bodySize + sizeof(SYNC_FLUSH_TAIL);
+    if (m_scratch.size() < inputSize)
+    {
+        m_scratch.resize(inputSize);
+    }
+    std::copy(compressedData.begin() + FLOW_HEADER_SIZE, compressedData.end(), m_scratch.begin());
+    std::copy(SYNC_FLUSH_TAIL, SYNC_FLUSH_TAIL + sizeof(SYNC_FLUSH_TAIL), m_scratch.begin() + bodySize);
+
+    stream.next_in = m_scratch.data();
+    stream.avail_in = static_cast<uInt>(inputSize);
+
+    size_t limit = inputSize * MAX_DEFLATE_RATIO;
+    if (m_maxInflateSize > 0)
+    {
+        limit = std::min<uint64_t>(limit, m_maxInflateSize);
+    }
+    std::vector<uint8_t> decompressedData(std::min<size_t>(std::max<size_t>(bodySize * 4, 256), limit));
+    size_t produced = 0;
+    int result;
+    do
+    {
+        if (produced == decompressedData.size())
+        {
+            decompressedData.resize(std::min(decompressedData.size() * 2, limit));
+        }
+        stream.next_out = decompressedData.data() + produced;
+        stream.avail_out = static_cast<uInt>(decompressedData.size() - produced);
+
+        result = inflate(&stream, Z_SYNC_FLUSH);
+        if (result == Z_BUF_ERROR && stream.avail_in == 0)
+        {
+            // All input consumed and no output pending
+            result = Z_OK;
+            break;
+        }
+        produced = decompressedData.size() - stream.avail_out;
+    } while (result == Z_OK && (stream.avail_in > 0 || stream.avail_out == 0) &&
+             !(produced == limit && stream.avail_out == 0));
+
+    if (result != Z_OK || stream.avail_in > 0)
+    {
+        NS_LOG_ERROR("Flow inflate failed with error code: " << result);
+        state->synchronized = false;
+        scope.Fail(result != Z_OK ? result : Z_BUF_ERROR);
+        return {};
+    }
+
+    decompressedData.resize(produced);
+    scope.Succeed(decompressedData.size());
+    return decompressedData;
+}
+
+uint32_t ZlibInteg::AddDictionary(const std::vector<uint8_t>& dictionary)
+{
+    NS_LOG_FUNCTION(this << dictionary.size());
+
+    if (dictionary.empty() || dictionary.size() > UINT_MAX)
+    {
+        NS_LOG_WARN("Dictionary is empty or too large.");
+        return 0;
+    }
+
+    uint32_t id = static_cast<uint32_t>(
+        adler32(adler32(0L, Z_NULL, 0), dictionary.data(), static_cast<uInt>(dictionary.size())));
+    if (id == 0)
+    {
+        // 0 means "no dictionary" for the DictionaryId attribute
+        NS_LOG_WARN("Dictionary checksum is 0; append a byte to make it usable.");
+        return 0;
+    }
+
+    m_dictionaries[id] = dictionary;
+    NS_LOG_LOGIC("Registered dictionary " << id << " of " << dictionary.size() << " bytes");
+    return id;
+}
+
+void ZlibInteg::RemoveDictionary(uint32_t id)
+{
+    NS_LOG_FUNCTION(this << id);
+    m_dictionaries.erase(id);
+}
+
+std::vector<uint8_t> ZlibInteg::TrainDictionary(const std::vector<std::vector<uint8_t>>& samples,
+                                                size_t maxSize)
+{
+    NS_LOG_FUNCTION(samples.size() << maxSize);
+
+    // Count in how many samples each substring occurs; 8-byte substrings are
+    // their own exact 64-bit keys
+    auto gramAt = [](const uint8_t* data) {
+        uint64_t gram;
+        std::memcpy(&gram, data, sizeof(gram));
+        return gram;
+    };
+    std::unordered_map<uint64_t, uint32_t> frequency;
+    std::unordered_map<uint64_t, uint32_t> lastSample;
+    for (size_t s = 0; s < samples.size(); s++)
+    {
+        for (size_t i = 0; i + TRAIN_GRAM_SIZE <= samples[s].size(); i++)
+        {
+            uint64_t gram = gramAt(samples[s].data() + i);
+            uint32_t& last = lastSample[gram];
+            if (last != s + 1)
+            {
+                last = static_cast<uint32_t>(s + 1);
+                frequency[gram]++;
+            }
+        }
+    }
+    lastSample.clear();
+
+    // A segment is worth the extra occurrences of the substrings it covers
+    // that no segment picked so far already covers
+    struct Segment
+    {
+        size_t sample;
+        size_t offset;
+        size_t length;
+    };
+    auto score = [&](const Segment& segment) {
+        uint64_t total = 0;
+        std::vector<uint64_t> seen;
+        const uint8_t* data = samples[segment.sample].data() + segment.offset;
+        for (size_t i = 0; i + TRAIN_GRAM_SIZE <= segment.length; i++)
+        {
+            uint64_t gram = gramAt(data + i);
+            if (std::find(seen.begin(), seen.end(), gram) == seen.end())
+            {
+                seen.push_back(gram);
+                uint32_t count = frequency[gram];
+                total += count > 1 ? count - 1 : 0;
+            }
+        }
+        return total;
+    };
+
+    std::vector<Segment> segments;
+    std::priority_queue<std::pair<uint64_t, size_t>> candidates;
+    for (size_t s = 0; s < samples.size(); s++)
+    {
+        size_t offset = 0;
+        do
+        {
+            Segment segment = {s, offset, std::min(TRAIN_SEGMENT_SIZE, samples[s].size() - offset)};
+            uint64_t value = score(segment);
+            if (value > 0)
+            {
+                candidates.emplace(value, segments.size());
+                segments.push_back(segment);
+            }
+            offset += TRAIN_SEGMENT_SIZE / 2;
+        } while (offset + TRAIN_SEGMENT_SIZE / 2 < samples[s].size());
+    }
+
+    // Lazy greedy selection: scores only drop as substrings get covered, so a
+    // candidate whose refreshed score still beats the next one is the best
+    std::vector<size_t> picked;
+    size_t pickedSize = 0;
+    while (!candidates.empty() && pickedSize < maxSize)
+    {
+        size_t index = candidates.top().second;
+        candidates.pop();
+        uint64_t value = score(segments[index]);
+        if (value == 0)
+        {
+            continue;
+        }
+        if (!candidates.empty() && value < candidates.top().first)
+        {
+            candidates.emplace(value, index);
+            continue;
+        }
+
+        const Segment& segment = segments[index];
+        const uint8_t* data = samples[segment.sample].data() + segment.offset;
+        for (size_t i = 0; i + TRAIN_GRAM_SIZE <= segment.length; i++)
+        {
+            frequency[gramAt(data + i)] = 0;
+        }
+        picked.push_back(index);
+        pickedSize += segment.length;
+    }
+
+    // Best segments last, closest to the data; trim the least valuable from the front
+    std::vector<uint8_t> dictionary;
+    dictionary.reserve(pickedSize);
+    for (auto it = picked.rbegin(); it != picked.rend(); ++it)
+    {
+        const Segment& segment = segments[*it];
+        const uint8_t* data = samples[segment.sample].data() + segment.offset;
+        dictionary.insert(dictionary.end(), data, data + segment.length);
+    }
+    if (dictionary.size() > maxSize)
+    {
+        dictionary.erase(dictionary.begin(), dictionary.end() - maxSize);
+    }
+
+    NS_LOG_LOGIC("Trained a " << dictionary.size() << "-byte dictionary from " << samples.size()
+                              << " samples");
+    return dictionary;
+}
+
+size_t ZlibInteg::VarintSize(uint64_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+size_t ZlibInteg::WriteVarint(uint64_t value, uint8_t* output)
+{
+    size_t i = 0;
+    while (value >= 0x80)
+    {
+        output[i++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    output[i++] = static_cast<uint8_t>(value);
+    return i;
+}
+
+size_t ZlibInteg::ReadVarint(const uint8_t* input, size_t inputSize, uint64_t& value)
+{
+    value = 0;
+    for (size_t i = 0; i < inputSize && i < 10; i++)
+    {
+        // The tenth byte holds only the top bit of a 64-bit value
+        if (i == 9 && input[i] > 1)
+        {
+            return 0;
+        }
+        value |= static_cast<uint64_t>(input[i] & 0x7f) << (7 * i);
+        if ((input[i] & 0x80) == 0)
+        {
+            // Only the minimal encoding is accepted, so callers can skip
+            // VarintSize(value) bytes; a padded one such as 0x80 0x00 is not
+            return (i > 0 && input[i] == 0) ? 0 : i + 1;
+        }
+    }
+    return 0;
+}
+
+} // namespace ns3
@@ -1,19 +1,249 @@
 #ifndef ZLIB_INTEG_H
 #define ZLIB_INTEG_H
 
+#include "compression-backend.h"
+#include "ns3/callback.h"
+#include "ns3/data-rate.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
 #include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "ns3/traced-callback.h"
+#include <chrono>
+#include <list>
+#include <map>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 #include <cstdint> // Required for uint8_t
 
+// Forward declaration of zlib's stream state so that zlib.h stays out of the public header
+struct z_stream_s;
+
 namespace ns3 {
 
 /**
  * @brief An ns-3 object that integrates zlib functionality.
+ *
+ * Each instance keeps one deflate and one inflate context alive for its whole
+ * lifetime. The contexts are reset (not re-created) between calls, so the
+ * per-call cost is the compression work itself rather than zlib's state setup.
+ * The contexts are re-created only when the WindowBits, MemLevel or Format
+ * attributes change; a new Level or Strategy is applied to the existing
+ * deflate context. Their memory comes from the process-wide
+ * ZlibMemoryPool, so compressors created and destroyed over a simulation
+ * recycle the same blocks.
+ *
+ * With the SizePrefix attribute enabled, Deflate() writes the original length
+ * as a varint ahead of the zlib stream, and Inflate() uses it to decompress in
+ * a single pass straight into an exactly sized buffer. Both ends must agree on
+ * the setting.
+ *
+ * CompressPacket() and DecompressPacket() transform ns3::Packet payloads in
+ * flight, marking them with a ZlibHeader. The packet bytes are streamed
+ * straight from the packet buffer into zlib rather than copied out first.
+ *
+ * DeflateFlow() and InflateFlow() compress the packets of one flow against a
+ * shared history, so content repeated across packets is only sent once. Each
+ * flow owns a long-lived raw deflate stream on the sender and a matching
+ * inflate stream on the receiver; every packet ends on a Z_SYNC_FLUSH
+ * boundary. A small per-packet header carries a sequence number, and every
+ * FlowResyncInterval packets the sender restarts the stream so that a receiver
+ * that lost a packet can resynchronize.
+ *
+ * Small payloads compress poorly because the history window starts empty.
+ * A preset dictionary of content typical for the traffic (see
+ * TrainDictionary()) fills it in advance. Dictionaries are registered with
+ * AddDictionary() and identified by their Adler-32 checksum, which is the
+ * dictionary ID zlib records in the stream header; Deflate() primes its
+ * context with the dictionary selected by the DictionaryId attribute, and
+ * Inflate() looks up whichever dictionary a stream asks for.
+ *
+ * With Threads above 1, Deflate() splits inputs larger than BlockSize into
+ * blocks compressed concurrently, pigz-style: each block is a raw deflate
+ * segment primed with the window of input preceding it and ended on a
+ * Z_SYNC_FLUSH boundary, and the segments are stitched into one ordinary
+ * zlib stream whose checksum is combined from the per-block checksums. The
+ * result decodes with any zlib inflater, including Inflate(); it is a little
+ * larger than a serial stream, since matches cannot span the flush points.
+ *
+ * DeflateSeekable() produces a container for random access instead: BlockSize
+ * blocks compressed as independent zlib streams, followed by an index of
+ * their offsets. InflateRange() decompresses only the blocks covering the
+ * requested bytes, on up to Threads threads.
+ *
+ * With AdaptiveLevel enabled, CompressPacket() picks the level and strategy
+ * for every packet from a cost model: each candidate keeps a moving average
+ * of its measured CPU time per byte and of its compression ratio, and the
+ * link state reported through SetLinkState() turns both into time. A
+ * candidate is eligible if its CPU time fits within CpuBudget times the
+ * packet's transmission time; among those, the one minimizing the CPU time
+ * not hidden behind the queue backlog plus the transmission time of its
+ * output wins. Fast links or short queues thus favour fast levels, and a
+ * backlogged slow link the strongest ones. Candidates are re-measured
+ * periodically so the estimates follow the traffic.
+ *
+ * Before compressing, Deflate() and CompressPacket() estimate the entropy of
+ * a sample of the input. Data above SkipEntropy bits per byte, such as
+ * encrypted or already compressed payloads, is not worth the CPU time:
+ * Deflate() then emits it in stored blocks, which is still a valid zlib
+ * stream, and CompressPacket() leaves the packet uncompressed. The estimate
+ * only sees byte frequencies, so high-entropy data made of repeated blocks
+ * is skipped too.
+ *
+ * The Format attribute selects the framing of the streams: zlib (the
+ * default), raw deflate, which saves the 6 bytes of zlib header and trailer
+ * per stream, or gzip. Preset dictionaries need the zlib framing, the only
+ * one that records their ID. The Codec attribute swaps zlib for another
+ * CompressionBackend (lz4 or zstd, when found at build time) in Deflate(),
+ * Inflate(), CompressPacket() and DecompressPacket(), so codecs can be
+ * compared in the same simulation; SizePrefix and the ZlibHeader still apply.
+ * The flow, seekable, batch and streaming APIs always use zlib.
+ *
+ * DeflateBatch() and InflateBatch() process many small buffers per call for
+ * offline work: the results are written back to back into one Batch arena,
+ * and each worker thread sets up a single stream context for all its items.
+ *
+ * Every public compression and decompression call is accounted for: the
+ * Deflate and Inflate trace sources report its input and output sizes and
+ * wall-clock duration, DeflateFailure and InflateFailure its errors, and
+ * read-only attributes such as DeflateBytesIn or InflateTime accumulate them
+ * over the object's lifetime, so they can be collected through Config paths
+ * at the end of a run. A call made by another public call, such as the
+ * vector Inflate() using the pointer one, is only counted once.
+ *
+ * With CacheSize above 0, Deflate() and CompressPacket() remember their
+ * recent outputs in an LRU cache keyed by a hash of the input, so a payload
+ * sent over and over is compressed only once. A hit is confirmed by
+ * comparing the whole input, and changing any attribute that shapes the
+ * output, including SkipEntropy, Threads and BlockSize, empties the cache.
+ * Adaptive packets bypass it, since their level changes from packet to
+ * packet. Calls answered from the cache count as CacheHits rather than as
+ * CompressedCount or SkippedCount.
  */
 class ZlibInteg : public Object
 {
 public:
+  /**
+   * @brief Identifies a flow for stateful compression.
+   */
+  struct FlowKey
+  {
+    Ipv4Address source;       ///< Source address
+    Ipv4Address destination;  ///< Destination address
+    uint16_t port;            ///< Destination port
+
+    /**
+     * @brief Strict ordering, so keys can index a std::map.
+     */
+    bool operator<(const FlowKey& other) const;
+  };
+
+  /**
+   * @brief Deflate strategies, in zlib's numbering.
+   */
+  enum Strategy
+  {
+    DEFAULT_STRATEGY = 0,  ///< Z_DEFAULT_STRATEGY
+    FILTERED = 1,          ///< Z_FILTERED: favour Huffman coding over string matching
+    HUFFMAN_ONLY = 2,      ///< Z_HUFFMAN_ONLY: no string matching
+    RLE = 3,               ///< Z_RLE: matches limited to runs of one byte
+    FIXED = 4              ///< Z_FIXED: no dynamic Huffman codes
+  };
+
+  /**
+   * @brief Framing around the deflate data of zlib-codec streams.
+   */
+  enum Format
+  {
+    FORMAT_ZLIB = 0,  ///< zlib header and Adler-32 trailer (RFC 1950)
+    FORMAT_RAW = 1,   ///< Bare deflate data (RFC 1951)
+    FORMAT_GZIP = 2   ///< gzip header and CRC-32 trailer (RFC 1952)
+  };
+
+  /**
+   * @brief Codecs Deflate() and Inflate() can use.
+   */
+  enum Codec
+  {
+    CODEC_ZLIB = 0,  ///< zlib, in the framing selected by Format
+    CODEC_LZ4 = 1,   ///< Lz4Backend, if lz4 was found at build time
+    CODEC_ZSTD = 2   ///< ZstdBackend, if zstd was found at build time
+  };
+
+  /**
+   * @brief TracedCallback signature for the adaptive level choice.
+   *
+   * @param level The compression level chosen for the packet.
+   * @param strategy The strategy chosen for the packet.
+   */
+  typedef void (*LevelTracedCallback)(int level, Strategy strategy);
+
+  /**
+   * @brief TracedCallback signature for a completed compression or decompression call.
+   *
+   * @param inputBytes Bytes handed to the call.
+   * @param outputBytes Bytes the call produced.
+   * @param wallTime Wall-clock (not simulated) time the call took.
+   */
+  typedef void (*OperationTracedCallback)(uint64_t inputBytes, uint64_t outputBytes, Time wallTime);
+
+  /**
+   * @brief TracedCallback signature for a failed compression or decompression call.
+   *
+   * @param error The zlib error code, or Z_ERRNO (-1) for calls that report
+   * failure without one, such as the vector Inflate().
+   */
+  typedef void (*FailureTracedCallback)(int error);
+
+  /**
+   * @brief Receives the output of InflateStream() chunk by chunk.
+   *
+   * Called with a pointer to the decompressed bytes and their number; the
+   * bytes are only valid during the call. Returning false aborts the
+   * decompression.
+   */
+  typedef Callback<bool, const uint8_t*, uint32_t> InflateSink;
+
+  /**
+   * @brief A list of byte buffers stored back to back in one arena.
+   *
+   * Item i occupies data[offsets[i]] up to data[offsets[i + 1]], so offsets
+   * holds one entry more than there are items.
+   */
+  struct Batch
+  {
+    std::vector<uint8_t> data;     ///< The items, back to back
+    std::vector<size_t> offsets;   ///< Start of every item, plus the end of the last
+
+    /**
+     * @brief Number of items in the batch.
+     */
+    size_t GetCount() const;
+
+    /**
+     * @brief Gets the start of an item.
+     */
+    const uint8_t* GetItem(size_t index) const;
+
+    /**
+     * @brief Gets the size of an item.
+     */
+    size_t GetItemSize(size_t index) const;
+
+    /**
+     * @brief Appends a copy of a buffer as a new item.
+     */
+    void Add(const uint8_t* item, size_t size);
+
+    /**
+     * @brief Removes all items, keeping the allocated memory.
+     */
+    void Clear();
+  };
+
   static TypeId GetTypeId(void);
   ZlibInteg();
   ~ZlibInteg();
@@ -23,8 +253,26 @@ public:
    */
   std::string GetVersion();
 
+  /**
+   * @brief Plugs in a codec, overriding the Codec attribute.
+   *
+   * @param backend The codec, or nullptr to return to the Codec attribute.
+   */
+  void SetBackend(Ptr<CompressionBackend> backend);
+
+  /**
+   * @brief Gets the codec Deflate() and Inflate() delegate to.
+   *
+   * @return The backend, or nullptr when zlib itself is used
+   */
+  Ptr<CompressionBackend> GetBackend();
+
   /**
    * @brief Compresses data using zlib's deflate algorithm.
+   *
+   * @param inputData A vector of bytes to be compressed.
+   * @return The zlib stream, preceded by the original length when SizePrefix is set.
+   * Returns an empty vector on failure.
    */
   std::vector<uint8_t> Deflate(const std::vector<uint8_t>& inputData);
 
@@ -36,9 +284,777 @@ public:
    * Returns an empty vector on failure.
    */
   std::vector<uint8_t> Inflate(const std::vector<uint8_t>& compressedData);
+
+  /**
+   * @brief Compresses data into a caller-owned buffer.
+   *
+   * No memory is allocated per call, so a sender can reuse one scratch buffer
+   * (sized with GetDeflateBound()) for its whole lifetime.
+   *
+   * @param input Bytes to be compressed.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of bytes written, or a negative zlib error code
+   * (Z_BUF_ERROR if the output does not fit).
+   */
+  int64_t Deflate(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity);
+
+  /**
+   * @brief Decompresses data into a caller-owned buffer.
+   *
+   * @param input Bytes to be decompressed.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of bytes written, or a negative zlib error code
+   * (Z_BUF_ERROR if the output does not fit).
+   */
+  int64_t Inflate(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity);
+
+  /**
+   * @brief Decompresses data in constant memory, handing the output to a sink.
+   *
+   * The output is produced in chunks of at most 16 KB, each passed to the
+   * sink as soon as it is ready, so arbitrarily large streams can be piped
+   * into a parser without being held in memory. Decompression stops with an
+   * error once the output exceeds MaxInflateSize.
+   *
+   * @param input Bytes to be decompressed.
+   * @param inputSize Number of input bytes.
+   * @param sink Callback receiving the decompressed chunks.
+   * @return The total number of bytes passed to the sink, or a negative zlib
+   * error code (Z_BUF_ERROR when the size limit is exceeded, Z_STREAM_ERROR
+   * when the sink aborted, Z_DATA_ERROR when the input is corrupt or
+   * truncated). On error the sink may already have received part of the output.
+   */
+  int64_t InflateStream(const uint8_t* input, size_t inputSize, InflateSink sink);
+
+  /**
+   * @brief Decompresses data in constant memory, handing the output to a sink.
+   *
+   * @param compressedData A vector of bytes to be decompressed.
+   * @param sink Callback receiving the decompressed chunks.
+   * @return As for the pointer overload
+   */
+  int64_t InflateStream(const std::vector<uint8_t>& compressedData, InflateSink sink);
+
+  /**
+   * @brief Compresses many buffers in one call.
+   *
+   * Every item is compressed exactly as Deflate() would (size prefix,
+   * dictionary, entropy skip), but the argument checks and stream setup are
+   * paid once per batch instead of once per item, and the results go into a
+   * single arena. Consecutive items are grouped into tasks of about BlockSize
+   * input bytes, which run on up to Threads threads with one deflate context
+   * each. Block-parallel deflate of single items is not used here.
+   *
+   * @param input The buffers to compress.
+   * @param output Receives one compressed item per input item; an item that
+   * could not be compressed is left empty. If any item fails, the whole call
+   * counts as one failure, reported with the error code of the first
+   * failing item.
+   * @return True if every item was compressed
+   */
+  bool DeflateBatch(const Batch& input, Batch& output);
+
+  /**
+   * @brief Compresses many buffers in one call.
+   *
+   * @param inputs The buffers to compress.
+   * @param output As for the Batch overload.
+   * @return As for the Batch overload
+   */
+  bool DeflateBatch(const std::vector<std::vector<uint8_t>>& inputs, Batch& output);
+
+  /**
+   * @brief Decompresses many buffers in one call.
+   *
+   * The counterpart of DeflateBatch(), with the same grouping and threading.
+   * Every item is decompressed as Inflate() would, including the
+   * MaxInflateSize limit, which applies per item.
+   *
+   * @param input The buffers to decompress.
+   * @param output Receives one decompressed item per input item; an item that
+   * could not be decompressed is left empty. If any item fails, the whole call
+   * counts as one failure, reported with the error code of the first
+   * failing item.
+   * @return True if every item was decompressed
+   */
+  bool InflateBatch(const Batch& input, Batch& output);
+
+  /**
+   * @brief Decompresses many buffers in one call.
+   *
+   * @param inputs The buffers to decompress.
+   * @param output As for the Batch overload.
+   * @return As for the Batch overload
+   */
+  bool InflateBatch(const std::vector<std::vector<uint8_t>>& inputs, Batch& output);
+
+  /**
+   * @brief Worst-case output size of Deflate() for the current attributes.
+   *
+   * @param inputSize Number of bytes to be compressed.
+   * @return The capacity an output buffer needs so Deflate() cannot fail for lack of space.
+   */
+  size_t GetDeflateBound(size_t inputSize);
+
+  /**
+   * @brief Reads the original length from a size-prefixed stream.
+   *
+   * @param input Compressed bytes produced with SizePrefix enabled.
+   * @param inputSize Number of compressed bytes.
+   * @return The decompressed size, or a negative zlib error code if SizePrefix is
+   * disabled or the prefix is invalid (Z_BUF_ERROR if it declares more than
+   * MaxInflateSize). Does not log, so it is safe on any thread.
+   */
+  int64_t GetInflatedSize(const uint8_t* input, size_t inputSize) const;
+
+  /**
+   * @brief Compresses the whole content of a packet and prepends a ZlibHeader.
+   *
+   * The packet bytes are fed to zlib straight from the packet buffer. The
+   * compressed form replaces the content only if it is smaller than maxRatio
+   * times the original size (counting the extra header bytes); otherwise the
+   * content is left as is and the header only records that it is uncompressed.
+   * Packet tags are preserved; byte tags on the original content are not.
+   *
+   * @param packet The packet to transform in place.
+   * @param maxRatio Largest compressed/original size ratio worth keeping.
+   * @return true if the content was replaced by its compressed form
+   */
+  bool CompressPacket(Ptr<Packet> packet, double maxRatio = 1.0);
+
+  /**
+   * @brief Removes the ZlibHeader from a packet and restores its original content.
+   *
+   * @param packet A packet transformed by CompressPacket().
+   * @return true on success; on failure the packet is left unchanged
+   */
+  bool DecompressPacket(Ptr<Packet> packet);
+
+  /**
+   * @brief Reports the state of the link compressed packets leave on.
+   *
+   * Used by the adaptive level controller; CompressionQueueDisc calls it for
+   * every packet.
+   *
+   * @param rate The link data rate.
+   * @param backlogBytes Bytes queued ahead of the next packet.
+   */
+  void SetLinkState(DataRate rate, uint32_t backlogBytes);
+
+  /**
+   * @brief Estimates the order-0 entropy of data from a sample of it.
+   *
+   * Up to 4 KB spread over the data are sampled, and the estimate is
+   * corrected for the bias of small samples, so that random data reads
+   * close to 8 bits per byte even in short packets.
+   *
+   * @param data The data to examine.
+   * @param size Number of bytes.
+   * @return Estimated entropy in bits per byte (0 to 8)
+   */
+  static double EstimateEntropy(const uint8_t* data, size_t size);
+
+  /**
+   * @brief Number of Deflate() and CompressPacket() calls that ran deflate.
+   *
+   * Calls answered from the cache are counted by GetCacheHits() instead.
+   */
+  uint64_t GetCompressedCount() const;
+
+  /**
+   * @brief Number of Deflate() and CompressPacket() calls whose input was
+   * judged incompressible and passed through.
+   */
+  uint64_t GetSkippedCount() const;
+
+  /**
+   * @brief Number of Deflate() and CompressPacket() calls answered from the cache.
+   */
+  uint64_t GetCacheHits() const;
+
+  /**
+   * @brief Number of Deflate() and CompressPacket() calls that missed the cache.
+   */
+  uint64_t GetCacheMisses() const;
+
+  /**
+   * @brief Drops every cached output.
+   */
+  void ClearCache();
+
+  /**
+   * @brief Zeroes the call, byte, time and failure statistics.
+   */
+  void ResetStatistics();
+
+  /**
+   * @brief Compresses one packet of a flow against the flow's history.
+   *
+   * The first packet of a flow, every FlowResyncInterval-th packet and the
+   * first packet after ResetFlow() restart the history and are flagged as
+   * resynchronization points.
+   *
+   * @param flow The flow the packet belongs to.
+   * @param inputData The packet payload.
+   * @return A 3-byte flow header followed by the deflate data, or an empty
+   * vector on failure.
+   */
+  std::vector<uint8_t> DeflateFlow(const FlowKey& flow, const std::vector<uint8_t>& inputData);
+
+  /**
+   * @brief Decompresses one packet of a flow produced by DeflateFlow().
+   *
+   * Packets must be fed in order. After a gap in the sequence numbers the
+   * history is unusable, so packets are refused until the next
+   * resynchronization point arrives.
+   *
+   * @param flow The flow the packet belongs to.
+   * @param compressedData Output of DeflateFlow() on the sender.
+   * @return The packet payload, or an empty vector if the packet is corrupt or
+   * the flow is waiting to resynchronize.
+   */
+  std::vector<uint8_t> InflateFlow(const FlowKey& flow, const std::vector<uint8_t>& compressedData);
+
+  /**
+   * @brief Restarts a flow's history.
+   *
+   * On the sender the next packet becomes a resynchronization point (e.g.
+   * when the receiver reports a loss); on the receiver packets are refused
+   * until one arrives.
+   *
+   * @param flow The flow to reset.
+   */
+  void ResetFlow(const FlowKey& flow);
+
+  /**
+   * @brief Releases the compression contexts of a flow that has ended.
+   *
+   * @param flow The flow to remove.
+   */
+  void RemoveFlow(const FlowKey& flow);
+
+  /**
+   * @brief Compresses data into a seekable container.
+   *
+   * Layout, all integers big-endian: the block zlib streams back to back;
+   * then for each block its compressed offset and its uncompressed offset
+   * (8 bytes each); then the total uncompressed size (8 bytes), the block
+   * count (4 bytes) and the magic "ZSIX". Blocks are compressed on up to
+   * Threads threads, with the dictionary selected by DictionaryId if any.
+   *
+   * @param inputData A vector of bytes to be compressed.
+   * @return The container, or an empty vector on failure.
+   */
+  std::vector<uint8_t> DeflateSeekable(const std::vector<uint8_t>& inputData);
+
+  /**
+   * @brief Reads the uncompressed size of a seekable container.
+   *
+   * @param container Output of DeflateSeekable().
+   * @return The uncompressed size, or a negative zlib error code if the index is invalid
+   */
+  int64_t GetSeekableSize(const std::vector<uint8_t>& container);
+
+  /**
+   * @brief Decompresses a byte range of a seekable container.
+   *
+   * Only the blocks overlapping the range are decompressed, on up to Threads
+   * threads. A range running past the end is truncated.
+   *
+   * @param container Output of DeflateSeekable().
+   * @param offset First uncompressed byte to return.
+   * @param length Number of uncompressed bytes to return.
+   * @return The requested bytes, or an empty vector if the container is
+   * corrupt or the range starts past its end.
+   */
+  std::vector<uint8_t> InflateRange(const std::vector<uint8_t>& container, uint64_t offset, uint64_t length);
+
+  /**
+   * @brief Registers a preset dictionary.
+   *
+   * The dictionary is available to Inflate() from then on, and to Deflate()
+   * once the DictionaryId attribute is set to the returned ID. Only the last
+   * 2^WindowBits bytes of a dictionary can be referenced, so the most common
+   * strings belong at its end.
+   *
+   * @param dictionary The dictionary content.
+   * @return The dictionary ID (its Adler-32 checksum), or 0 if the dictionary
+   * is empty or its checksum happens to be 0
+   */
+  uint32_t AddDictionary(const std::vector<uint8_t>& dictionary);
+
+  /**
+   * @brief Unregisters a preset dictionary.
+   *
+   * @param id The ID returned by AddDictionary().
+   */
+  void RemoveDictionary(uint32_t id);
+
+  /**
+   * @brief Builds a preset dictionary from sample payloads.
+   *
+   * Picks the segments of the samples whose 8-byte substrings recur in the
+   * largest number of samples, and orders them so that the most valuable
+   * ones end up closest to the data, where zlib encodes references most
+   * cheaply.
+   *
+   * @param samples Payloads representative of the traffic to be compressed.
+   * @param maxSize Largest dictionary to build; a few KB suits packet-sized
+   * payloads, since zlib hashes the whole dictionary on every Deflate() call.
+   * @return The dictionary, or an empty vector if the samples share no content
+   */
+  static std::vector<uint8_t> TrainDictionary(const std::vector<std::vector<uint8_t>>& samples,
+                                              size_t maxSize = 4096);
+
+protected:
+  void DoDispose() override;
+
+private:
+  /**
+   * @brief Accounts for one public call in the statistics and trace sources.
+   *
+   * Created at the start of a call and recorded when it goes out of scope:
+   * as a success with the output size given to Finish(), or as a failure.
+   * Only the outermost scope of nested calls records anything.
+   */
+  class OperationScope
+  {
+  public:
+    /**
+     * @param owner The object whose statistics are updated.
+     * @param deflating Whether the call compresses.
+     * @param inputSize Bytes handed to the call.
+     */
+    OperationScope(ZlibInteg* owner, bool deflating, uint64_t inputSize);
+    ~OperationScope();
+
+    /**
+     * @brief Sets the outcome of a call returning a byte count or a negative zlib error code.
+     * @return result, unchanged
+     */
+    int64_t Finish(int64_t result);
+
+    /**
+     * @brief Marks the call as successful, having produced outputSize bytes.
+     */
+    void Succeed(uint64_t outputSize);
+
+    /**
+     * @brief Marks the call as failed with a zlib error code.
+     */
+    void Fail(int error);
+
+  private:
+    ZlibInteg* m_owner;                               ///< Object whose statistics are updated
+    bool m_deflating;                                 ///< Whether the call compresses
+    bool m_outermost;                                 ///< Whether this scope records the call
+    uint64_t m_inputSize;                             ///< Bytes handed to the call
+    int64_t m_result;                                 ///< Output size, or a negative zlib error code
+    std::chrono::steady_clock::time_point m_start;    ///< When the call started
+  };
+
+  /**
+   * @brief Makes sure the deflate context exists and matches the current attributes.
+   * @return true if the context is ready to be reset and used
+   */
+  bool EnsureDeflateStream();
+
+  /**
+   * @brief Makes sure the deflate context exists with the given level and strategy.
+   *
+   * A new level or strategy is applied with deflateParams() on the existing
+   * context; only a change of window size, memory level or format re-creates it.
+   *
+   * @return true if the context is ready to be reset and used
+   */
+  bool EnsureDeflateStream(int level, Strategy strategy);
+
+  /**
+   * @brief Makes sure the inflate context exists and matches the current attributes.
+   * @return true if the context is ready to be reset and used
+   */
+  bool EnsureInflateStream();
+
+  /**
+   * @brief Window bits for deflateInit2/inflateInit2, encoding the Format.
+   */
+  int GetStreamWindowBits() const;
+
+  /**
+   * @brief Whether Deflate() and Inflate() run zlib rather than a backend.
+   */
+  bool IsZlibCodec() const;
+
+  /**
+   * @brief Writes data as a zlib stream of stored (uncompressed) blocks.
+   *
+   * @param input Bytes to be stored.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of bytes written, or Z_BUF_ERROR if the output does not fit
+   */
+  int64_t StoreInto(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity) const;
+
+  /**
+   * @brief Deflate() without the cache.
+   *
+   * @param input Bytes to be compressed.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of bytes written, or a negative zlib error code
+   */
+  int64_t DeflateUncached(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity);
+
+  /**
+   * @brief Attributes that shape compressed output, compared to invalidate the cache.
+   */
+  typedef std::tuple<int,
+                     Strategy,
+                     uint8_t,
+                     uint8_t,
+                     Format,
+                     Codec,
+                     const CompressionBackend*,
+                     uint32_t,
+                     bool,
+                     double,
+                     uint32_t,
+                     uint32_t>
+      CacheSettings;
+
+  /**
+   * @brief One cached compression result.
+   */
+  struct CacheEntry
+  {
+    uint64_t hash;                ///< Hash of the input
+    bool packet;                  ///< Whether the output is a CompressPacket() payload rather than a Deflate() stream
+    std::vector<uint8_t> input;   ///< The input, compared in full on a hit
+    std::vector<uint8_t> output;  ///< The compressed output
+  };
+
+  /**
+   * @brief Gets the current values of the attributes that shape compressed output.
+   */
+  CacheSettings GetCacheSettings() const;
+
+  /**
+   * @brief Looks up the output cached for an input, counting a hit or a miss.
+   *
+   * A hit becomes the most recently used entry. The cache is emptied first if
+   * the attributes changed since it was filled.
+   *
+   * @param input The input.
+   * @param inputSize Number of input bytes.
+   * @param packet Whether the lookup is for CompressPacket().
+   * @param hash Receives the hash of the input, for InsertCache().
+   * @return The cached output, or nullptr on a miss
+   */
+  const std::vector<uint8_t>* LookupCache(const uint8_t* input, size_t inputSize, bool packet, uint64_t& hash);
+
+  /**
+   * @brief Caches a compression result, evicting the least recently used
+   * entries to stay within CacheSize.
+   *
+   * @param hash Hash of the input, from LookupCache().
+   * @param input The input.
+   * @param inputSize Number of input bytes.
+   * @param output The compressed output.
+   * @param outputSize Number of output bytes.
+   * @param packet Whether the output is a CompressPacket() payload.
+   */
+  void InsertCache(uint64_t hash,
+                   const uint8_t* input,
+                   size_t inputSize,
+                   const uint8_t* output,
+                   size_t outputSize,
+                   bool packet);
+
+  /**
+   * @brief Compresses a large input as blocks on a pool of worker threads.
+   *
+   * @param input Bytes to be compressed.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer for the zlib stream.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of bytes written, or a negative zlib error code
+   */
+  int64_t DeflateParallel(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity);
+
+  /**
+   * @brief Cost estimates of one level and strategy for the adaptive controller.
+   */
+  struct LevelCandidate
+  {
+    int level;            ///< Compression level
+    Strategy strategy;    ///< Deflate strategy
+    double cpuPerByte;    ///< Moving average of the CPU time per input byte, in seconds
+    double ratio;         ///< Moving average of the wire/original size ratio
+    uint32_t samples;     ///< Number of measurements so far
+  };
+
+  /**
+   * @brief Picks the candidate to compress a packet with.
+   *
+   * @param size The packet size.
+   * @return Index into m_candidates
+   */
+  size_t ChooseCandidate(uint32_t size);
+
+  /**
+   * @brief Location of one block of a seekable container.
+   */
+  struct SeekableBlock
+  {
+    uint64_t compressedOffset;    ///< Offset of the block's zlib stream in the container
+    uint64_t compressedSize;      ///< Size of the block's zlib stream
+    uint64_t uncompressedOffset;  ///< Offset of the block's content in the original data
+    uint64_t uncompressedSize;    ///< Size of the block's content
+  };
+
+  /**
+   * @brief Parses and validates the index of a seekable container.
+   *
+   * @param container Output of DeflateSeekable().
+   * @param blocks Receives the block locations.
+   * @param totalSize Receives the uncompressed size.
+   * @return true if the index is consistent with the container
+   */
+  static bool ReadSeekableIndex(const std::vector<uint8_t>& container,
+                                std::vector<SeekableBlock>& blocks,
+                                uint64_t& totalSize);
+
+  /**
+   * @brief Looks up the dictionary selected by the DictionaryId attribute.
+   *
+   * @param dictionary Receives the dictionary, or nullptr if none is selected.
+   * @return Z_OK, or Z_STREAM_ERROR if the selected dictionary is not registered
+   */
+  int GetSelectedDictionary(const std::vector<uint8_t>*& dictionary) const;
+
+  /**
+   * @brief Whether Deflate() splits an input of this size across worker threads.
+   */
+  bool UseParallelDeflate(size_t inputSize) const;
+
+  /**
+   * @brief Resets a deflate context and primes it with the selected dictionary.
+   *
+   * Worker threads call it, so it does not log; the selected dictionary must
+   * have been checked with GetSelectedDictionary() on the calling thread.
+   *
+   * @param stream The context to reset.
+   * @return Z_OK, or a zlib error code if the dictionary is unknown or cannot be set
+   */
+  int ResetDeflateStream(z_stream_s* stream) const;
+
+  /**
+   * @brief Compresses one complete zlib stream on a deflate context.
+   *
+   * Worker threads call it, so it does not log; callers report errors.
+   *
+   * @param stream The deflate context.
+   * @param input Bytes to be compressed.
+   * @param inputSize Number of input bytes.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @param store Whether to emit stored blocks instead of compressing.
+   * @return The number of bytes written, or a negative zlib error code
+   */
+  int64_t DeflateInto(z_stream_s* stream,
+                      const uint8_t* input,
+                      size_t inputSize,
+                      uint8_t* output,
+                      size_t outputCapacity,
+                      bool store) const;
+
+  /**
+   * @brief Worst-case Deflate() output size on a context, ignoring parallel mode.
+   */
+  size_t DeflateBoundOn(z_stream_s* stream, size_t inputSize) const;
+
+  /**
+   * @brief Whether data is estimated to be above SkipEntropy.
+   */
+  bool IsIncompressible(const uint8_t* data, size_t size) const;
+
+  /// Items of a batch, as start and size
+  typedef std::vector<std::pair<const uint8_t*, size_t>> BatchItems;
+
+  /**
+   * @brief Runs DeflateBatch() or InflateBatch() over a list of items.
+   *
+   * @param items The input items.
+   * @param output Receives the results.
+   * @param deflating Whether to compress or decompress.
+   * @return True if every item succeeded
+   */
+  bool TransformBatch(const BatchItems& items, Batch& output, bool deflating);
+
+  /**
+   * @brief Decompresses one item of InflateBatch(), appending it to an arena.
+   *
+   * Runs on worker threads, so it does not log; TransformBatch() reports errors.
+   *
+   * @param stream The inflate context.
+   * @param input The compressed item.
+   * @param inputSize Number of compressed bytes.
+   * @param arena Receives the decompressed bytes at its end; left unchanged on error.
+   * @return The number of bytes appended, or a negative zlib error code
+   */
+  int64_t InflateAppend(z_stream_s* stream,
+                        const uint8_t* input,
+                        size_t inputSize,
+                        std::vector<uint8_t>& arena) const;
+
+  /**
+   * @brief Releases both zlib contexts.
+   */
+  void ReleaseStreams();
+
+  /**
+   * @brief Per-direction compression state of one flow.
+   */
+  struct FlowState
+  {
+    z_stream_s* stream;         ///< Long-lived raw deflate or inflate stream
+    uint16_t nextSequence;      ///< Sequence number of the next packet
+    uint32_t sinceResync;       ///< Packets sent since the last resynchronization point
+    bool synchronized;          ///< Whether the history matches the peer's
+  };
+
+  /**
+   * @brief Finds or creates the state of a flow.
+   *
+   * @param flows The sender or receiver flow table.
+   * @param flow The flow to look up.
+   * @param deflating Whether a deflate (sender) or inflate (receiver) stream is needed.
+   * @return The flow state, or nullptr if zlib could not be initialized
+   */
+  FlowState* GetFlowState(std::map<FlowKey, FlowState>& flows, const FlowKey& flow, bool deflating);
+
+  /**
+   * @brief Releases the zlib stream of a flow.
+   */
+  static void ReleaseFlowState(FlowState& state, bool deflating);
+
+  /**
+   * @brief Inflates one complete zlib stream on an inflate context.
+   *
+   * Worker threads call it, so it does not log; callers report errors.
+   *
+   * @param stream The inflate context.
+   * @param input The zlib stream.
+   * @param inputSize Number of bytes in the stream.
+   * @param output Destination buffer.
+   * @param outputCapacity Size of the destination buffer.
+   * @return The number of bytes written, or a negative zlib error code
+   */
+  int64_t InflateInto(z_stream_s* stream,
+                      const uint8_t* input,
+                      size_t inputSize,
+                      uint8_t* output,
+                      size_t outputCapacity) const;
+
+  /**
+   * @brief Number of bytes needed to encode a value as a varint.
+   */
+  static size_t VarintSize(uint64_t value);
+
+  /**
+   * @brief Writes a value as a little-endian base-128 varint.
+   * @return The number of bytes written
+   */
+  static size_t WriteVarint(uint64_t value, uint8_t* output);
+
+  /**
+   * @brief Reads a little-endian base-128 varint.
+   *
+   * Only minimal encodings of values that fit in 64 bits are accepted, so
+   * the number of bytes consumed is always VarintSize(value).
+   *
+   * @return The number of bytes consumed, or 0 if the input is truncated, padded or overflows
+   */
+  static size_t ReadVarint(const uint8_t* input, size_t inputSize, uint64_t& value);
+
+  int m_level;                  ///< Compression level (-1 for the zlib default, 0-9)
+  Strategy m_strategy;          ///< Deflate strategy
+  bool m_memoryPool;            ///< Whether zlib allocates from the shared ZlibMemoryPool
+  uint8_t m_windowBits;         ///< Base two logarithm of the history window size
+  uint8_t m_memLevel;           ///< Memory used for the internal compression state (1-9)
+  bool m_sizePrefix;            ///< Whether streams carry their original length as a varint
+  uint64_t m_maxInflateSize;    ///< Largest output any inflate call may produce (0 = unlimited)
+  Format m_format;              ///< Framing of zlib-codec streams
+  Codec m_codec;                ///< Codec selected by attribute
+  Codec m_backendCodec;         ///< Codec m_backend was created for
+  Ptr<CompressionBackend> m_backend;        ///< Backend for m_backendCodec (null for zlib)
+  Ptr<CompressionBackend> m_customBackend;  ///< Backend set by SetBackend(), overriding m_codec
+  std::vector<uint8_t> m_backendInput;      ///< Packet bytes copied out for a backend or the cache
+
+  z_stream_s* m_deflateStream;  ///< Persistent deflate context, reset between calls
+  z_stream_s* m_inflateStream;  ///< Persistent inflate context, reset between calls
+  int m_deflateLevel;           ///< Level the deflate context was initialized with
+  int m_deflateWindowBits;      ///< Window bits the deflate context was initialized with
+  uint8_t m_deflateMemLevel;    ///< Memory level the deflate context was initialized with
+  Strategy m_deflateStrategy;   ///< Strategy the deflate context was initialized with
+  int m_inflateWindowBits;      ///< Window bits the inflate context was initialized with
+  std::vector<uint8_t> m_scratch; ///< Reused output buffer for the vector Deflate() and packet transforms
+  std::vector<uint8_t> m_inflateChunk; ///< Reused output chunk of InflateStream()
+
+  uint32_t m_flowResyncInterval;  ///< Packets between resynchronization points (0 = only on reset)
+  std::map<FlowKey, FlowState> m_deflateFlows;  ///< Sender-side flow contexts
+  std::map<FlowKey, FlowState> m_inflateFlows;  ///< Receiver-side flow contexts
+
+  uint32_t m_threads;           ///< Worker threads for Deflate() (1 = serial)
+  uint32_t m_blockSize;         ///< Input bytes per block for parallel and seekable compression
+
+  uint32_t m_dictionaryId;      ///< Dictionary Deflate() primes its context with (0 = none)
+  std::map<uint32_t, std::vector<uint8_t>> m_dictionaries;  ///< Registered dictionaries by Adler-32 ID
+
+  double m_skipEntropy;         ///< Entropy (bits per byte) above which input is passed through
+  uint64_t m_compressedCount;   ///< Calls that ran deflate
+  uint64_t m_skippedCount;      ///< Calls whose input was passed through as incompressible
+
+  uint64_t m_cacheSize;         ///< Memory budget of the cache in bytes (0 = disabled)
+  uint64_t m_cacheBytes;        ///< Memory held by the cached entries
+  uint64_t m_cacheHits;         ///< Calls answered from the cache
+  uint64_t m_cacheMisses;       ///< Calls that missed the cache
+  CacheSettings m_cacheSettings;  ///< Attributes the cached entries were produced with
+  std::list<CacheEntry> m_cache;  ///< Cached entries, most recently used first
+  std::unordered_multimap<uint64_t, std::list<CacheEntry>::iterator> m_cacheIndex;  ///< Entries by input hash
+
+  bool m_adaptive;              ///< Whether CompressPacket() picks the level per packet
+  double m_cpuBudget;           ///< Largest CPU time per packet, relative to its transmission time
+  DataRate m_linkRate;          ///< Link rate reported by SetLinkState()
+  uint32_t m_backlogBytes;      ///< Queue backlog reported by SetLinkState()
+  std::vector<LevelCandidate> m_candidates;  ///< Levels and strategies the controller chooses from
+  uint32_t m_adaptivePackets;   ///< Packets compressed in adaptive mode
+  size_t m_nextExplored;        ///< Candidate re-measured at the next exploration slot
+  TracedCallback<int, Strategy> m_levelTrace;  ///< Fired with every adaptive level choice
+
+  uint32_t m_operationDepth;    ///< Public calls in progress, so nested ones are counted once
+  uint64_t m_deflateCalls;      ///< Compression calls
+  uint64_t m_deflateFailures;   ///< Compression calls that failed
+  uint64_t m_deflateBytesIn;    ///< Input bytes of successful compression calls
+  uint64_t m_deflateBytesOut;   ///< Output bytes of successful compression calls
+  Time m_deflateTime;           ///< Wall-clock time spent in compression calls
+  uint64_t m_inflateCalls;      ///< Decompression calls
+  uint64_t m_inflateFailures;   ///< Decompression calls that failed
+  uint64_t m_inflateBytesIn;    ///< Input bytes of successful decompression calls
+  uint64_t m_inflateBytesOut;   ///< Output bytes of successful decompression calls
+  Time m_inflateTime;           ///< Wall-clock time spent in decompression calls
+  TracedCallback<uint64_t, uint64_t, Time> m_deflateTrace;  ///< Fired after every successful compression call
+  TracedCallback<uint64_t, uint64_t, Time> m_inflateTrace;  ///< Fired after every successful decompression call
+  TracedCallback<int> m_deflateFailureTrace;  ///< Fired after every failed compression call
+  TracedCallback<int> m_inflateFailureTrace;  ///< Fired after every failed decompression call
 };
 
 } // namespace ns3
 
 #endif /* ZLIB_INTEG_H */
-
@@ -0,0 +1,151 @@
+#include "zlib-memory-pool.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace ns3 {
+
+// Every block starts with its size, padded so the payload keeps malloc's alignment
+static const size_t BLOCK_HEADER_SIZE = alignof(std::max_align_t);
+
+ZlibMemoryPool* ZlibMemoryPool::Get()
+{
+    // Deliberately leaked: see the declaration
+    static ZlibMemoryPool* pool = new ZlibMemoryPool();
+    return pool;
+}
+
+ZlibMemoryPool::ZlibMemoryPool()
+    : m_maxCachedBytes(1024 * 1024),
+      m_cachedBytes(0),
+      m_currentBytes(0),
+      m_peakBytes(0),
+      m_allocations(0),
+      m_systemAllocations(0)
+{
+}
+
+void* ZlibMemoryPool::Alloc(void* opaque, unsigned int items, unsigned int size)
+{
+    return static_cast<ZlibMemoryPool*>(opaque)->Allocate(static_cast<size_t>(items) * size);
+}
+
+void ZlibMemoryPool::Free(void* opaque, void* address)
+{
+    static_cast<ZlibMemoryPool*>(opaque)->Release(address);
+}
+
+void* ZlibMemoryPool::Allocate(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_allocations++;
+        m_currentBytes += size;
+        m_peakBytes = std::max(m_peakBytes, m_currentBytes);
+
+        auto it = m_idle.find(size);
+        if (it != m_idle.end() && !it->second.empty())
+        {
+            void* block = it->second.back();
+            it->second.pop_back();
+            m_cachedBytes -= size;
+            return static_cast<uint8_t*>(block) + BLOCK_HEADER_SIZE;
+        }
+        m_systemAllocations++;
+    }
+
+    // Worker threads allocate too, so a failure is not logged here: zlib
+    // returns Z_MEM_ERROR and the simulation thread reports it
+    void* block = std::malloc(BLOCK_HEADER_SIZE + size);
+    if (!block)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_currentBytes -= size;
+        return nullptr;
+    }
+    *static_cast<size_t*>(block) = size;
+    return static_cast<uint8_t*>(block) + BLOCK_HEADER_SIZE;
+}
+
+void ZlibMemoryPool::Release(void* address)
+{
+    if (!address)
+    {
+        return;
+    }
+    void* block = static_cast<uint8_t*>(address) - BLOCK_HEADER_SIZE;
+    size_t size = *static_cast<size_t*>(block);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_currentBytes -= size;
+        if (m_cachedBytes + size <= m_maxCachedBytes)
+        {
+            m_idle[size].push_back(block);
+            m_cachedBytes += size;
+            return;
+        }
+    }
+    std::free(block);
+}
+
+void ZlibMemoryPool::Trim()
+{
+    std::map<size_t, std::vector<void*>> idle;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        idle.swap(m_idle);
+        m_cachedBytes = 0;
+    }
+    for (auto& bucket : idle)
+    {
+        for (void* block : bucket.second)
+        {
+            std::free(block);
+        }
+    }
+}
+
+void ZlibMemoryPool::SetMaxCachedBytes(uint64_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_maxCachedBytes = bytes;
+        if (m_cachedBytes <= m_maxCachedBytes)
+        {
+            return;
+        }
+    }
+    Trim();
+}
+
+uint64_t ZlibMemoryPool::GetCurrentBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_currentBytes;
+}
+
+uint64_t ZlibMemoryPool::GetPeakBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peakBytes;
+}
+
+uint64_t ZlibMemoryPool::GetCachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cachedBytes;
+}
+
+uint64_t ZlibMemoryPool::GetAllocations() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_allocations;
+}
+
+uint64_t ZlibMemoryPool::GetSystemAllocations() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_systemAllocations;
+}
+
+} // namespace ns3
@@ -0,0 +1,127 @@
+#ifndef ZLIB_MEMORY_POOL_H
+#define ZLIB_MEMORY_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief Process-wide pool recycling the memory blocks of zlib streams.
+ *
+ * A zlib stream allocates a handful of blocks (state, window, hash chains,
+ * pending buffer) whose sizes depend only on the stream parameters, so the
+ * streams of thousands of compressors with the same attributes keep asking
+ * for the same few sizes. Freed blocks are kept on a free list per size and
+ * handed out again, up to a cap on the bytes held idle; beyond it they go
+ * back to the system.
+ *
+ * Alloc() and Free() match zlib's zalloc and zfree signatures and take the
+ * pool as opaque pointer. The pool is thread-safe, since parallel Deflate()
+ * workers allocate from it concurrently.
+ */
+class ZlibMemoryPool
+{
+public:
+  /**
+   * @brief Gets the pool shared by all ZlibInteg objects.
+   *
+   * The pool is never destroyed, so streams released during static
+   * destruction can still return their blocks.
+   */
+  static ZlibMemoryPool* Get();
+
+  /**
+   * @brief zalloc entry point.
+   *
+   * @param opaque The pool.
+   * @param items Number of items.
+   * @param size Size of an item.
+   * @return The block, or nullptr if the system is out of memory
+   */
+  static void* Alloc(void* opaque, unsigned int items, unsigned int size);
+
+  /**
+   * @brief zfree entry point.
+   *
+   * @param opaque The pool.
+   * @param address A block returned by Alloc().
+   */
+  static void Free(void* opaque, void* address);
+
+  /**
+   * @brief Hands out a block, reusing an idle one of the same size if any.
+   *
+   * @param size Block size in bytes.
+   * @return The block, or nullptr if the system is out of memory
+   */
+  void* Allocate(size_t size);
+
+  /**
+   * @brief Takes a block back.
+   *
+   * @param block A block returned by Allocate().
+   */
+  void Release(void* block);
+
+  /**
+   * @brief Returns all idle blocks to the system.
+   */
+  void Trim();
+
+  /**
+   * @brief Sets the most bytes kept in idle blocks (default 1 MB).
+   *
+   * The default holds the blocks of about three deflate and inflate context
+   * pairs at the default WindowBits and MemLevel, enough for objects created
+   * and destroyed one after the other. Parallel Deflate() and the batch API
+   * give every worker thread its own context for the duration of a call, so
+   * with many Threads a larger cap saves going back to the system on every
+   * call, at the cost of that much more idle memory.
+   */
+  void SetMaxCachedBytes(uint64_t bytes);
+
+  /**
+   * @brief Bytes currently handed out to zlib streams.
+   */
+  uint64_t GetCurrentBytes() const;
+
+  /**
+   * @brief Highest value GetCurrentBytes() has reached.
+   */
+  uint64_t GetPeakBytes() const;
+
+  /**
+   * @brief Bytes held in idle blocks.
+   */
+  uint64_t GetCachedBytes() const;
+
+  /**
+   * @brief Number of blocks handed out so far.
+   */
+  uint64_t GetAllocations() const;
+
+  /**
+   * @brief Number of blocks that had to be obtained from the system.
+   */
+  uint64_t GetSystemAllocations() const;
+
+private:
+  ZlibMemoryPool();
+
+  mutable std::mutex m_mutex;                       ///< Guards everything below
+  std::map<size_t, std::vector<void*>> m_idle;      ///< Idle blocks by size
+  uint64_t m_maxCachedBytes;                        ///< Cap on bytes held in idle blocks
+  uint64_t m_cachedBytes;                           ///< Bytes held in idle blocks
+  uint64_t m_currentBytes;                          ///< Bytes handed out
+  uint64_t m_peakBytes;                             ///< Highest m_currentBytes
+  uint64_t m_allocations;                           ///< Blocks handed out
+  uint64_t m_systemAllocations;                     ///< Blocks obtained from the system
+};
+
+} // namespace ns3
+
+#endif /* ZLIB_MEMORY_POOL_H */
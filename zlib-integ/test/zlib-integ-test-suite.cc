@@ -0,0 +1,2750 @@
+// Include header files from the module to test
+#include "ns3/compressed-pcap-writer.h"
+#include "ns3/compression-backend.h"
+#include "ns3/compression-cost-model.h"
+#include "ns3/compression-queue-disc.h"
+#include "ns3/compression-receive-hook.h"
+#include "ns3/zlib-header.h"
+#include "ns3/zlib-integ-helper.h"
+#include "ns3/zlib-integ.h"
+#include "ns3/zlib-memory-pool.h"
+
+// An essential include is test.h
+#include "ns3/test.h"
+#include "ns3/boolean.h"
+#include "ns3/callback.h"
+#include "ns3/csma-helper.h"
+#include "ns3/data-rate.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/integer.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/nstime.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/packet-sink.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/udp-echo-helper.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+// Do not put your test classes in namespace ns3. You may find it useful
+// to use the using directive to access the ns3 namespace directly
+using namespace ns3;
+
+// Add a doxygen group for tests.
+/**
+ * @defgroup zlib-integ-tests Tests for zlib-integ
+ * @ingroup zlib-integ
+ * @ingroup tests
+ */
+
+/**
+ * @ingroup zlib-integ-tests
+ * Generates compressible text, the same for every call with the same size.
+ *
+ * @param size Number of bytes.
+ * @return The text
+ */
+static std::vector<uint8_t>
+MakeTextPayload(size_t size)
+{
+    static const char* words[] = {"packet", "queue", "link", "node", "delay", "rate", "the", "of"};
+    std::vector<uint8_t> data;
+    data.reserve(size + 8);
+    for (size_t i = 0; data.size() < size; i++)
+    {
+        const char* word = words[(i * 7 + i / 3) % 8];
+        data.insert(data.end(), word, word + std::strlen(word));
+        data.push_back(i % 11 == 0 ? '\n' : ' ');
+    }
+    data.resize(size);
+    return data;
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Generates incompressible bytes from a seed.
+ *
+ * @param size Number of bytes.
+ * @param seed Seed of the generator.
+ * @return The bytes
+ */
+static std::vector<uint8_t>
+MakeRandomPayload(size_t size, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (uint8_t& byte : data)
+    {
+        byte = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the persistent deflate and inflate contexts
+ */
+class ZlibIntegContextReuseTestCase : public TestCase
+{
+public:
+    ZlibIntegContextReuseTestCase();
+    ~ZlibIntegContextReuseTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegContextReuseTestCase::ZlibIntegContextReuseTestCase()
+    : TestCase("ZlibInteg reuses its contexts across calls and attribute changes")
+{
+}
+
+ZlibIntegContextReuseTestCase::~ZlibIntegContextReuseTestCase()
+{
+}
+
+void
+ZlibIntegContextReuseTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+
+    // Many calls of different sizes on the same contexts
+    for (size_t size = 100; size < 20000; size = size * 3 / 2)
+    {
+        std::vector<uint8_t> input = MakeTextPayload(size);
+        std::vector<uint8_t> compressed = zlib->Deflate(input);
+        NS_TEST_ASSERT_MSG_EQ(compressed.empty(), false, "Deflate of " << size << " bytes failed");
+        NS_TEST_ASSERT_MSG_LT(compressed.size(),
+                              size,
+                              "Text of " << size << " bytes did not shrink");
+        NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(compressed) == input),
+                              true,
+                              "Round trip of " << size << " bytes failed");
+    }
+
+    // A new level reuses the deflate context, a new window re-creates both
+    std::vector<uint8_t> input = MakeTextPayload(8000);
+    zlib->SetAttribute("Level", IntegerValue(1));
+    std::vector<uint8_t> fast = zlib->Deflate(input);
+    zlib->SetAttribute("Level", IntegerValue(9));
+    std::vector<uint8_t> strong = zlib->Deflate(input);
+    NS_TEST_ASSERT_MSG_LT_OR_EQ(strong.size(),
+                                fast.size(),
+                                "Level 9 should not be larger than level 1");
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(fast) == input), true, "Level 1 output does not inflate");
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(strong) == input),
+                          true,
+                          "Level 9 output does not inflate");
+
+    zlib->SetAttribute("WindowBits", UintegerValue(9));
+    zlib->SetAttribute("MemLevel", UintegerValue(1));
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(zlib->Deflate(input)) == input),
+                          true,
+                          "Round trip with a small window failed");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for failures on the persistent contexts
+ */
+class ZlibIntegContextErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegContextErrorTestCase();
+    ~ZlibIntegContextErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegContextErrorTestCase::ZlibIntegContextErrorTestCase()
+    : TestCase("ZlibInteg contexts recover from failed calls")
+{
+}
+
+ZlibIntegContextErrorTestCase::~ZlibIntegContextErrorTestCase()
+{
+}
+
+void
+ZlibIntegContextErrorTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    std::vector<uint8_t> input = MakeTextPayload(5000);
+    std::vector<uint8_t> compressed = zlib->Deflate(input);
+
+    NS_TEST_ASSERT_MSG_EQ(zlib->Deflate(std::vector<uint8_t>()).empty(),
+                          true,
+                          "Empty input should fail");
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(std::vector<uint8_t>()).empty(),
+                          true,
+                          "Empty input should fail");
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(MakeRandomPayload(300, 1)).empty(),
+                          true,
+                          "Garbage should not inflate");
+
+    std::vector<uint8_t> truncated(compressed.begin(), compressed.begin() + compressed.size() / 2);
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(truncated).empty(),
+                          true,
+                          "A truncated stream should not inflate");
+
+    std::vector<uint8_t> corrupted = compressed;
+    corrupted[corrupted.size() - 1] ^= 0xff;
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(corrupted).empty(),
+                          true,
+                          "A bad checksum should not inflate");
+
+    // A failed call leaves the contexts usable
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(compressed) == input),
+                          true,
+                          "Inflate failed after errors");
+    NS_TEST_ASSERT_MSG_EQ((zlib->Deflate(input) == compressed),
+                          true,
+                          "Deflate changed after errors");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the size-prefixed framing
+ */
+class ZlibIntegSizePrefixTestCase : public TestCase
+{
+public:
+    ZlibIntegSizePrefixTestCase();
+    ~ZlibIntegSizePrefixTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegSizePrefixTestCase::ZlibIntegSizePrefixTestCase()
+    : TestCase("ZlibInteg size prefix round trip and limits")
+{
+}
+
+ZlibIntegSizePrefixTestCase::~ZlibIntegSizePrefixTestCase()
+{
+}
+
+void
+ZlibIntegSizePrefixTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    std::vector<uint8_t> input = MakeTextPayload(70000);
+    std::vector<uint8_t> plain = zlib->Deflate(input);
+
+    // Without the prefix there is nothing to read
+    NS_TEST_ASSERT_MSG_LT(zlib->GetInflatedSize(plain.data(), plain.size()),
+                          0,
+                          "No prefix was written");
+
+    zlib->SetAttribute("SizePrefix", BooleanValue(true));
+    std::vector<uint8_t> prefixed = zlib->Deflate(input);
+    NS_TEST_ASSERT_MSG_EQ(prefixed.size(), plain.size() + 3, "70000 needs a three-byte varint");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetInflatedSize(prefixed.data(), prefixed.size()),
+                          static_cast<int64_t>(input.size()),
+                          "Wrong size in the prefix");
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(prefixed) == input),
+                          true,
+                          "Round trip with a size prefix failed");
+
+    // A truncated varint or a stream without its prefix is refused
+    NS_TEST_ASSERT_MSG_LT(zlib->GetInflatedSize(prefixed.data(), 2),
+                          0,
+                          "A truncated prefix was accepted");
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(plain).empty(),
+                          true,
+                          "A stream without its prefix was accepted");
+
+    // Only the minimal encoding is read, so a padded prefix cannot shift the stream
+    std::vector<uint8_t> padded = prefixed;
+    padded[2] |= 0x80;
+    padded.insert(padded.begin() + 3, 0x00);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetInflatedSize(padded.data(), padded.size()),
+                          Z_DATA_ERROR,
+                          "A padded prefix was accepted");
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(padded).empty(), true, "A padded prefix was accepted");
+    std::vector<uint8_t> overflowing(9, 0xff);
+    overflowing.push_back(0x02);
+    overflowing.insert(overflowing.end(), prefixed.begin() + 3, prefixed.end());
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetInflatedSize(overflowing.data(), overflowing.size()),
+                          Z_DATA_ERROR,
+                          "A prefix over 64 bits was accepted");
+
+    // A prefix declaring more than MaxInflateSize is refused before inflating
+    zlib->SetAttribute("MaxInflateSize", UintegerValue(input.size() - 1));
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetInflatedSize(prefixed.data(), prefixed.size()),
+                          Z_BUF_ERROR,
+                          "MaxInflateSize was not enforced");
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(prefixed).empty(), true, "MaxInflateSize was not enforced");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the caller-provided buffer API
+ */
+class ZlibIntegBufferApiTestCase : public TestCase
+{
+public:
+    ZlibIntegBufferApiTestCase();
+    ~ZlibIntegBufferApiTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegBufferApiTestCase::ZlibIntegBufferApiTestCase()
+    : TestCase("ZlibInteg Deflate and Inflate into caller-owned buffers")
+{
+}
+
+ZlibIntegBufferApiTestCase::~ZlibIntegBufferApiTestCase()
+{
+}
+
+void
+ZlibIntegBufferApiTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+
+    // The bound holds even for incompressible input
+    for (const std::vector<uint8_t>& input : {MakeTextPayload(3000), MakeRandomPayload(3000, 2)})
+    {
+        std::vector<uint8_t> compressed(zlib->GetDeflateBound(input.size()));
+        int64_t compressedSize =
+            zlib->Deflate(input.data(), input.size(), compressed.data(), compressed.size());
+        NS_TEST_ASSERT_MSG_GT(compressedSize, 0, "Deflate into a bound-sized buffer failed");
+
+        std::vector<uint8_t> output(input.size());
+        int64_t outputSize =
+            zlib->Inflate(compressed.data(), compressedSize, output.data(), output.size());
+        NS_TEST_ASSERT_MSG_EQ(outputSize,
+                              static_cast<int64_t>(input.size()),
+                              "Wrong inflated size");
+        NS_TEST_ASSERT_MSG_EQ((output == input), true, "Round trip through caller buffers failed");
+
+        // The vector API produces the same stream
+        std::vector<uint8_t> viaVector = zlib->Deflate(input);
+        NS_TEST_ASSERT_MSG_EQ(viaVector.size(),
+                              static_cast<size_t>(compressedSize),
+                              "Vector API differs");
+    }
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the caller-provided buffer API with too small buffers
+ */
+class ZlibIntegBufferApiErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegBufferApiErrorTestCase();
+    ~ZlibIntegBufferApiErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegBufferApiErrorTestCase::ZlibIntegBufferApiErrorTestCase()
+    : TestCase("ZlibInteg caller-owned buffers that are too small")
+{
+}
+
+ZlibIntegBufferApiErrorTestCase::~ZlibIntegBufferApiErrorTestCase()
+{
+}
+
+void
+ZlibIntegBufferApiErrorTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    std::vector<uint8_t> input = MakeTextPayload(3000);
+    std::vector<uint8_t> compressed = zlib->Deflate(input);
+
+    std::vector<uint8_t> small(compressed.size() / 2);
+    NS_TEST_ASSERT_MSG_EQ(zlib->Deflate(input.data(), input.size(), small.data(), small.size()),
+                          Z_BUF_ERROR,
+                          "Deflate into a small buffer should fail");
+
+    std::vector<uint8_t> output(input.size() - 1);
+    NS_TEST_ASSERT_MSG_EQ(
+        zlib->Inflate(compressed.data(), compressed.size(), output.data(), output.size()),
+        Z_BUF_ERROR,
+        "Inflate into a small buffer should fail");
+    NS_TEST_ASSERT_MSG_LT(
+        zlib->Inflate(compressed.data(), compressed.size() - 4, output.data(), output.size()),
+        0,
+        "Inflate of a truncated stream should fail");
+
+    // Both contexts still work
+    output.resize(input.size());
+    int64_t outputSize =
+        zlib->Inflate(compressed.data(), compressed.size(), output.data(), output.size());
+    NS_TEST_ASSERT_MSG_EQ(outputSize,
+                          static_cast<int64_t>(input.size()),
+                          "Inflate failed after an error");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Copies the content of a packet.
+ *
+ * @param packet The packet.
+ * @return Its bytes
+ */
+static std::vector<uint8_t>
+GetPacketBytes(Ptr<const Packet> packet)
+{
+    std::vector<uint8_t> data(packet->GetSize());
+    packet->CopyData(data.data(), data.size());
+    return data;
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the in-place packet transform
+ */
+class ZlibIntegPacketTestCase : public TestCase
+{
+public:
+    ZlibIntegPacketTestCase();
+    ~ZlibIntegPacketTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegPacketTestCase::ZlibIntegPacketTestCase()
+    : TestCase("ZlibInteg CompressPacket and DecompressPacket")
+{
+}
+
+ZlibIntegPacketTestCase::~ZlibIntegPacketTestCase()
+{
+}
+
+void
+ZlibIntegPacketTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+
+    std::vector<uint8_t> text = MakeTextPayload(1400);
+    Ptr<Packet> packet = Create<Packet>(text.data(), text.size());
+    NS_TEST_ASSERT_MSG_EQ(zlib->CompressPacket(packet), true, "Text should be compressed");
+    NS_TEST_ASSERT_MSG_LT(packet->GetSize(), text.size(), "Compressed packet did not shrink");
+
+    ZlibHeader header;
+    packet->PeekHeader(header);
+    NS_TEST_ASSERT_MSG_EQ(header.IsCompressed(), true, "Header should mark the payload compressed");
+    NS_TEST_ASSERT_MSG_EQ(header.GetOriginalSize(),
+                          text.size(),
+                          "Header should record the original size");
+
+    NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(packet), true, "DecompressPacket failed");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == text), true, "Packet round trip failed");
+
+    // Incompressible content is kept, behind a one-byte header
+    std::vector<uint8_t> random = MakeRandomPayload(1400, 4);
+    packet = Create<Packet>(random.data(), random.size());
+    NS_TEST_ASSERT_MSG_EQ(zlib->CompressPacket(packet),
+                          false,
+                          "Random bytes should not be compressed");
+    NS_TEST_ASSERT_MSG_EQ(packet->GetSize(),
+                          random.size() + 1,
+                          "Uncompressed header should be one byte");
+    NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(packet), true, "DecompressPacket failed");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == random),
+                          true,
+                          "Uncompressed round trip failed");
+
+    // A ratio limit below what text achieves keeps the original content
+    packet = Create<Packet>(text.data(), text.size());
+    NS_TEST_ASSERT_MSG_EQ(zlib->CompressPacket(packet, 0.01), false, "maxRatio was not honoured");
+    NS_TEST_ASSERT_MSG_EQ(packet->GetSize(),
+                          text.size() + 1,
+                          "Uncompressed header should be one byte");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for packets that cannot be decompressed
+ */
+class ZlibIntegPacketErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegPacketErrorTestCase();
+    ~ZlibIntegPacketErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegPacketErrorTestCase::ZlibIntegPacketErrorTestCase()
+    : TestCase("ZlibInteg DecompressPacket leaves bad packets unchanged")
+{
+}
+
+ZlibIntegPacketErrorTestCase::~ZlibIntegPacketErrorTestCase()
+{
+}
+
+void
+ZlibIntegPacketErrorTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+
+    std::vector<uint8_t> text = MakeTextPayload(1400);
+    Ptr<Packet> packet = Create<Packet>(text.data(), text.size());
+    zlib->CompressPacket(packet);
+
+    // Flip a byte of the compressed payload, after the five-byte header
+    std::vector<uint8_t> corrupted = GetPacketBytes(packet);
+    corrupted[corrupted.size() / 2] ^= 0x55;
+    packet = Create<Packet>(corrupted.data(), corrupted.size());
+    NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(packet),
+                          false,
+                          "A corrupted payload was accepted");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == corrupted),
+                          true,
+                          "A failed packet was modified");
+
+    Ptr<Packet> empty = Create<Packet>();
+    NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(empty),
+                          false,
+                          "A packet without a header was accepted");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for link-level compression of UDP traffic over a CSMA link
+ */
+class ZlibIntegLinkCompressionTestCase : public TestCase
+{
+public:
+    ZlibIntegLinkCompressionTestCase();
+    ~ZlibIntegLinkCompressionTestCase() override;
+
+private:
+    void DoRun() override;
+
+    /**
+     * Records a packet compressed by the sender's queue disc.
+     *
+     * @param originalSize IPv4 payload size before compression.
+     * @param wireSize IPv4 payload size after compression.
+     */
+    void Compressed(uint32_t originalSize, uint32_t wireSize);
+
+    /**
+     * Records a packet dropped by the receive hook.
+     *
+     * @param packet The packet.
+     */
+    void Dropped(Ptr<const Packet> packet);
+
+    /**
+     * Sends an IPv4 packet with a ZlibHeader but an invalid payload.
+     *
+     * @param device The sending device.
+     * @param source The source address.
+     * @param destination The destination address.
+     * @param peer The receiving device.
+     */
+    void SendCorrupted(Ptr<NetDevice> device,
+                       Ipv4Address source,
+                       Ipv4Address destination,
+                       Ptr<NetDevice> peer);
+
+    uint64_t m_originalBytes; //!< IPv4 payload bytes before compression
+    uint64_t m_wireBytes;     //!< IPv4 payload bytes after compression
+    uint32_t m_drops;         //!< Packets dropped by the receive hook
+};
+
+ZlibIntegLinkCompressionTestCase::ZlibIntegLinkCompressionTestCase()
+    : TestCase("CompressionQueueDisc and CompressionReceiveHook carry UDP traffic over a link"),
+      m_originalBytes(0),
+      m_wireBytes(0),
+      m_drops(0)
+{
+}
+
+ZlibIntegLinkCompressionTestCase::~ZlibIntegLinkCompressionTestCase()
+{
+}
+
+void
+ZlibIntegLinkCompressionTestCase::Compressed(uint32_t originalSize, uint32_t wireSize)
+{
+    m_originalBytes += originalSize;
+    m_wireBytes += wireSize;
+}
+
+void
+ZlibIntegLinkCompressionTestCase::Dropped(Ptr<const Packet> /* packet */)
+{
+    m_drops++;
+}
+
+void
+ZlibIntegLinkCompressionTestCase::SendCorrupted(Ptr<NetDevice> device,
+                                                Ipv4Address source,
+                                                Ipv4Address destination,
+                                                Ptr<NetDevice> peer)
+{
+    std::vector<uint8_t> garbage = MakeRandomPayload(200, 5);
+    Ptr<Packet> packet = Create<Packet>(garbage.data(), garbage.size());
+
+    ZlibHeader zlibHeader;
+    zlibHeader.SetFlags(ZlibHeader::COMPRESSED);
+    zlibHeader.SetOriginalSize(1000);
+    packet->AddHeader(zlibHeader);
+
+    Ipv4Header ipHeader;
+    ipHeader.SetSource(source);
+    ipHeader.SetDestination(destination);
+    ipHeader.SetProtocol(17);
+    ipHeader.SetTtl(64);
+    ipHeader.SetPayloadSize(packet->GetSize());
+    packet->AddHeader(ipHeader);
+
+    // Straight to the device, past the sender's queue disc
+    device->Send(packet, peer->GetAddress(), Ipv4L3Protocol::PROT_NUMBER);
+}
+
+void
+ZlibIntegLinkCompressionTestCase::DoRun()
+{
+    NodeContainer nodes;
+    nodes.Create(2);
+
+    InternetStackHelper internet;
+    internet.Install(nodes);
+
+    CsmaHelper csma;
+    csma.SetChannelAttribute("DataRate", DataRateValue(DataRate(5000000)));
+    csma.SetChannelAttribute("Delay", TimeValue(MilliSeconds(2)));
+    NetDeviceContainer devices = csma.Install(nodes);
+
+    QueueDiscContainer queueDiscs = ZlibIntegHelper::InstallLinkCompression(devices);
+    queueDiscs.Get(0)->TraceConnectWithoutContext(
+        "Compress",
+        MakeCallback(&ZlibIntegLinkCompressionTestCase::Compressed, this));
+    Ptr<CompressionReceiveHook> hook = devices.Get(1)->GetObject<CompressionReceiveHook>();
+    NS_TEST_ASSERT_MSG_NE(hook, nullptr, "No receive hook on the device");
+    hook->TraceConnectWithoutContext("Drop",
+                                     MakeCallback(&ZlibIntegLinkCompressionTestCase::Dropped, this));
+
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = ipv4.Assign(devices);
+
+    uint16_t port = 9;
+    PacketSinkHelper sinkHelper("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
+    ApplicationContainer sinkApps = sinkHelper.Install(nodes.Get(1));
+    sinkApps.Start(Seconds(0.0));
+    sinkApps.Stop(Seconds(3.0));
+
+    // Large text payloads are compressed, payloads below MinPayloadSize only get the header
+    std::vector<uint8_t> text = MakeTextPayload(1000);
+    UdpEchoClientHelper client(interfaces.GetAddress(1), port);
+    client.SetAttribute("MaxPackets", UintegerValue(20));
+    client.SetAttribute("Interval", TimeValue(MilliSeconds(10)));
+    client.SetAttribute("PacketSize", UintegerValue(text.size()));
+    ApplicationContainer clientApps = client.Install(nodes.Get(0));
+    client.SetFill(clientApps.Get(0), text.data(), text.size(), text.size());
+
+    client.SetAttribute("MaxPackets", UintegerValue(5));
+    client.SetAttribute("PacketSize", UintegerValue(20));
+    clientApps.Add(client.Install(nodes.Get(0)));
+    clientApps.Start(Seconds(1.0));
+    clientApps.Stop(Seconds(2.0));
+
+    Simulator::Schedule(Seconds(2.5),
+                        &ZlibIntegLinkCompressionTestCase::SendCorrupted,
+                        this,
+                        devices.Get(0),
+                        interfaces.GetAddress(0),
+                        interfaces.GetAddress(1),
+                        devices.Get(1));
+
+    Simulator::Stop(Seconds(3.0));
+    Simulator::Run();
+
+    uint64_t received = DynamicCast<PacketSink>(sinkApps.Get(0))->GetTotalRx();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(received,
+                          20 * text.size() + 5 * 20,
+                          "The sink did not get every byte back");
+    NS_TEST_ASSERT_MSG_LT(m_wireBytes, m_originalBytes, "The link carried no fewer bytes");
+    NS_TEST_ASSERT_MSG_EQ(m_drops, 1, "The corrupted packet was not dropped by the hook");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for per-flow compression with shared history
+ */
+class ZlibIntegFlowTestCase : public TestCase
+{
+public:
+    ZlibIntegFlowTestCase();
+    ~ZlibIntegFlowTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegFlowTestCase::ZlibIntegFlowTestCase()
+    : TestCase("ZlibInteg DeflateFlow and InflateFlow share history across packets")
+{
+}
+
+ZlibIntegFlowTestCase::~ZlibIntegFlowTestCase()
+{
+}
+
+void
+ZlibIntegFlowTestCase::DoRun()
+{
+    Ptr<ZlibInteg> sender = CreateObject<ZlibInteg>();
+    Ptr<ZlibInteg> receiver = CreateObject<ZlibInteg>();
+    ZlibInteg::FlowKey flow = {Ipv4Address("10.1.1.1"), Ipv4Address("10.1.1.2"), 9};
+    ZlibInteg::FlowKey other = {Ipv4Address("10.1.1.1"), Ipv4Address("10.1.1.3"), 9};
+
+    std::vector<uint8_t> payload = MakeRandomPayload(500, 6);
+    std::vector<uint8_t> first = sender->DeflateFlow(flow, payload);
+    std::vector<uint8_t> second = sender->DeflateFlow(flow, payload);
+    NS_TEST_ASSERT_MSG_EQ(first.empty(), false, "DeflateFlow failed");
+    NS_TEST_ASSERT_MSG_LT(second.size(),
+                          first.size() / 4,
+                          "A repeated payload should refer to the history");
+    NS_TEST_ASSERT_MSG_EQ((receiver->InflateFlow(flow, first) == payload),
+                          true,
+                          "First packet did not inflate");
+    NS_TEST_ASSERT_MSG_EQ((receiver->InflateFlow(flow, second) == payload),
+                          true,
+                          "Second packet did not inflate");
+
+    // Another flow has its own history
+    std::vector<uint8_t> text = MakeTextPayload(800);
+    std::vector<uint8_t> otherPacket = sender->DeflateFlow(other, text);
+    NS_TEST_ASSERT_MSG_EQ((receiver->InflateFlow(other, otherPacket) == text),
+                          true,
+                          "Second flow did not inflate");
+    NS_TEST_ASSERT_MSG_EQ((receiver->InflateFlow(flow, sender->DeflateFlow(flow, text)) == text),
+                          true,
+                          "First flow did not inflate after the second one");
+    receiver->RemoveFlow(other);
+    sender->RemoveFlow(other);
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for lost and corrupted packets of a flow
+ */
+class ZlibIntegFlowErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegFlowErrorTestCase();
+    ~ZlibIntegFlowErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegFlowErrorTestCase::ZlibIntegFlowErrorTestCase()
+    : TestCase("ZlibInteg flows refuse packets after a loss until they resynchronize")
+{
+}
+
+ZlibIntegFlowErrorTestCase::~ZlibIntegFlowErrorTestCase()
+{
+}
+
+void
+ZlibIntegFlowErrorTestCase::DoRun()
+{
+    Ptr<ZlibInteg> sender = CreateObject<ZlibInteg>();
+    sender->SetAttribute("FlowResyncInterval", UintegerValue(0));
+    Ptr<ZlibInteg> receiver = CreateObject<ZlibInteg>();
+    ZlibInteg::FlowKey flow = {Ipv4Address("10.1.1.1"), Ipv4Address("10.1.1.2"), 9};
+
+    std::vector<uint8_t> payload = MakeTextPayload(600);
+    NS_TEST_ASSERT_MSG_EQ((receiver->InflateFlow(flow, sender->DeflateFlow(flow, payload)) == payload),
+                          true,
+                          "First packet did not inflate");
+
+    // Lose a packet: the following ones are refused
+    sender->DeflateFlow(flow, payload);
+    for (int i = 0; i < 3; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(receiver->InflateFlow(flow, sender->DeflateFlow(flow, payload)).empty(),
+                              true,
+                              "A packet after a gap was accepted");
+    }
+
+    // The sender restarts the history and the receiver picks it up
+    sender->ResetFlow(flow);
+    std::vector<uint8_t> resync = sender->DeflateFlow(flow, payload);
+    NS_TEST_ASSERT_MSG_EQ((receiver->InflateFlow(flow, resync) == payload),
+                          true,
+                          "Resynchronization failed");
+
+    std::vector<uint8_t> next = sender->DeflateFlow(flow, payload);
+    std::vector<uint8_t> truncated(next.begin(), next.begin() + 2);
+    NS_TEST_ASSERT_MSG_EQ(receiver->InflateFlow(flow, truncated).empty(),
+                          true,
+                          "A truncated header was accepted");
+    NS_TEST_ASSERT_MSG_EQ(receiver->InflateFlow(flow, std::vector<uint8_t>()).empty(),
+                          true,
+                          "An empty packet was accepted");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Generates a small telemetry-like record.
+ *
+ * @param index Varies the values in the record.
+ * @return The record
+ */
+static std::vector<uint8_t>
+MakeRecord(uint32_t index)
+{
+    std::string record = "{\"node\":" + std::to_string(index % 17) +
+                         ",\"sequence\":" + std::to_string(index) +
+                         ",\"temperature\":" + std::to_string(20 + index % 7) +
+                         ",\"humidity\":" + std::to_string(40 + index % 13) +
+                         ",\"status\":\"OK\",\"firmware\":\"v2.4.1\",\"uptime\":" +
+                         std::to_string(index * 37) + "}";
+    return std::vector<uint8_t>(record.begin(), record.end());
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for preset dictionaries
+ */
+class ZlibIntegDictionaryTestCase : public TestCase
+{
+public:
+    ZlibIntegDictionaryTestCase();
+    ~ZlibIntegDictionaryTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegDictionaryTestCase::ZlibIntegDictionaryTestCase()
+    : TestCase("ZlibInteg trained preset dictionaries")
+{
+}
+
+ZlibIntegDictionaryTestCase::~ZlibIntegDictionaryTestCase()
+{
+}
+
+void
+ZlibIntegDictionaryTestCase::DoRun()
+{
+    std::vector<std::vector<uint8_t>> samples;
+    for (uint32_t i = 0; i < 50; i++)
+    {
+        samples.push_back(MakeRecord(i));
+    }
+    std::vector<uint8_t> dictionary = ZlibInteg::TrainDictionary(samples, 1024);
+    NS_TEST_ASSERT_MSG_EQ(dictionary.empty(), false, "No dictionary was trained");
+    NS_TEST_ASSERT_MSG_LT_OR_EQ(dictionary.size(), 1024, "The dictionary exceeds maxSize");
+
+    Ptr<ZlibInteg> sender = CreateObject<ZlibInteg>();
+    Ptr<ZlibInteg> receiver = CreateObject<ZlibInteg>();
+    std::vector<uint8_t> record = MakeRecord(1000);
+    std::vector<uint8_t> withoutDictionary = sender->Deflate(record);
+
+    uint32_t id = sender->AddDictionary(dictionary);
+    NS_TEST_ASSERT_MSG_NE(id, 0, "The dictionary was not registered");
+    NS_TEST_ASSERT_MSG_EQ(receiver->AddDictionary(dictionary),
+                          id,
+                          "Both ends should compute the same ID");
+    sender->SetAttribute("DictionaryId", UintegerValue(id));
+
+    std::vector<uint8_t> withDictionary = sender->Deflate(record);
+    NS_TEST_ASSERT_MSG_EQ(withDictionary.empty(), false, "Deflate with a dictionary failed");
+    NS_TEST_ASSERT_MSG_LT(withDictionary.size(),
+                          withoutDictionary.size(),
+                          "The dictionary did not help");
+    NS_TEST_ASSERT_MSG_EQ((receiver->Inflate(withDictionary) == record),
+                          true,
+                          "Round trip with a dictionary failed");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for missing preset dictionaries
+ */
+class ZlibIntegDictionaryErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegDictionaryErrorTestCase();
+    ~ZlibIntegDictionaryErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegDictionaryErrorTestCase::ZlibIntegDictionaryErrorTestCase()
+    : TestCase("ZlibInteg streams whose dictionary is missing fail")
+{
+}
+
+ZlibIntegDictionaryErrorTestCase::~ZlibIntegDictionaryErrorTestCase()
+{
+}
+
+void
+ZlibIntegDictionaryErrorTestCase::DoRun()
+{
+    Ptr<ZlibInteg> sender = CreateObject<ZlibInteg>();
+    Ptr<ZlibInteg> receiver = CreateObject<ZlibInteg>();
+    std::vector<uint8_t> dictionary = MakeRecord(7);
+    std::vector<uint8_t> record = MakeRecord(8);
+
+    NS_TEST_ASSERT_MSG_EQ(sender->AddDictionary(std::vector<uint8_t>()),
+                          0,
+                          "An empty dictionary was registered");
+
+    // An unregistered DictionaryId makes Deflate fail
+    sender->SetAttribute("DictionaryId", UintegerValue(12345));
+    NS_TEST_ASSERT_MSG_EQ(sender->Deflate(record).empty(),
+                          true,
+                          "Deflate with an unknown dictionary succeeded");
+
+    uint32_t id = sender->AddDictionary(dictionary);
+    sender->SetAttribute("DictionaryId", UintegerValue(id));
+    std::vector<uint8_t> compressed = sender->Deflate(record);
+    NS_TEST_ASSERT_MSG_EQ(compressed.empty(), false, "Deflate with a dictionary failed");
+    NS_TEST_ASSERT_MSG_EQ(receiver->Inflate(compressed).empty(),
+                          true,
+                          "Inflate without the dictionary succeeded");
+
+    receiver->AddDictionary(dictionary);
+    NS_TEST_ASSERT_MSG_EQ((receiver->Inflate(compressed) == record),
+                          true,
+                          "Inflate with the dictionary failed");
+    receiver->RemoveDictionary(id);
+    NS_TEST_ASSERT_MSG_EQ(receiver->Inflate(compressed).empty(),
+                          true,
+                          "A removed dictionary was still used");
+
+    // Samples with nothing in common give no dictionary
+    std::vector<std::vector<uint8_t>> samples = {MakeRandomPayload(300, 7), MakeRandomPayload(300, 8)};
+    NS_TEST_ASSERT_MSG_EQ(ZlibInteg::TrainDictionary(samples).empty(),
+                          true,
+                          "Unrelated samples gave a dictionary");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for block-parallel Deflate
+ */
+class ZlibIntegParallelTestCase : public TestCase
+{
+public:
+    ZlibIntegParallelTestCase();
+    ~ZlibIntegParallelTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegParallelTestCase::ZlibIntegParallelTestCase()
+    : TestCase("ZlibInteg parallel Deflate produces standard zlib streams")
+{
+}
+
+ZlibIntegParallelTestCase::~ZlibIntegParallelTestCase()
+{
+}
+
+void
+ZlibIntegParallelTestCase::DoRun()
+{
+    Ptr<ZlibInteg> parallel = CreateObject<ZlibInteg>();
+    parallel->SetAttribute("Threads", UintegerValue(4));
+    parallel->SetAttribute("BlockSize", UintegerValue(4096));
+    Ptr<ZlibInteg> serial = CreateObject<ZlibInteg>();
+
+    // Block multiples, a partial last block, and a mix of text and random blocks
+    std::vector<uint8_t> mixed = MakeTextPayload(30000);
+    std::vector<uint8_t> random = MakeRandomPayload(10000, 9);
+    mixed.insert(mixed.begin() + 12000, random.begin(), random.end());
+    for (const std::vector<uint8_t>& input : {MakeTextPayload(4096 * 8), MakeTextPayload(100001), mixed})
+    {
+        std::vector<uint8_t> compressed = parallel->Deflate(input);
+        NS_TEST_ASSERT_MSG_EQ(compressed.empty(),
+                              false,
+                              "Parallel Deflate of " << input.size() << " bytes failed");
+        NS_TEST_ASSERT_MSG_EQ((serial->Inflate(compressed) == input),
+                              true,
+                              "Serial Inflate failed");
+
+        std::vector<uint8_t> output(input.size());
+        uLongf outputSize = output.size();
+        NS_TEST_ASSERT_MSG_EQ(
+            uncompress(output.data(), &outputSize, compressed.data(), compressed.size()),
+            Z_OK,
+            "zlib's own uncompress() rejected the stream");
+        NS_TEST_ASSERT_MSG_EQ((output == input), true, "zlib's own uncompress() gave other bytes");
+    }
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for block-parallel Deflate into a too small buffer
+ */
+class ZlibIntegParallelErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegParallelErrorTestCase();
+    ~ZlibIntegParallelErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegParallelErrorTestCase::ZlibIntegParallelErrorTestCase()
+    : TestCase("ZlibInteg parallel Deflate into a small buffer fails")
+{
+}
+
+ZlibIntegParallelErrorTestCase::~ZlibIntegParallelErrorTestCase()
+{
+}
+
+void
+ZlibIntegParallelErrorTestCase::DoRun()
+{
+    Ptr<ZlibInteg> parallel = CreateObject<ZlibInteg>();
+    parallel->SetAttribute("Threads", UintegerValue(4));
+    parallel->SetAttribute("BlockSize", UintegerValue(4096));
+
+    std::vector<uint8_t> input = MakeTextPayload(40000);
+    std::vector<uint8_t> output(100);
+    NS_TEST_ASSERT_MSG_EQ(parallel->Deflate(input.data(), input.size(), output.data(), output.size()),
+                          Z_BUF_ERROR,
+                          "Parallel Deflate into a small buffer should fail");
+
+    // The object is still usable
+    output.resize(parallel->GetDeflateBound(input.size()));
+    int64_t compressedSize = parallel->Deflate(input.data(), input.size(), output.data(), output.size());
+    NS_TEST_ASSERT_MSG_GT(compressedSize, 0, "Parallel Deflate failed after an error");
+    output.resize(compressedSize);
+    NS_TEST_ASSERT_MSG_EQ((parallel->Inflate(output) == input),
+                          true,
+                          "Round trip failed after an error");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the seekable container
+ */
+class ZlibIntegSeekableTestCase : public TestCase
+{
+public:
+    ZlibIntegSeekableTestCase();
+    ~ZlibIntegSeekableTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegSeekableTestCase::ZlibIntegSeekableTestCase()
+    : TestCase("ZlibInteg seekable container random access")
+{
+}
+
+ZlibIntegSeekableTestCase::~ZlibIntegSeekableTestCase()
+{
+}
+
+void
+ZlibIntegSeekableTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    zlib->SetAttribute("Threads", UintegerValue(2));
+    zlib->SetAttribute("BlockSize", UintegerValue(4096));
+
+    std::vector<uint8_t> input = MakeTextPayload(50000);
+    std::vector<uint8_t> container = zlib->DeflateSeekable(input);
+    NS_TEST_ASSERT_MSG_EQ(container.empty(), false, "DeflateSeekable failed");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetSeekableSize(container),
+                          50000,
+                          "Wrong uncompressed size in the index");
+
+    std::vector<uint8_t> all = zlib->InflateRange(container, 0, input.size());
+    NS_TEST_ASSERT_MSG_EQ((all == input), true, "Whole range differs");
+
+    // A range within one block, and one spanning three blocks
+    std::vector<uint8_t> inside = zlib->InflateRange(container, 100, 50);
+    NS_TEST_ASSERT_MSG_EQ((inside == std::vector<uint8_t>(input.begin() + 100, input.begin() + 150)),
+                          true,
+                          "Range inside a block differs");
+    std::vector<uint8_t> across = zlib->InflateRange(container, 4000, 5000);
+    NS_TEST_ASSERT_MSG_EQ((across == std::vector<uint8_t>(input.begin() + 4000, input.begin() + 9000)),
+                          true,
+                          "Range across blocks differs");
+
+    // A range running past the end is truncated
+    std::vector<uint8_t> tail = zlib->InflateRange(container, 49900, 500);
+    NS_TEST_ASSERT_MSG_EQ((tail == std::vector<uint8_t>(input.end() - 100, input.end())),
+                          true,
+                          "Range past the end was not truncated");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for invalid seekable containers and ranges
+ */
+class ZlibIntegSeekableErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegSeekableErrorTestCase();
+    ~ZlibIntegSeekableErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegSeekableErrorTestCase::ZlibIntegSeekableErrorTestCase()
+    : TestCase("ZlibInteg seekable containers reject bad ranges and corruption")
+{
+}
+
+ZlibIntegSeekableErrorTestCase::~ZlibIntegSeekableErrorTestCase()
+{
+}
+
+void
+ZlibIntegSeekableErrorTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    zlib->SetAttribute("BlockSize", UintegerValue(4096));
+
+    std::vector<uint8_t> input = MakeTextPayload(20000);
+    std::vector<uint8_t> container = zlib->DeflateSeekable(input);
+
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateRange(container, input.size(), 10).empty(),
+                          true,
+                          "Range past the end");
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateRange(container, 0, 0).empty(), true, "Empty range");
+
+    std::vector<uint8_t> badMagic = container;
+    badMagic.back() ^= 0xff;
+    NS_TEST_ASSERT_MSG_LT(zlib->GetSeekableSize(badMagic), 0, "A bad magic was accepted");
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateRange(badMagic, 0, 10).empty(),
+                          true,
+                          "A bad magic was accepted");
+
+    std::vector<uint8_t> truncated(container.begin(), container.end() - 20);
+    NS_TEST_ASSERT_MSG_LT(zlib->GetSeekableSize(truncated), 0, "A truncated index was accepted");
+
+    // Corrupt the first block only: ranges in later blocks still decode
+    std::vector<uint8_t> badBlock = container;
+    badBlock[20] ^= 0xff;
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateRange(badBlock, 0, 100).empty(),
+                          true,
+                          "A corrupt block was accepted");
+    NS_TEST_ASSERT_MSG_EQ((zlib->InflateRange(badBlock, 10000, 100) ==
+                           std::vector<uint8_t>(input.begin() + 10000, input.begin() + 10100)),
+                          true,
+                          "A corrupt block broke the others");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the adaptive compression level
+ */
+class ZlibIntegAdaptiveTestCase : public TestCase
+{
+public:
+    ZlibIntegAdaptiveTestCase();
+    ~ZlibIntegAdaptiveTestCase() override;
+
+private:
+    void DoRun() override;
+
+    /**
+     * Records the level chosen for a packet.
+     *
+     * @param level The level.
+     * @param strategy The strategy.
+     */
+    void LevelChosen(int level, ZlibInteg::Strategy strategy);
+
+    /**
+     * Compresses and decompresses packets on a link.
+     *
+     * @param rate The link rate.
+     * @param backlogBytes Bytes queued on the link.
+     * @param count Number of packets.
+     * @return true if every packet survived the round trip
+     */
+    bool SendPackets(DataRate rate, uint32_t backlogBytes, uint32_t count);
+
+    std::vector<int> m_levels; //!< Levels chosen so far
+    Ptr<ZlibInteg> m_sender;   //!< Adaptive compressor
+    Ptr<ZlibInteg> m_receiver; //!< Decompressor
+};
+
+ZlibIntegAdaptiveTestCase::ZlibIntegAdaptiveTestCase()
+    : TestCase("ZlibInteg adaptive level follows the link state")
+{
+}
+
+ZlibIntegAdaptiveTestCase::~ZlibIntegAdaptiveTestCase()
+{
+}
+
+void
+ZlibIntegAdaptiveTestCase::LevelChosen(int level, ZlibInteg::Strategy /* strategy */)
+{
+    m_levels.push_back(level);
+}
+
+bool
+ZlibIntegAdaptiveTestCase::SendPackets(DataRate rate, uint32_t backlogBytes, uint32_t count)
+{
+    std::vector<uint8_t> text = MakeTextPayload(1400);
+    m_sender->SetLinkState(rate, backlogBytes);
+    m_levels.clear();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Ptr<Packet> packet = Create<Packet>(text.data(), text.size());
+        m_sender->CompressPacket(packet);
+        if (!m_receiver->DecompressPacket(packet) || GetPacketBytes(packet) != text)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+ZlibIntegAdaptiveTestCase::DoRun()
+{
+    m_sender = CreateObject<ZlibInteg>();
+    m_sender->SetAttribute("AdaptiveLevel", BooleanValue(true));
+    m_sender->SetAttribute("Level", IntegerValue(4));
+    m_sender->TraceConnectWithoutContext("ChosenLevel",
+                                         MakeCallback(&ZlibIntegAdaptiveTestCase::LevelChosen,
+                                                      this));
+    m_receiver = CreateObject<ZlibInteg>();
+
+    // Without a link state the Level attribute applies, once every candidate is measured
+    NS_TEST_ASSERT_MSG_EQ(SendPackets(DataRate(0), 0, 10), true, "A packet failed its round trip");
+    NS_TEST_ASSERT_MSG_EQ(m_levels.size(), 10, "ChosenLevel should fire for every packet");
+    NS_TEST_ASSERT_MSG_EQ(m_levels.back(),
+                          4,
+                          "Without a link state the Level attribute should apply");
+
+    // A 100 Gbps link leaves no CPU budget: packets are mostly stored
+    NS_TEST_ASSERT_MSG_EQ(SendPackets(DataRate(100000000000ULL), 0, 40),
+                          true,
+                          "A packet failed its round trip");
+    NS_TEST_ASSERT_MSG_GT(std::count(m_levels.begin(), m_levels.end(), 0),
+                          30,
+                          "A fast link should store packets");
+
+    // A backlogged 1 kbps link is worth every byte saved
+    NS_TEST_ASSERT_MSG_EQ(SendPackets(DataRate(1000), 100000, 40),
+                          true,
+                          "A packet failed its round trip");
+    NS_TEST_ASSERT_MSG_LT(std::count(m_levels.begin(), m_levels.end(), 0),
+                          5,
+                          "A slow link should compress packets");
+    for (int level : m_levels)
+    {
+        NS_TEST_ASSERT_MSG_EQ((level >= 0 && level <= 9),
+                              true,
+                              "Level " << level << " out of range");
+    }
+
+    m_sender = nullptr;
+    m_receiver = nullptr;
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the deflate context shared by the adaptive candidates
+ */
+class ZlibIntegAdaptiveStreamTestCase : public TestCase
+{
+public:
+    ZlibIntegAdaptiveStreamTestCase();
+    ~ZlibIntegAdaptiveStreamTestCase() override;
+
+private:
+    void DoRun() override;
+
+    /**
+     * Records the level chosen for a packet.
+     *
+     * @param level The level.
+     * @param strategy The strategy.
+     */
+    void LevelChosen(int level, ZlibInteg::Strategy strategy);
+
+    std::set<std::pair<int, ZlibInteg::Strategy>> m_chosen; //!< Candidates chosen so far
+};
+
+ZlibIntegAdaptiveStreamTestCase::ZlibIntegAdaptiveStreamTestCase()
+    : TestCase("ZlibInteg switches adaptive candidates without re-creating its context")
+{
+}
+
+ZlibIntegAdaptiveStreamTestCase::~ZlibIntegAdaptiveStreamTestCase()
+{
+}
+
+void
+ZlibIntegAdaptiveStreamTestCase::LevelChosen(int level, ZlibInteg::Strategy strategy)
+{
+    m_chosen.insert({level, strategy});
+}
+
+void
+ZlibIntegAdaptiveStreamTestCase::DoRun()
+{
+    ZlibMemoryPool* pool = ZlibMemoryPool::Get();
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    zlib->SetAttribute("AdaptiveLevel", BooleanValue(true));
+    zlib->TraceConnectWithoutContext("ChosenLevel",
+                                     MakeCallback(&ZlibIntegAdaptiveStreamTestCase::LevelChosen,
+                                                  this));
+    std::vector<uint8_t> text = MakeTextPayload(1400);
+    std::vector<uint8_t> compressed(zlib->GetDeflateBound(text.size()));
+
+    // The first calls create the contexts, and the inflate window of packets
+    zlib->Deflate(text.data(), text.size(), compressed.data(), compressed.size());
+    Ptr<Packet> first = Create<Packet>(text.data(), text.size());
+    zlib->CompressPacket(first);
+    zlib->DecompressPacket(first);
+    uint64_t allocations = pool->GetAllocations();
+
+    // Every candidate is measured in turn, between calls at the Level attribute
+    for (int i = 0; i < 20; i++)
+    {
+        Ptr<Packet> packet = Create<Packet>(text.data(), text.size());
+        zlib->CompressPacket(packet);
+        NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(packet), true, "Round trip failed");
+        NS_TEST_ASSERT_MSG_GT(
+            zlib->Deflate(text.data(), text.size(), compressed.data(), compressed.size()),
+            0,
+            "Deflate at the Level attribute failed");
+    }
+    NS_TEST_ASSERT_MSG_GT(m_chosen.size(), 4, "The candidates did not alternate");
+    NS_TEST_ASSERT_MSG_EQ(pool->GetAllocations(),
+                          allocations,
+                          "Switching candidates allocated zlib memory");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the compressibility estimator
+ */
+class ZlibIntegEntropyTestCase : public TestCase
+{
+public:
+    ZlibIntegEntropyTestCase();
+    ~ZlibIntegEntropyTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegEntropyTestCase::ZlibIntegEntropyTestCase()
+    : TestCase("ZlibInteg skips payloads estimated to be incompressible")
+{
+}
+
+ZlibIntegEntropyTestCase::~ZlibIntegEntropyTestCase()
+{
+}
+
+void
+ZlibIntegEntropyTestCase::DoRun()
+{
+    std::vector<uint8_t> zeros(1000, 0);
+    std::vector<uint8_t> text = MakeTextPayload(2000);
+    std::vector<uint8_t> random = MakeRandomPayload(1000, 11);
+    NS_TEST_ASSERT_MSG_EQ(ZlibInteg::EstimateEntropy(nullptr, 0), 0.0, "No data has no entropy");
+    NS_TEST_ASSERT_MSG_EQ(ZlibInteg::EstimateEntropy(zeros.data(), zeros.size()),
+                          0.0,
+                          "Zeros have no entropy");
+    NS_TEST_ASSERT_MSG_LT(ZlibInteg::EstimateEntropy(text.data(), text.size()),
+                          5.0,
+                          "Text looks random");
+    NS_TEST_ASSERT_MSG_GT(ZlibInteg::EstimateEntropy(random.data(), random.size()),
+                          7.5,
+                          "Random bytes look compressible");
+
+    // Random data is stored, which still inflates
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    random = MakeRandomPayload(100000, 12);
+    std::vector<uint8_t> stored = zlib->Deflate(random);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetSkippedCount(), 1, "Random data was not skipped");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCompressedCount(), 0, "Random data was compressed");
+    NS_TEST_ASSERT_MSG_GT(stored.size(),
+                          random.size(),
+                          "Stored blocks cannot be smaller than the input");
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(stored) == random), true, "Stored stream did not inflate");
+
+    zlib->Deflate(text);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCompressedCount(), 1, "Text was not compressed");
+
+    // SkipEntropy 8 compresses everything
+    zlib->SetAttribute("SkipEntropy", DoubleValue(8.0));
+    zlib->Deflate(random);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetSkippedCount(), 1, "SkipEntropy 8 should never skip");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCompressedCount(), 2, "SkipEntropy 8 should always compress");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the estimate of large packets
+ */
+class ZlibIntegEntropyPacketTestCase : public TestCase
+{
+public:
+    ZlibIntegEntropyPacketTestCase();
+    ~ZlibIntegEntropyPacketTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegEntropyPacketTestCase::ZlibIntegEntropyPacketTestCase()
+    : TestCase("ZlibInteg samples large packets across their whole payload")
+{
+}
+
+ZlibIntegEntropyPacketTestCase::~ZlibIntegEntropyPacketTestCase()
+{
+}
+
+void
+ZlibIntegEntropyPacketTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    std::vector<uint8_t> text = MakeTextPayload(2000);
+    std::vector<uint8_t> random = MakeRandomPayload(30000, 13);
+
+    // A compressible header must not hide an incompressible body
+    std::vector<uint8_t> payload = text;
+    payload.insert(payload.end(), random.begin(), random.end());
+    Ptr<Packet> packet = Create<Packet>(payload.data(), payload.size());
+    NS_TEST_ASSERT_MSG_EQ(zlib->CompressPacket(packet), false, "A random body was compressed");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetSkippedCount(), 1, "A random body was not skipped");
+    NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(packet),
+                          true,
+                          "Skipped packet did not decompress");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == payload), true, "Skipped packet changed");
+
+    // Nor an incompressible header a compressible body
+    payload.assign(random.begin(), random.begin() + 2000);
+    std::vector<uint8_t> body = MakeTextPayload(30000);
+    payload.insert(payload.end(), body.begin(), body.end());
+    packet = Create<Packet>(payload.data(), payload.size());
+    NS_TEST_ASSERT_MSG_EQ(zlib->CompressPacket(packet), true, "A text body was not compressed");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCompressedCount(), 1, "A text body was skipped");
+    NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(packet),
+                          true,
+                          "Compressed packet did not decompress");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == payload), true, "Compressed packet changed");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the zlib memory pool
+ */
+class ZlibIntegMemoryPoolTestCase : public TestCase
+{
+public:
+    ZlibIntegMemoryPoolTestCase();
+    ~ZlibIntegMemoryPoolTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegMemoryPoolTestCase::ZlibIntegMemoryPoolTestCase()
+    : TestCase("ZlibMemoryPool recycles blocks between streams")
+{
+}
+
+ZlibIntegMemoryPoolTestCase::~ZlibIntegMemoryPoolTestCase()
+{
+}
+
+void
+ZlibIntegMemoryPoolTestCase::DoRun()
+{
+    ZlibMemoryPool* pool = ZlibMemoryPool::Get();
+    NS_TEST_ASSERT_MSG_EQ(pool, ZlibMemoryPool::Get(), "The pool should be shared");
+
+    // An odd size no zlib stream uses
+    const size_t size = 12345;
+    void* block = pool->Allocate(size);
+    NS_TEST_ASSERT_MSG_NE(block, nullptr, "Allocate failed");
+    std::memset(block, 0xab, size);
+    pool->Release(block);
+
+    uint64_t systemAllocations = pool->GetSystemAllocations();
+    uint64_t allocations = pool->GetAllocations();
+    void* again = pool->Allocate(size);
+    NS_TEST_ASSERT_MSG_EQ(again, block, "The idle block was not reused");
+    NS_TEST_ASSERT_MSG_EQ(pool->GetSystemAllocations(),
+                          systemAllocations,
+                          "The system was asked again");
+    NS_TEST_ASSERT_MSG_EQ(pool->GetAllocations(),
+                          allocations + 1,
+                          "The allocation was not counted");
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(pool->GetCurrentBytes(), size, "The block is not counted in use");
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(pool->GetPeakBytes(),
+                                pool->GetCurrentBytes(),
+                                "Peak below current");
+    pool->Release(again);
+    pool->Release(nullptr);
+
+    // Trim hands idle blocks back
+    pool->Trim();
+    NS_TEST_ASSERT_MSG_EQ(pool->GetCachedBytes(), 0, "Trim left idle blocks");
+    pool->Release(pool->Allocate(size));
+    NS_TEST_ASSERT_MSG_EQ(pool->GetSystemAllocations(),
+                          systemAllocations + 1,
+                          "Trim kept the block");
+
+    // Without room for idle blocks they go straight back to the system
+    pool->Trim();
+    pool->SetMaxCachedBytes(0);
+    pool->Release(pool->Allocate(size));
+    NS_TEST_ASSERT_MSG_EQ(pool->GetCachedBytes(), 0, "A block was kept beyond the cap");
+
+    // Back to the default cap
+    pool->SetMaxCachedBytes(1024 * 1024);
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for ZlibInteg objects allocating from the pool
+ */
+class ZlibIntegPooledStreamsTestCase : public TestCase
+{
+public:
+    ZlibIntegPooledStreamsTestCase();
+    ~ZlibIntegPooledStreamsTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegPooledStreamsTestCase::ZlibIntegPooledStreamsTestCase()
+    : TestCase("ZlibInteg streams reuse pooled memory across objects")
+{
+}
+
+ZlibIntegPooledStreamsTestCase::~ZlibIntegPooledStreamsTestCase()
+{
+}
+
+void
+ZlibIntegPooledStreamsTestCase::DoRun()
+{
+    ZlibMemoryPool* pool = ZlibMemoryPool::Get();
+    std::vector<uint8_t> input = MakeTextPayload(5000);
+
+    // Warm the pool, then objects created and destroyed reuse its blocks
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(zlib->Deflate(input)) == input),
+                          true,
+                          "Round trip failed");
+    zlib->Dispose();
+
+    uint64_t systemAllocations = pool->GetSystemAllocations();
+    for (int i = 0; i < 10; i++)
+    {
+        zlib = CreateObject<ZlibInteg>();
+        NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(zlib->Deflate(input)) == input),
+                              true,
+                              "Round trip failed");
+        zlib->Dispose();
+    }
+    NS_TEST_ASSERT_MSG_EQ(pool->GetSystemAllocations(),
+                          systemAllocations,
+                          "Streams did not reuse blocks");
+
+    // Without the pool, streams use zlib's own allocator
+    zlib = CreateObject<ZlibInteg>();
+    zlib->SetAttribute("MemoryPool", BooleanValue(false));
+    uint64_t allocations = pool->GetAllocations();
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(zlib->Deflate(input)) == input),
+                          true,
+                          "Unpooled round trip failed");
+    NS_TEST_ASSERT_MSG_EQ(pool->GetAllocations(), allocations, "Unpooled streams used the pool");
+    zlib->Dispose();
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for streaming Inflate
+ */
+class ZlibIntegInflateStreamTestCase : public TestCase
+{
+public:
+    ZlibIntegInflateStreamTestCase();
+    ~ZlibIntegInflateStreamTestCase() override;
+
+private:
+    void DoRun() override;
+
+    /**
+     * Collects a chunk of decompressed data.
+     *
+     * @param data The chunk.
+     * @param size Its size.
+     * @return false once m_abortAfter chunks were received
+     */
+    bool Sink(const uint8_t* data, uint32_t size);
+
+    std::vector<uint8_t> m_output; //!< Bytes received so far
+    uint32_t m_chunks;             //!< Chunks received so far
+    uint32_t m_largestChunk;       //!< Largest chunk received
+    uint32_t m_abortAfter;         //!< Chunks after which the sink aborts (0 = never)
+};
+
+ZlibIntegInflateStreamTestCase::ZlibIntegInflateStreamTestCase()
+    : TestCase("ZlibInteg InflateStream hands bounded chunks to a sink"),
+      m_chunks(0),
+      m_largestChunk(0),
+      m_abortAfter(0)
+{
+}
+
+ZlibIntegInflateStreamTestCase::~ZlibIntegInflateStreamTestCase()
+{
+}
+
+bool
+ZlibIntegInflateStreamTestCase::Sink(const uint8_t* data, uint32_t size)
+{
+    m_output.insert(m_output.end(), data, data + size);
+    m_chunks++;
+    m_largestChunk = std::max(m_largestChunk, size);
+    return m_abortAfter == 0 || m_chunks < m_abortAfter;
+}
+
+void
+ZlibIntegInflateStreamTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    ZlibInteg::InflateSink sink = MakeCallback(&ZlibIntegInflateStreamTestCase::Sink, this);
+    std::vector<uint8_t> input = MakeTextPayload(200000);
+    std::vector<uint8_t> compressed = zlib->Deflate(input);
+
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateStream(compressed, sink),
+                          static_cast<int64_t>(input.size()),
+                          "Wrong size streamed");
+    NS_TEST_ASSERT_MSG_EQ((m_output == input), true, "Streamed output differs");
+    NS_TEST_ASSERT_MSG_GT(m_chunks, 1, "200 KB should take several chunks");
+    NS_TEST_ASSERT_MSG_LT_OR_EQ(m_largestChunk, 16384, "A chunk exceeds 16 KB");
+
+    // The sink aborts after two chunks
+    m_output.clear();
+    m_chunks = 0;
+    m_abortAfter = 2;
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateStream(compressed, sink),
+                          Z_STREAM_ERROR,
+                          "The abort was ignored");
+    NS_TEST_ASSERT_MSG_EQ(m_chunks, 2, "Chunks were delivered after the abort");
+
+    // The output exceeds MaxInflateSize
+    m_chunks = 0;
+    m_abortAfter = 0;
+    zlib->SetAttribute("MaxInflateSize", UintegerValue(50000));
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateStream(compressed, sink),
+                          Z_BUF_ERROR,
+                          "The size limit was ignored");
+    zlib->SetAttribute("MaxInflateSize", UintegerValue(0));
+
+    // A truncated stream fails once its data runs out, told apart from the size limit
+    for (size_t size : {compressed.size() / 2, compressed.size() - 1, static_cast<size_t>(10)})
+    {
+        std::vector<uint8_t> truncated(compressed.begin(), compressed.begin() + size);
+        NS_TEST_ASSERT_MSG_EQ(zlib->InflateStream(truncated, sink),
+                              Z_DATA_ERROR,
+                              "A stream truncated to " << size << " bytes was not corrupt");
+    }
+    NS_TEST_ASSERT_MSG_LT(zlib->InflateStream(std::vector<uint8_t>(), sink),
+                          0,
+                          "Empty input was accepted");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Copies an item out of a batch.
+ *
+ * @param batch The batch.
+ * @param index Index of the item.
+ * @return The item's bytes
+ */
+static std::vector<uint8_t>
+GetBatchItem(const ZlibInteg::Batch& batch, size_t index)
+{
+    return std::vector<uint8_t>(batch.GetItem(index), batch.GetItem(index) + batch.GetItemSize(index));
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the batch API
+ */
+class ZlibIntegBatchTestCase : public TestCase
+{
+public:
+    ZlibIntegBatchTestCase();
+    ~ZlibIntegBatchTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegBatchTestCase::ZlibIntegBatchTestCase()
+    : TestCase("ZlibInteg DeflateBatch and InflateBatch")
+{
+}
+
+ZlibIntegBatchTestCase::~ZlibIntegBatchTestCase()
+{
+}
+
+void
+ZlibIntegBatchTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    zlib->SetAttribute("Threads", UintegerValue(3));
+    zlib->SetAttribute("BlockSize", UintegerValue(4096));
+
+    std::vector<std::vector<uint8_t>> inputs;
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        inputs.push_back(i % 10 == 3 ? MakeRandomPayload(100 + i, i) : MakeTextPayload(100 + i * 13));
+    }
+
+    ZlibInteg::Batch compressed;
+    NS_TEST_ASSERT_MSG_EQ(zlib->DeflateBatch(inputs, compressed), true, "DeflateBatch failed");
+    NS_TEST_ASSERT_MSG_EQ(compressed.GetCount(), inputs.size(), "Wrong number of compressed items");
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ((GetBatchItem(compressed, i) == zlib->Deflate(inputs[i])),
+                              true,
+                              "Item " << i << " differs from Deflate");
+    }
+
+    ZlibInteg::Batch decompressed;
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateBatch(compressed, decompressed),
+                          true,
+                          "InflateBatch failed");
+    NS_TEST_ASSERT_MSG_EQ(decompressed.GetCount(),
+                          inputs.size(),
+                          "Wrong number of decompressed items");
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ((GetBatchItem(decompressed, i) == inputs[i]),
+                              true,
+                              "Item " << i << " did not round trip");
+    }
+
+    // An empty batch is a successful no-op
+    ZlibInteg::Batch empty;
+    NS_TEST_ASSERT_MSG_EQ(zlib->DeflateBatch(empty, compressed), true, "An empty batch failed");
+    NS_TEST_ASSERT_MSG_EQ(compressed.GetCount(), 0, "An empty batch produced items");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for batches with failing items
+ */
+class ZlibIntegBatchErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegBatchErrorTestCase();
+    ~ZlibIntegBatchErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegBatchErrorTestCase::ZlibIntegBatchErrorTestCase()
+    : TestCase("ZlibInteg batches keep the items that succeed")
+{
+}
+
+ZlibIntegBatchErrorTestCase::~ZlibIntegBatchErrorTestCase()
+{
+}
+
+void
+ZlibIntegBatchErrorTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    std::vector<uint8_t> first = MakeTextPayload(500);
+    std::vector<uint8_t> last = MakeTextPayload(700);
+
+    std::vector<std::vector<uint8_t>> inputs = {first, std::vector<uint8_t>(), last};
+    ZlibInteg::Batch compressed;
+    NS_TEST_ASSERT_MSG_EQ(zlib->DeflateBatch(inputs, compressed),
+                          false,
+                          "An empty item was accepted");
+    NS_TEST_ASSERT_MSG_EQ(compressed.GetCount(), 3, "Every item should have a slot");
+    NS_TEST_ASSERT_MSG_EQ(compressed.GetItemSize(1), 0, "The failed item should be empty");
+
+    std::vector<std::vector<uint8_t>> junk = {zlib->Deflate(first),
+                                              MakeRandomPayload(64, 14),
+                                              zlib->Deflate(last)};
+    ZlibInteg::Batch decompressed;
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateBatch(junk, decompressed),
+                          false,
+                          "A junk item was accepted");
+    NS_TEST_ASSERT_MSG_EQ(decompressed.GetCount(), 3, "Every item should have a slot");
+    NS_TEST_ASSERT_MSG_EQ(decompressed.GetItemSize(1), 0, "The failed item should be empty");
+    NS_TEST_ASSERT_MSG_EQ((GetBatchItem(decompressed, 0) == first),
+                          true,
+                          "The item before the failure was lost");
+    NS_TEST_ASSERT_MSG_EQ((GetBatchItem(decompressed, 2) == last),
+                          true,
+                          "The item after the failure was lost");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Run-length codec plugged into ZlibInteg through SetBackend().
+ *
+ * The output is the input size (4 bytes, big-endian) followed by
+ * (run length, byte) pairs.
+ */
+class ZlibIntegRunLengthBackend : public CompressionBackend
+{
+public:
+    /**
+     * @brief Get the type ID.
+     * @return The object TypeId
+     */
+    static TypeId GetTypeId();
+
+    ZlibIntegRunLengthBackend();
+
+    std::string GetName() const override;
+    size_t GetCompressBound(size_t inputSize) const override;
+    int64_t Compress(const uint8_t* input,
+                     size_t inputSize,
+                     uint8_t* output,
+                     size_t outputCapacity,
+                     int level) override;
+    int64_t GetDecompressedSize(const uint8_t* input, size_t inputSize) const override;
+    int64_t Decompress(const uint8_t* input,
+                       size_t inputSize,
+                       uint8_t* output,
+                       size_t outputCapacity) override;
+
+    uint32_t m_compressCalls;   //!< Number of Compress() calls
+    uint32_t m_decompressCalls; //!< Number of Decompress() calls
+};
+
+TypeId
+ZlibIntegRunLengthBackend::GetTypeId()
+{
+    static TypeId tid = TypeId("ZlibIntegRunLengthBackend")
+                            .SetParent<CompressionBackend>()
+                            .SetGroupName("ZlibInteg")
+                            .AddConstructor<ZlibIntegRunLengthBackend>();
+    return tid;
+}
+
+ZlibIntegRunLengthBackend::ZlibIntegRunLengthBackend()
+    : m_compressCalls(0),
+      m_decompressCalls(0)
+{
+}
+
+std::string
+ZlibIntegRunLengthBackend::GetName() const
+{
+    return "rle";
+}
+
+size_t
+ZlibIntegRunLengthBackend::GetCompressBound(size_t inputSize) const
+{
+    return 4 + 2 * inputSize;
+}
+
+int64_t
+ZlibIntegRunLengthBackend::Compress(const uint8_t* input,
+                                    size_t inputSize,
+                                    uint8_t* output,
+                                    size_t outputCapacity,
+                                    int /* level */)
+{
+    m_compressCalls++;
+    if (outputCapacity < 4)
+    {
+        return Z_BUF_ERROR;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        output[i] = static_cast<uint8_t>(inputSize >> (24 - 8 * i));
+    }
+    size_t produced = 4;
+    for (size_t i = 0; i < inputSize;)
+    {
+        size_t run = 1;
+        while (i + run < inputSize && run < 255 && input[i + run] == input[i])
+        {
+            run++;
+        }
+        if (produced + 2 > outputCapacity)
+        {
+            return Z_BUF_ERROR;
+        }
+        output[produced++] = static_cast<uint8_t>(run);
+        output[produced++] = input[i];
+        i += run;
+    }
+    return produced;
+}
+
+int64_t
+ZlibIntegRunLengthBackend::GetDecompressedSize(const uint8_t* input, size_t inputSize) const
+{
+    if (inputSize < 4)
+    {
+        return Z_DATA_ERROR;
+    }
+    return (uint32_t(input[0]) << 24) | (uint32_t(input[1]) << 16) | (uint32_t(input[2]) << 8) | input[3];
+}
+
+int64_t
+ZlibIntegRunLengthBackend::Decompress(const uint8_t* input,
+                                      size_t inputSize,
+                                      uint8_t* output,
+                                      size_t outputCapacity)
+{
+    m_decompressCalls++;
+    int64_t size = GetDecompressedSize(input, inputSize);
+    if (size < 0 || inputSize % 2 != 0)
+    {
+        return Z_DATA_ERROR;
+    }
+    size_t produced = 0;
+    for (size_t i = 4; i < inputSize; i += 2)
+    {
+        if (produced + input[i] > outputCapacity)
+        {
+            return Z_BUF_ERROR;
+        }
+        std::memset(output + produced, input[i + 1], input[i]);
+        produced += input[i];
+    }
+    return produced == static_cast<size_t>(size) ? size : Z_DATA_ERROR;
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the stream formats
+ */
+class ZlibIntegFormatTestCase : public TestCase
+{
+public:
+    ZlibIntegFormatTestCase();
+    ~ZlibIntegFormatTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegFormatTestCase::ZlibIntegFormatTestCase()
+    : TestCase("ZlibInteg zlib, raw deflate and gzip formats")
+{
+}
+
+ZlibIntegFormatTestCase::~ZlibIntegFormatTestCase()
+{
+}
+
+void
+ZlibIntegFormatTestCase::DoRun()
+{
+    std::vector<uint8_t> input = MakeTextPayload(3000);
+    Ptr<ZlibInteg> zlibFormat = CreateObject<ZlibInteg>();
+    Ptr<ZlibInteg> rawFormat = CreateObject<ZlibInteg>();
+    rawFormat->SetAttribute("Format", EnumValue(ZlibInteg::FORMAT_RAW));
+    Ptr<ZlibInteg> gzipFormat = CreateObject<ZlibInteg>();
+    gzipFormat->SetAttribute("Format", EnumValue(ZlibInteg::FORMAT_GZIP));
+
+    std::vector<uint8_t> zlibStream = zlibFormat->Deflate(input);
+    std::vector<uint8_t> rawStream = rawFormat->Deflate(input);
+    std::vector<uint8_t> gzipStream = gzipFormat->Deflate(input);
+
+    // Same deflate data, without the 2-byte header and 4-byte trailer
+    NS_TEST_ASSERT_MSG_EQ(rawStream.size() + 6,
+                          zlibStream.size(),
+                          "Raw deflate should save 6 bytes");
+    NS_TEST_ASSERT_MSG_EQ((gzipStream[0] == 0x1f && gzipStream[1] == 0x8b), true, "No gzip magic");
+
+    NS_TEST_ASSERT_MSG_EQ((rawFormat->Inflate(rawStream) == input), true, "Raw round trip failed");
+    NS_TEST_ASSERT_MSG_EQ((gzipFormat->Inflate(gzipStream) == input),
+                          true,
+                          "Gzip round trip failed");
+
+    // Both ends must agree on the format
+    NS_TEST_ASSERT_MSG_EQ(rawFormat->Inflate(zlibStream).empty(),
+                          true,
+                          "A raw receiver took a zlib stream");
+    NS_TEST_ASSERT_MSG_EQ(gzipFormat->Inflate(zlibStream).empty(),
+                          true,
+                          "A gzip receiver took a zlib stream");
+    NS_TEST_ASSERT_MSG_EQ(zlibFormat->Inflate(gzipStream).empty(),
+                          true,
+                          "A zlib receiver took a gzip stream");
+
+    // Packets too
+    Ptr<Packet> packet = Create<Packet>(input.data(), input.size());
+    NS_TEST_ASSERT_MSG_EQ(rawFormat->CompressPacket(packet), true, "Raw CompressPacket failed");
+    NS_TEST_ASSERT_MSG_EQ(rawFormat->DecompressPacket(packet), true, "Raw DecompressPacket failed");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == input), true, "Raw packet round trip failed");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for a codec plugged in with SetBackend()
+ */
+class ZlibIntegBackendTestCase : public TestCase
+{
+public:
+    ZlibIntegBackendTestCase();
+    ~ZlibIntegBackendTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegBackendTestCase::ZlibIntegBackendTestCase()
+    : TestCase("ZlibInteg delegates to a pluggable backend")
+{
+}
+
+ZlibIntegBackendTestCase::~ZlibIntegBackendTestCase()
+{
+}
+
+void
+ZlibIntegBackendTestCase::DoRun()
+{
+    Ptr<ZlibIntegRunLengthBackend> backend = CreateObject<ZlibIntegRunLengthBackend>();
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetBackend(), nullptr, "zlib needs no backend");
+    zlib->SetBackend(backend);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetBackend(), backend, "The backend was not plugged in");
+
+    std::vector<uint8_t> input(1000, 7);
+    std::vector<uint8_t> compressed = zlib->Deflate(input);
+    NS_TEST_ASSERT_MSG_EQ(backend->m_compressCalls, 1, "Deflate did not use the backend");
+    NS_TEST_ASSERT_MSG_EQ(compressed.size(), 4 + 2 * 4, "1000 equal bytes are four runs");
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(compressed) == input), true, "Backend round trip failed");
+    NS_TEST_ASSERT_MSG_EQ(backend->m_decompressCalls, 1, "Inflate did not use the backend");
+
+    Ptr<Packet> packet = Create<Packet>(input.data(), input.size());
+    NS_TEST_ASSERT_MSG_EQ(zlib->CompressPacket(packet),
+                          true,
+                          "CompressPacket did not use the backend");
+    NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(packet),
+                          true,
+                          "DecompressPacket did not use the backend");
+    NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == input),
+                          true,
+                          "Backend packet round trip failed");
+
+    // Backend errors surface as failures
+    std::vector<uint8_t> corrupted = compressed;
+    corrupted[3] ^= 1;
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(corrupted).empty(), true, "A corrupted size was accepted");
+
+    // Back to zlib, which cannot read the backend's output
+    zlib->SetBackend(nullptr);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetBackend(), nullptr, "The backend was not removed");
+    NS_TEST_ASSERT_MSG_EQ(zlib->Inflate(compressed).empty(),
+                          true,
+                          "zlib took the backend's output");
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(zlib->Deflate(input)) == input),
+                          true,
+                          "zlib round trip failed");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the compressed pcap writer
+ */
+class ZlibIntegPcapWriterTestCase : public TestCase
+{
+public:
+    ZlibIntegPcapWriterTestCase();
+    ~ZlibIntegPcapWriterTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegPcapWriterTestCase::ZlibIntegPcapWriterTestCase()
+    : TestCase("CompressedPcapWriter writes a readable .pcap.gz file")
+{
+}
+
+ZlibIntegPcapWriterTestCase::~ZlibIntegPcapWriterTestCase()
+{
+}
+
+void
+ZlibIntegPcapWriterTestCase::DoRun()
+{
+    const uint32_t packets = 200;
+    const uint32_t snapLen = 256;
+    std::string filename = CreateTempDirFilename("zlib-integ-test.pcap.gz");
+    std::vector<uint8_t> text = MakeTextPayload(100 + packets);
+
+    // Small blocks, so the file is made of many gzip members
+    Ptr<CompressedPcapWriter> writer = CreateObject<CompressedPcapWriter>();
+    writer->SetAttribute("BlockSize", UintegerValue(4096));
+    NS_TEST_ASSERT_MSG_EQ(writer->Open(filename, CompressedPcapWriter::DLT_EN10MB, snapLen),
+                          true,
+                          "Open failed");
+    for (uint32_t i = 0; i < packets; i++)
+    {
+        writer->Write(MicroSeconds(1500000 + i * 250), Create<Packet>(text.data(), 100 + i));
+    }
+    writer->Close();
+    NS_TEST_ASSERT_MSG_EQ(writer->IsOpen(), false, "The file is still open");
+    NS_TEST_ASSERT_MSG_GT(writer->GetCompressedBytes(), 0, "Nothing was written");
+    NS_TEST_ASSERT_MSG_LT(writer->GetCompressedBytes(),
+                          writer->GetUncompressedBytes(),
+                          "Nothing was saved");
+
+    // Read it back with zlib's gzip reader, which joins the members
+    gzFile file = gzopen(filename.c_str(), "rb");
+    NS_TEST_ASSERT_MSG_NE(file, nullptr, "The file cannot be opened");
+    std::vector<uint8_t> pcap;
+    uint8_t buffer[8192];
+    int read;
+    while ((read = gzread(file, buffer, sizeof(buffer))) > 0)
+    {
+        pcap.insert(pcap.end(), buffer, buffer + read);
+    }
+    NS_TEST_ASSERT_MSG_EQ(gzclose(file), Z_OK, "The file is not valid gzip");
+    NS_TEST_ASSERT_MSG_EQ(pcap.size(), writer->GetUncompressedBytes(), "Wrong uncompressed size");
+
+    uint32_t header[6];
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(pcap.size(), sizeof(header), "The file header is missing");
+    std::memcpy(header, pcap.data(), sizeof(header));
+    NS_TEST_ASSERT_MSG_EQ(header[0], 0xa1b2c3d4, "Wrong magic");
+    NS_TEST_ASSERT_MSG_EQ(header[4], snapLen, "Wrong snapshot length");
+    NS_TEST_ASSERT_MSG_EQ(header[5], CompressedPcapWriter::DLT_EN10MB, "Wrong link type");
+
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < packets; i++)
+    {
+        uint32_t record[4];
+        NS_TEST_ASSERT_MSG_LT_OR_EQ(offset + sizeof(record),
+                                    pcap.size(),
+                                    "Record " << i << " is missing");
+        std::memcpy(record, pcap.data() + offset, sizeof(record));
+        uint32_t size = 100 + i;
+        uint64_t microseconds = 1500000 + i * 250;
+        NS_TEST_ASSERT_MSG_EQ(record[0], microseconds / 1000000, "Wrong seconds in record " << i);
+        NS_TEST_ASSERT_MSG_EQ(record[1],
+                              microseconds % 1000000,
+                              "Wrong microseconds in record " << i);
+        NS_TEST_ASSERT_MSG_EQ(record[2],
+                              std::min(size, snapLen),
+                              "Wrong stored length in record " << i);
+        NS_TEST_ASSERT_MSG_EQ(record[3], size, "Wrong original length in record " << i);
+        offset += sizeof(record);
+        NS_TEST_ASSERT_MSG_EQ(std::memcmp(pcap.data() + offset, text.data(), record[2]),
+                              0,
+                              "Wrong data in record " << i);
+        offset += record[2];
+    }
+    NS_TEST_ASSERT_MSG_EQ(offset, pcap.size(), "Trailing bytes after the last record");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for a pcap file that cannot be created
+ */
+class ZlibIntegPcapWriterErrorTestCase : public TestCase
+{
+public:
+    ZlibIntegPcapWriterErrorTestCase();
+    ~ZlibIntegPcapWriterErrorTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegPcapWriterErrorTestCase::ZlibIntegPcapWriterErrorTestCase()
+    : TestCase("CompressedPcapWriter reports files it cannot create")
+{
+}
+
+ZlibIntegPcapWriterErrorTestCase::~ZlibIntegPcapWriterErrorTestCase()
+{
+}
+
+void
+ZlibIntegPcapWriterErrorTestCase::DoRun()
+{
+    Ptr<CompressedPcapWriter> writer = CreateObject<CompressedPcapWriter>();
+    std::string filename = CreateTempDirFilename("no-such-directory/trace.pcap.gz");
+    NS_TEST_ASSERT_MSG_EQ(writer->Open(filename, CompressedPcapWriter::DLT_PPP),
+                          false,
+                          "Open succeeded");
+    NS_TEST_ASSERT_MSG_EQ(writer->IsOpen(), false, "The writer claims to be open");
+
+    // Writing to and closing a writer that is not open does nothing
+    std::vector<uint8_t> data = MakeTextPayload(100);
+    writer->Write(Seconds(1), Create<Packet>(data.data(), data.size()));
+    writer->Close();
+    NS_TEST_ASSERT_MSG_EQ(writer->GetUncompressedBytes(), 0, "A closed writer took a record");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the cache of compressed results
+ */
+class ZlibIntegCacheTestCase : public TestCase
+{
+public:
+    ZlibIntegCacheTestCase();
+    ~ZlibIntegCacheTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegCacheTestCase::ZlibIntegCacheTestCase()
+    : TestCase("ZlibInteg caches the compression of repeated payloads")
+{
+}
+
+ZlibIntegCacheTestCase::~ZlibIntegCacheTestCase()
+{
+}
+
+void
+ZlibIntegCacheTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    zlib->SetAttribute("CacheSize", UintegerValue(1024 * 1024));
+    std::vector<uint8_t> input = MakeTextPayload(3000);
+    std::vector<uint8_t> other = MakeTextPayload(3001);
+
+    std::vector<uint8_t> first = zlib->Deflate(input);
+    std::vector<uint8_t> second = zlib->Deflate(input);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheMisses(), 1, "The first call should miss");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheHits(), 1, "The second call should hit");
+    NS_TEST_ASSERT_MSG_EQ((first == second), true, "A hit returned other bytes");
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(second) == input), true, "A hit does not inflate");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCompressedCount(), 1, "A hit should not count as compressed");
+
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(zlib->Deflate(other)) == other),
+                          true,
+                          "Round trip failed");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheMisses(), 2, "Another input should miss");
+
+    // Packets are cached apart from Deflate outputs
+    for (int i = 0; i < 2; i++)
+    {
+        Ptr<Packet> packet = Create<Packet>(input.data(), input.size());
+        NS_TEST_ASSERT_MSG_EQ(zlib->CompressPacket(packet), true, "CompressPacket failed");
+        NS_TEST_ASSERT_MSG_EQ(zlib->DecompressPacket(packet), true, "DecompressPacket failed");
+        NS_TEST_ASSERT_MSG_EQ((GetPacketBytes(packet) == input), true, "Packet round trip failed");
+    }
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheMisses(), 3, "The first packet should miss");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheHits(), 2, "The second packet should hit");
+
+    // Changing the output or clearing the cache empties it
+    zlib->SetAttribute("Level", IntegerValue(1));
+    zlib->Deflate(input);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheMisses(), 4, "A Level change should empty the cache");
+    zlib->ClearCache();
+    zlib->Deflate(input);
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheMisses(), 5, "ClearCache should empty the cache");
+
+    // SkipEntropy decides whether Deflate() compresses or stores, so it empties the cache too
+    std::vector<uint8_t> random = MakeRandomPayload(3000, 17);
+    zlib->SetAttribute("SkipEntropy", DoubleValue(8));
+    zlib->Deflate(random);
+    uint64_t skipped = zlib->GetSkippedCount();
+    zlib->SetAttribute("SkipEntropy", DoubleValue(7));
+    NS_TEST_ASSERT_MSG_EQ((zlib->Inflate(zlib->Deflate(random)) == random),
+                          true,
+                          "Round trip of stored input failed");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheMisses(), 7, "A SkipEntropy change should empty the cache");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetSkippedCount(),
+                          skipped + 1,
+                          "The output cached before the SkipEntropy change was returned");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for cache eviction and hits that do not fit the caller's buffer
+ */
+class ZlibIntegCacheLimitTestCase : public TestCase
+{
+public:
+    ZlibIntegCacheLimitTestCase();
+    ~ZlibIntegCacheLimitTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegCacheLimitTestCase::ZlibIntegCacheLimitTestCase()
+    : TestCase("ZlibInteg cache evicts old entries and checks buffer sizes")
+{
+}
+
+ZlibIntegCacheLimitTestCase::~ZlibIntegCacheLimitTestCase()
+{
+}
+
+void
+ZlibIntegCacheLimitTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    zlib->SetAttribute("CacheSize", UintegerValue(10000));
+
+    // Five 3000-byte inputs do not fit in 10000 bytes: the oldest is evicted
+    for (size_t i = 0; i < 5; i++)
+    {
+        zlib->Deflate(MakeTextPayload(3000 + i));
+    }
+    zlib->Deflate(MakeTextPayload(3004));
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheHits(), 1, "The newest entry should still be cached");
+    zlib->Deflate(MakeTextPayload(3000));
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheHits(), 1, "The oldest entry should have been evicted");
+
+    // A hit that does not fit the caller's buffer fails like a miss would
+    std::vector<uint8_t> input = MakeTextPayload(3000);
+    std::vector<uint8_t> compressed = zlib->Deflate(input);
+    std::vector<uint8_t> small(compressed.size() - 1);
+    uint64_t hits = zlib->GetCacheHits();
+    NS_TEST_ASSERT_MSG_EQ(zlib->Deflate(input.data(), input.size(), small.data(), small.size()),
+                          Z_BUF_ERROR,
+                          "A cached output was written past the buffer");
+    NS_TEST_ASSERT_MSG_EQ(zlib->GetCacheHits(), hits + 1, "The lookup should have hit");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the simulated CPU cost of compression
+ */
+class ZlibIntegCostModelTestCase : public TestCase
+{
+public:
+    ZlibIntegCostModelTestCase();
+    ~ZlibIntegCostModelTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegCostModelTestCase::ZlibIntegCostModelTestCase()
+    : TestCase("CompressionCostModel charges CPU time per byte and queues work")
+{
+}
+
+ZlibIntegCostModelTestCase::~ZlibIntegCostModelTestCase()
+{
+}
+
+void
+ZlibIntegCostModelTestCase::DoRun()
+{
+    Ptr<CompressionCostModel> model = CreateObject<CompressionCostModel>();
+
+    // Built-in table: 8 ns per byte at level 1, 3 ns per byte to inflate, plus 1 us per call
+    NS_TEST_ASSERT_MSG_EQ(model->GetCallOverhead(), MicroSeconds(1), "Wrong call overhead");
+    NS_TEST_ASSERT_MSG_EQ_TOL(model->GetDeflateTime(1000000, 1).GetSeconds(),
+                              0.008001,
+                              1e-8,
+                              "Wrong level 1 deflate time");
+    NS_TEST_ASSERT_MSG_EQ_TOL(model->GetInflateTime(1000000).GetSeconds(),
+                              0.003001,
+                              1e-8,
+                              "Wrong inflate time");
+    NS_TEST_ASSERT_MSG_EQ(model->GetDeflateTime(1000, -1),
+                          model->GetDeflateTime(1000, 6),
+                          "-1 is level 6");
+    NS_TEST_ASSERT_MSG_EQ(model->GetDeflateTime(1000, 12),
+                          model->GetDeflateTime(1000, 9),
+                          "Levels stop at 9");
+    NS_TEST_ASSERT_MSG_LT(model->GetDeflateTime(1000, 1),
+                          model->GetDeflateTime(1000, 9),
+                          "Level 9 is slower");
+
+    // A CPU half as fast takes twice as long
+    Time reference = model->GetDeflateTime(5000, 6);
+    model->SetAttribute("CpuSpeed", DoubleValue(0.5));
+    NS_TEST_ASSERT_MSG_EQ_TOL(model->GetDeflateTime(5000, 6).GetSeconds(),
+                              2 * reference.GetSeconds(),
+                              1e-9,
+                              "CpuSpeed was ignored");
+
+    // Work queues on the single CPU
+    NS_TEST_ASSERT_MSG_EQ(model->Process(MilliSeconds(1)),
+                          MilliSeconds(1),
+                          "An idle CPU starts at once");
+    NS_TEST_ASSERT_MSG_EQ(model->Process(MilliSeconds(2)),
+                          MilliSeconds(3),
+                          "Work should wait its turn");
+    NS_TEST_ASSERT_MSG_EQ(model->GetBusyTime(), MilliSeconds(3), "Wrong busy time");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the host-calibrated costs
+ */
+class ZlibIntegCostModelCalibrationTestCase : public TestCase
+{
+public:
+    ZlibIntegCostModelCalibrationTestCase();
+    ~ZlibIntegCostModelCalibrationTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegCostModelCalibrationTestCase::ZlibIntegCostModelCalibrationTestCase()
+    : TestCase("CompressionCostModel calibrates its costs on the host")
+{
+}
+
+ZlibIntegCostModelCalibrationTestCase::~ZlibIntegCostModelCalibrationTestCase()
+{
+}
+
+void
+ZlibIntegCostModelCalibrationTestCase::DoRun()
+{
+    Ptr<CompressionCostModel> model = CreateObject<CompressionCostModel>();
+    model->SetAttribute("Calibrate", BooleanValue(true));
+    model->SetAttribute("CallOverhead", TimeValue(Seconds(0)));
+
+    Time stored = model->GetDeflateTime(1000000, 0);
+    Time fast = model->GetDeflateTime(1000000, 1);
+    Time strong = model->GetDeflateTime(1000000, 9);
+    NS_TEST_ASSERT_MSG_GT(fast, Seconds(0), "Deflate cannot be free");
+    NS_TEST_ASSERT_MSG_LT(stored, strong, "Storing should be cheaper than level 9");
+    NS_TEST_ASSERT_MSG_LT(fast, strong, "Level 1 should be cheaper than level 9");
+    NS_TEST_ASSERT_MSG_GT(model->GetInflateTime(1000000), Seconds(0), "Inflate cannot be free");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the allocation-free steady state the benchmark measures
+ */
+class ZlibIntegSteadyStateTestCase : public TestCase
+{
+public:
+    ZlibIntegSteadyStateTestCase();
+    ~ZlibIntegSteadyStateTestCase() override;
+
+private:
+    void DoRun() override;
+};
+
+ZlibIntegSteadyStateTestCase::ZlibIntegSteadyStateTestCase()
+    : TestCase("ZlibInteg calls into caller buffers allocate no zlib memory")
+{
+}
+
+ZlibIntegSteadyStateTestCase::~ZlibIntegSteadyStateTestCase()
+{
+}
+
+void
+ZlibIntegSteadyStateTestCase::DoRun()
+{
+    ZlibMemoryPool* pool = ZlibMemoryPool::Get();
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    std::vector<uint8_t> input = MakeTextPayload(1400);
+    std::vector<uint8_t> compressed(zlib->GetDeflateBound(input.size()));
+    std::vector<uint8_t> output(input.size());
+
+    // The first calls set up the contexts
+    int64_t compressedSize =
+        zlib->Deflate(input.data(), input.size(), compressed.data(), compressed.size());
+    zlib->Inflate(compressed.data(), compressedSize, output.data(), output.size());
+
+    for (int round = 0; round < 2; round++)
+    {
+        uint64_t allocations = pool->GetAllocations();
+        for (int i = 0; i < 100; i++)
+        {
+            compressedSize =
+                zlib->Deflate(input.data(), input.size(), compressed.data(), compressed.size());
+            NS_TEST_ASSERT_MSG_GT(compressedSize, 0, "Deflate failed");
+            NS_TEST_ASSERT_MSG_EQ(
+                zlib->Inflate(compressed.data(), compressedSize, output.data(), output.size()),
+                static_cast<int64_t>(input.size()),
+                "Inflate failed");
+        }
+        NS_TEST_ASSERT_MSG_EQ(pool->GetAllocations(),
+                              allocations,
+                              "Steady-state calls allocated zlib memory");
+        NS_TEST_ASSERT_MSG_EQ((output == input), true, "Round trip failed");
+
+        // A new level is applied to the same deflate context
+        zlib->SetAttribute("Level", IntegerValue(9));
+        compressedSize =
+            zlib->Deflate(input.data(), input.size(), compressed.data(), compressed.size());
+        NS_TEST_ASSERT_MSG_GT(compressedSize, 0, "Deflate at the new level failed");
+    }
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * Test case for the trace sources and statistics
+ */
+class ZlibIntegStatisticsTestCase : public TestCase
+{
+public:
+    ZlibIntegStatisticsTestCase();
+    ~ZlibIntegStatisticsTestCase() override;
+
+private:
+    void DoRun() override;
+
+    /**
+     * Records a successful compression.
+     *
+     * @param inputBytes Input size.
+     * @param outputBytes Output size.
+     * @param wallTime Duration.
+     */
+    void Deflated(uint64_t inputBytes, uint64_t outputBytes, Time wallTime);
+
+    /**
+     * Records a successful decompression.
+     *
+     * @param inputBytes Input size.
+     * @param outputBytes Output size.
+     * @param wallTime Duration.
+     */
+    void Inflated(uint64_t inputBytes, uint64_t outputBytes, Time wallTime);
+
+    /**
+     * Records a failed decompression.
+     *
+     * @param error The error code.
+     */
+    void InflateFailed(int error);
+
+    /**
+     * Reads a counter attribute.
+     *
+     * @param zlib The object.
+     * @param name The attribute.
+     * @return Its value
+     */
+    static uint64_t GetCounter(Ptr<ZlibInteg> zlib, const std::string& name);
+
+    uint32_t m_deflates;            //!< Deflate trace calls
+    uint64_t m_deflateBytesIn;      //!< Input bytes reported by the Deflate trace
+    uint64_t m_deflateBytesOut;     //!< Output bytes reported by the Deflate trace
+    uint32_t m_inflates;            //!< Inflate trace calls
+    std::vector<int> m_inflateErrors; //!< Errors reported by the InflateFailure trace
+};
+
+ZlibIntegStatisticsTestCase::ZlibIntegStatisticsTestCase()
+    : TestCase("ZlibInteg traces and counts every compression call"),
+      m_deflates(0),
+      m_deflateBytesIn(0),
+      m_deflateBytesOut(0),
+      m_inflates(0)
+{
+}
+
+ZlibIntegStatisticsTestCase::~ZlibIntegStatisticsTestCase()
+{
+}
+
+void
+ZlibIntegStatisticsTestCase::Deflated(uint64_t inputBytes,
+                                      uint64_t outputBytes,
+                                      Time /* wallTime */)
+{
+    m_deflates++;
+    m_deflateBytesIn += inputBytes;
+    m_deflateBytesOut += outputBytes;
+}
+
+void
+ZlibIntegStatisticsTestCase::Inflated(uint64_t /* inputBytes */,
+                                      uint64_t /* outputBytes */,
+                                      Time /* wallTime */)
+{
+    m_inflates++;
+}
+
+void
+ZlibIntegStatisticsTestCase::InflateFailed(int error)
+{
+    m_inflateErrors.push_back(error);
+}
+
+uint64_t
+ZlibIntegStatisticsTestCase::GetCounter(Ptr<ZlibInteg> zlib, const std::string& name)
+{
+    UintegerValue value;
+    zlib->GetAttribute(name, value);
+    return value.Get();
+}
+
+void
+ZlibIntegStatisticsTestCase::DoRun()
+{
+    Ptr<ZlibInteg> zlib = CreateObject<ZlibInteg>();
+    zlib->TraceConnectWithoutContext("Deflate",
+                                     MakeCallback(&ZlibIntegStatisticsTestCase::Deflated, this));
+    zlib->TraceConnectWithoutContext("Inflate",
+                                     MakeCallback(&ZlibIntegStatisticsTestCase::Inflated, this));
+    zlib->TraceConnectWithoutContext("InflateFailure",
+                                     MakeCallback(&ZlibIntegStatisticsTestCase::InflateFailed,
+                                                  this));
+
+    std::vector<uint8_t> input = MakeTextPayload(5000);
+    std::vector<uint8_t> compressed = zlib->Deflate(input);
+    NS_TEST_ASSERT_MSG_EQ(m_deflates, 1, "The Deflate trace did not fire");
+    NS_TEST_ASSERT_MSG_EQ(m_deflateBytesIn, input.size(), "Wrong input size traced");
+    NS_TEST_ASSERT_MSG_EQ(m_deflateBytesOut, compressed.size(), "Wrong output size traced");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "DeflateCalls"), 1, "Wrong DeflateCalls");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "DeflateBytesIn"), input.size(), "Wrong DeflateBytesIn");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "DeflateBytesOut"),
+                          compressed.size(),
+                          "Wrong DeflateBytesOut");
+
+    // The vector Inflate uses the pointer one, but counts once
+    zlib->Inflate(compressed);
+    NS_TEST_ASSERT_MSG_EQ(m_inflates, 1, "A nested call was traced twice");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "InflateCalls"), 1, "A nested call was counted twice");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "InflateBytesOut"),
+                          input.size(),
+                          "Wrong InflateBytesOut");
+
+    // Failures are traced with their error code
+    std::vector<uint8_t> output(input.size() - 1);
+    zlib->Inflate(compressed.data(), compressed.size(), output.data(), output.size());
+    NS_TEST_ASSERT_MSG_EQ(m_inflateErrors.size(), 1, "The failure was not traced");
+    NS_TEST_ASSERT_MSG_EQ(m_inflateErrors.back(), Z_BUF_ERROR, "Wrong error traced");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "InflateFailures"), 1, "Wrong InflateFailures");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "InflateCalls"), 2, "A failed call is still a call");
+
+    TimeValue deflateTime;
+    zlib->GetAttribute("DeflateTime", deflateTime);
+    NS_TEST_ASSERT_MSG_GT(deflateTime.Get(), Seconds(0), "No time was accounted");
+
+    zlib->ResetStatistics();
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "DeflateCalls"), 0, "ResetStatistics left DeflateCalls");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "InflateFailures"),
+                          0,
+                          "ResetStatistics left InflateFailures");
+
+    // A failed batch is one failure, with the error of its first failing item
+    std::vector<std::vector<uint8_t>> items = {compressed,
+                                               MakeRandomPayload(64, 20),
+                                               std::vector<uint8_t>()};
+    ZlibInteg::Batch batch;
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateBatch(items, batch), false, "A bad batch succeeded");
+    NS_TEST_ASSERT_MSG_EQ(m_inflateErrors.back(), Z_DATA_ERROR, "The junk item comes first");
+    std::swap(items[1], items[2]);
+    NS_TEST_ASSERT_MSG_EQ(zlib->InflateBatch(items, batch), false, "A bad batch succeeded");
+    NS_TEST_ASSERT_MSG_EQ(m_inflateErrors.back(), Z_STREAM_ERROR, "The empty item comes first");
+    NS_TEST_ASSERT_MSG_EQ(GetCounter(zlib, "InflateFailures"), 2, "Each batch is one failure");
+}
+
+/**
+ * @ingroup zlib-integ-tests
+ * TestSuite for module zlib-integ
+ */
+class ZlibIntegTestSuite : public TestSuite
+{
+public:
+    ZlibIntegTestSuite();
+};
+
+ZlibIntegTestSuite::ZlibIntegTestSuite()
+    : TestSuite("zlib-integ", Type::UNIT)
+{
+    AddTestCase(new ZlibIntegContextReuseTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegContextErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegSizePrefixTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegBufferApiTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegBufferApiErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegPacketTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegPacketErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegLinkCompressionTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegFlowTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegFlowErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegDictionaryTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegDictionaryErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegParallelTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegParallelErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegSeekableTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegSeekableErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegAdaptiveTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegAdaptiveStreamTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegEntropyTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegEntropyPacketTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegMemoryPoolTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegPooledStreamsTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegInflateStreamTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegBatchTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegBatchErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegFormatTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegBackendTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegPcapWriterTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegPcapWriterErrorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegCacheTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegCacheLimitTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegCostModelTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegCostModelCalibrationTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegSteadyStateTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new ZlibIntegStatisticsTestCase, TestCase::Duration::QUICK);
+}
+
+// Do not forget to allocate an instance of this TestSuite
+/**
+ * @ingroup zlib-integ-tests
+ * Static variable for test initialization
+ */
+static ZlibIntegTestSuite sZlibIntegTestSuite;